@@ -0,0 +1,70 @@
+#pragma once
+
+#ifndef _RVSIM_BLOCK_ENGINE_H
+#define _RVSIM_BLOCK_ENGINE_H
+
+#include <stdint.h>
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "isa.h"
+#include "memory.h"
+#include "registers.h"
+
+class processor_t;
+class block_engine_t;
+class lockstep_t;
+
+// Cada instrução do bloco já carrega o ponteiro da função que a executa
+typedef void (*op_handler_t)(block_engine_t &engine, const decoded_t &ins);
+
+struct block_op_t {
+  op_handler_t handler;
+  decoded_t ins;
+};
+
+// Bloco básico: instruções sequenciais terminadas por um salto, uma chamada de
+// sistema, um FENCE.I ou o fim da página
+struct block_t {
+  uint32_t start;
+  uint32_t next_pc; // endereço seguinte à última instrução do bloco
+  std::vector<block_op_t> ops;
+  // Encadeamento com os blocos sucessores já traduzidos
+  block_t *successor[2];
+  uint32_t successor_pc[2];
+};
+
+#define BLOCK_MAX_INSTRUCTIONS 64
+
+class block_engine_t {
+private:
+  std::unordered_map<uint32_t, std::unique_ptr<block_t>> blocks;
+
+  block_t *translate(uint32_t pc);
+  block_t *getBlock(uint32_t pc);
+  void flush();
+
+  static op_handler_t getHandler(MNE op);
+
+public:
+  // Estado arquitetural do processador que executa os blocos
+  registers_t *regs;
+  memory_t *memory;
+  int *PC;
+  bool *running;
+  // Comparação com a referência depois de cada instrução (opcional)
+  lockstep_t *lockstep;
+  // Sinaliza que o bloco atual precisa ser interrompido (fim do programa ou
+  // escrita em página de código)
+  bool exit_block;
+  // Os blocos traduzidos devem ser descartados ao final do bloco atual
+  bool flush_pending;
+
+  block_engine_t(processor_t &p);
+
+  uint64_t run();
+};
+
+#endif
@@ -0,0 +1,320 @@
+#pragma once
+
+#ifndef _RVSIM_CACHE_H
+#define _RVSIM_CACHE_H
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+// Modelo nativo de cache set-associativa (alternativa ao dineroIV). Cada
+// acesso é resolvido com uma única busca no conjunto e já informa se houve
+// hit, sem a necessidade de comparar contadores antes e depois.
+
+enum class REPLACEMENT { LRU, PLRU, RANDOM };
+
+enum class PREFETCH { NONE, NEXT_LINE };
+
+class checkpoint_writer_t;
+class checkpoint_reader_t;
+
+// Máximo de níveis em uma hierarquia (um bit por nível nas máscaras de miss)
+#define CACHE_MAX_LEVELS 8
+
+// Descrição de um nível da hierarquia
+struct cache_level_config_t {
+  std::string name;
+  uint32_t line_size = 64;
+  uint32_t size = 32768;
+  uint32_t ways = 4;
+  REPLACEMENT replacement = REPLACEMENT::LRU;
+  PREFETCH prefetch = PREFETCH::NONE;
+  bool write_back = false;
+  bool write_allocate = true;
+  bool read_only = false;
+  // Ciclos somados ao acesso quando ele falha neste nível
+  uint32_t miss_penalty = 10;
+  // Misses pendentes ao mesmo tempo (MSHRs), usado só pelo núcleo fora de
+  // ordem
+  uint32_t mshrs = 8;
+  // Nome do nível abaixo, vazio para a memória principal
+  std::string next;
+};
+
+// Descrição da hierarquia completa e de onde começam os acessos de instrução
+// e de dados
+struct cache_config_t {
+  std::vector<cache_level_config_t> levels;
+  std::string instruction_level;
+  std::string data_level;
+
+  // Hierarquia padrão do simulador (L1i/L1d de 32 KiB, L2 de 256 KiB e L3 de
+  // 8 MiB, todas 4-way LRU e write-through)
+  static cache_config_t defaults();
+  // Lê a descrição de um arquivo. Seções [nome] definem (ou alteram) um nível
+  // e as chaves antes da primeira seção (instruction e data) indicam os níveis
+  // onde começam os acessos
+  bool load(const std::string &path, std::string &error);
+  // Aplica uma opção no formato <nível>.<chave>=<valor> ou <chave>=<valor>
+  bool set(const std::string &option, std::string &error);
+  // Verifica a consistência da descrição (potências de 2, níveis existentes,
+  // ausência de ciclos)
+  bool validate(std::string &error) const;
+  // Índice do nível com o nome informado ou -1
+  int find(const std::string &name) const;
+
+private:
+  bool setKey(const std::string &level, const std::string &key,
+              const std::string &value, std::string &error);
+};
+
+// Resultado do acesso a um nível: hit e a linha suja que foi substituída (no
+// caso de write-back) e precisa ser escrita no nível abaixo
+struct cache_result_t {
+  bool hit;
+  bool writeback;
+  uint32_t writeback_address;
+};
+
+static inline uint32_t cacheLog2(uint32_t value) {
+  uint32_t lg2 = 0;
+  while ((1u << lg2) < value)
+    lg2++;
+  return lg2;
+}
+
+class cache_t {
+private:
+  std::string name;
+  uint32_t lg2_line;
+  uint32_t sets, ways;
+  REPLACEMENT policy;
+  PREFETCH prefetch;
+  bool write_back, write_allocate, read_only;
+  // Tag de cada linha (número do bloco + 1, 0 indica linha inválida)
+  std::vector<uint32_t> tags;
+  std::vector<bool> dirty;
+  // LRU: instante do último acesso de cada linha
+  std::vector<uint64_t> stamps;
+  uint64_t clock;
+  // PLRU: bits da árvore de cada conjunto
+  std::vector<uint64_t> plru;
+  uint32_t random_state;
+  uint64_t accesses, misses, prefetches, writebacks;
+
+  uint32_t victim(uint32_t set) {
+    uint32_t base = set * ways;
+    for (uint32_t w = 0; w < ways; w++)
+      if (tags[base + w] == 0)
+        return w;
+    switch (policy) {
+    case REPLACEMENT::LRU: {
+      uint32_t lru = 0;
+      for (uint32_t w = 1; w < ways; w++)
+        if (stamps[base + w] < stamps[base + lru])
+          lru = w;
+      return lru;
+    }
+    case REPLACEMENT::PLRU: {
+      // Desce a árvore seguindo os bits, que apontam para a metade menos
+      // recentemente usada
+      uint64_t bits = plru[set];
+      uint32_t node = 1;
+      while (node < ways)
+        node = 2 * node + ((bits >> node) & 1);
+      return node - ways;
+    }
+    case REPLACEMENT::RANDOM:
+    default:
+      // xorshift32, determinístico para que as execuções sejam reproduzíveis
+      random_state ^= random_state << 13;
+      random_state ^= random_state >> 17;
+      random_state ^= random_state << 5;
+      return random_state % ways;
+    }
+  }
+
+  void touch(uint32_t set, uint32_t way) {
+    switch (policy) {
+    case REPLACEMENT::LRU:
+      stamps[set * ways + way] = ++clock;
+      break;
+    case REPLACEMENT::PLRU: {
+      // Os nós no caminho passam a apontar para o lado oposto ao acessado
+      uint64_t &bits = plru[set];
+      uint32_t node = way + ways;
+      while (node > 1) {
+        uint32_t parent = node / 2;
+        if (node & 1)
+          bits &= ~(1ull << parent);
+        else
+          bits |= (1ull << parent);
+        node = parent;
+      }
+      break;
+    }
+    case REPLACEMENT::RANDOM:
+      break;
+    }
+  }
+
+  // Coloca o bloco na via informada, indicando em result a linha suja removida
+  void fill(uint32_t block, uint32_t way, bool is_dirty,
+            cache_result_t &result) {
+    uint32_t set = block % sets;
+    uint32_t line = set * ways + way;
+    if (tags[line] != 0 && dirty[line]) {
+      result.writeback = true;
+      result.writeback_address = (tags[line] - 1) << lg2_line;
+      writebacks++;
+    }
+    tags[line] = block + 1;
+    dirty[line] = is_dirty;
+    touch(set, way);
+  }
+
+  int findLine(uint32_t block) const {
+    uint32_t base = (block % sets) * ways;
+    for (uint32_t w = 0; w < ways; w++)
+      if (tags[base + w] == block + 1)
+        return base + w;
+    return -1;
+  }
+
+public:
+  cache_t(const cache_level_config_t &config) {
+    name = config.name;
+    lg2_line = cacheLog2(config.line_size);
+    ways = config.ways;
+    sets = (config.size >> lg2_line) / ways;
+    if (sets == 0)
+      sets = 1;
+    policy = config.replacement;
+    prefetch = config.prefetch;
+    write_back = config.write_back;
+    write_allocate = config.write_allocate;
+    read_only = config.read_only;
+    tags.assign(sets * ways, 0);
+    dirty.assign(sets * ways, false);
+    stamps.assign(sets * ways, 0);
+    clock = 0;
+    plru.assign(sets, 0);
+    random_state = 2463534242u;
+    accesses = 0;
+    misses = 0;
+    prefetches = 0;
+    writebacks = 0;
+  }
+
+  // Acessa o bloco do endereço. Em caso de miss o bloco é alocado (exceto
+  // escritas sem write-allocate) e, com prefetch, o bloco seguinte também.
+  cache_result_t access(uint32_t address, bool write) {
+    cache_result_t result = {true, false, 0};
+    uint32_t block = address >> lg2_line;
+    accesses++;
+    int line = findLine(block);
+    if (line >= 0) {
+      touch(line / ways, line % ways);
+      if (write && write_back)
+        dirty[line] = true;
+      return result;
+    }
+    result.hit = false;
+    misses++;
+    if (!write || write_allocate)
+      fill(block, victim(block % sets), write && write_back, result);
+    // O prefetch do bloco seguinte só ocupa linhas limpas, para que um acesso
+    // gere no máximo uma escrita de volta
+    if (prefetch == PREFETCH::NEXT_LINE && findLine(block + 1) < 0) {
+      uint32_t next_set = (block + 1) % sets;
+      uint32_t next_way = victim(next_set);
+      if (!dirty[next_set * ways + next_way]) {
+        cache_result_t prefetch_result = {true, false, 0};
+        fill(block + 1, next_way, false, prefetch_result);
+        prefetches++;
+      }
+    }
+    return result;
+  }
+
+  const std::string &getName() const { return name; }
+  uint32_t getLineSize() const { return 1u << lg2_line; }
+  bool isReadOnly() const { return read_only; }
+  bool isWriteBack() const { return write_back; }
+  bool isWriteAllocate() const { return write_allocate; }
+  uint64_t getAccesses() const { return accesses; }
+  uint64_t getMisses() const { return misses; }
+  uint64_t getPrefetches() const { return prefetches; }
+  uint64_t getWritebacks() const { return writebacks; }
+
+  // Estado aquecido (conteúdo e substituição, sem os contadores) para os
+  // checkpoints. loadState só deve ser usado se sameGeometry confirmar que o
+  // estado foi gravado por uma cache com a mesma organização.
+  void saveGeometry(checkpoint_writer_t &writer) const;
+  bool sameGeometry(checkpoint_reader_t &reader) const;
+  void saveState(checkpoint_writer_t &writer) const;
+  void loadState(checkpoint_reader_t &reader);
+};
+
+// Hierarquia de caches: cada nível aponta para o nível abaixo (-1 é a memória)
+class cache_hierarchy_t {
+private:
+  std::vector<cache_t> levels;
+  std::vector<int> parent;
+
+  // Linhas sujas removidas são escritas no nível abaixo sem penalidade
+  void writeBack(int level, uint32_t address) {
+    if (level >= 0)
+      access(level, address, true);
+  }
+
+public:
+  // Os níveis são adicionados na ordem da descrição, parent_level pode ser
+  // um nível adicionado depois
+  int addLevel(const cache_t &cache, int parent_level) {
+    if (levels.size() >= CACHE_MAX_LEVELS)
+      return -1;
+    levels.push_back(cache);
+    parent.push_back(parent_level);
+    return levels.size() - 1;
+  }
+
+  // Acesso a partir do nível first. Leituras descem até o primeiro nível com
+  // hit. Escritas descem enquanto os níveis forem write-through; em um nível
+  // write-back o miss vira a leitura do bloco no nível abaixo. Retorna a
+  // máscara com um bit para cada nível que teve miss.
+  uint32_t access(int first, uint32_t address, bool write) {
+    uint32_t miss_mask = 0;
+    for (int level = first; level >= 0; level = parent[level]) {
+      cache_t &cache = levels[level];
+      cache_result_t result = cache.access(address, write);
+      if (result.writeback)
+        writeBack(parent[level], result.writeback_address);
+      if (!result.hit) {
+        miss_mask |= 1u << level;
+        // Write-back com allocate busca o bloco (leitura) no nível abaixo
+        if (write && cache.isWriteBack() && cache.isWriteAllocate())
+          write = false;
+      } else if (!write || cache.isWriteBack()) {
+        break;
+      }
+    }
+    return miss_mask;
+  }
+
+  uint32_t read(int first, uint32_t address) {
+    return access(first, address, false);
+  }
+
+  uint32_t write(int first, uint32_t address) {
+    return access(first, address, true);
+  }
+
+  cache_t &getLevel(int level) { return levels[level]; }
+  const cache_t &getLevel(int level) const { return levels[level]; }
+  int getParent(int level) const { return parent[level]; }
+  int getLevels() const { return levels.size(); }
+};
+
+#endif
@@ -0,0 +1,101 @@
+#pragma once
+
+#ifndef _RVSIM_CHECKPOINT_H
+#define _RVSIM_CHECKPOINT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+class memory_t;
+class processor_t;
+
+// Checkpoint: um cabeçalho fixo seguido do corpo comprimido. O corpo tem o
+// estado arquitetural (PC, registradores e as páginas da memória que diferem
+// da imagem do ELF) e, opcionalmente, o estado aquecido do gshare e das
+// caches. O ELF não é gravado: a restauração carrega o mesmo programa (conferido
+// pelo tamanho e hash do arquivo) e aplica as páginas por cima.
+#define CHECKPOINT_MAGIC      "RVSCKPT\0"
+#define CHECKPOINT_VERSION    1
+#define CHECKPOINT_HEADER_SIZE 48
+
+// Flags do cabeçalho
+#define CHECKPOINT_F_WARM     0x1 // possui o estado do gshare e das caches
+
+// Serialização little-endian do corpo do checkpoint
+class checkpoint_writer_t {
+private:
+  std::vector<uint8_t> data;
+
+public:
+  void putU8(uint8_t value) { data.push_back(value); }
+  void putU32(uint32_t value);
+  void putU64(uint64_t value);
+  void putVarint(uint64_t value);
+  void putBytes(const uint8_t *bytes, size_t size);
+  // Grava o conteúdo de outro writer precedido do tamanho, para que possa ser
+  // ignorado na leitura
+  void putBlock(const checkpoint_writer_t &block);
+  const std::vector<uint8_t> &getData() const { return data; }
+};
+
+// Leitura do corpo. Ler além do fim zera os valores e marca o leitor como
+// inválido (good() retorna false), sem precisar testar cada campo.
+class checkpoint_reader_t {
+private:
+  const uint8_t *data;
+  size_t size, position;
+  bool valid;
+
+  bool require(size_t count);
+
+public:
+  checkpoint_reader_t(const uint8_t *bytes, size_t length);
+
+  uint8_t getU8();
+  uint32_t getU32();
+  uint64_t getU64();
+  uint64_t getVarint();
+  void getBytes(uint8_t *bytes, size_t count);
+  // Lê um bloco gravado com putBlock e avança para depois dele
+  checkpoint_reader_t getBlock();
+  bool good() const { return valid; }
+};
+
+struct checkpoint_info_t {
+  // Instruções executadas desde o início do programa
+  uint64_t instret = 0;
+  uint32_t pages = 0;
+  bool warm = false;
+  // Estado aquecido que não pôde ser usado (configuração diferente)
+  bool warm_ignored = false;
+};
+
+// Versões em memória de saveCheckpoint/restoreCheckpoint: contents tem o
+// mesmo conteúdo do arquivo
+bool encodeCheckpoint(std::vector<uint8_t> &contents, const char *elf_path,
+                      const processor_t &processor, const memory_t &memory,
+                      bool warm, checkpoint_info_t *info, std::string &error);
+bool decodeCheckpoint(const std::vector<uint8_t> &contents,
+                      const char *elf_path, processor_t &processor,
+                      memory_t &memory, checkpoint_info_t *info,
+                      std::string &error);
+
+// Grava o estado do processador e da memória em path. elf_path é o programa
+// em execução, usado para gravar só as páginas alteradas. warm inclui o
+// estado do gshare e das caches (só existe na execução temporizada). Falha se
+// o programa já terminou.
+bool saveCheckpoint(const char *path, const char *elf_path,
+                    const processor_t &processor, const memory_t &memory,
+                    bool warm, checkpoint_info_t *info, std::string &error);
+
+// Restaura um checkpoint em um processador e uma memória recém-criados, com o
+// ELF já carregado. O estado aquecido só é aplicado se a configuração do
+// gshare e das caches for a mesma da gravação.
+bool restoreCheckpoint(const char *path, const char *elf_path,
+                       processor_t &processor, memory_t &memory,
+                       checkpoint_info_t *info, std::string &error);
+
+#endif
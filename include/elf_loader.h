@@ -0,0 +1,139 @@
+#pragma once
+
+#ifndef _RVSIM_ELF_LOADER_H
+#define _RVSIM_ELF_LOADER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+class memory_t;
+
+// Estruturas do ELF32 (little-endian, como o RISC-V e o host)
+#define ELF_MAGIC       "\x7f" "ELF"
+#define ELF_CLASS_32    1
+#define ELF_DATA_LSB    1
+#define ELF_MACHINE_RV  243
+
+#define ELF_PT_LOAD     1
+
+#define ELF_SHT_SYMTAB  2
+#define ELF_SHT_NOBITS  8
+#define ELF_SHF_ALLOC   0x2
+#define ELF_SHF_EXECINSTR 0x4
+
+#define ELF_STT_NOTYPE  0
+#define ELF_STT_FUNC    2
+#define ELF_SHN_UNDEF   0
+
+struct elf32_ehdr_t {
+  uint8_t ident[16];
+  uint16_t type;
+  uint16_t machine;
+  uint32_t version;
+  uint32_t entry;
+  uint32_t phoff;
+  uint32_t shoff;
+  uint32_t flags;
+  uint16_t ehsize;
+  uint16_t phentsize;
+  uint16_t phnum;
+  uint16_t shentsize;
+  uint16_t shnum;
+  uint16_t shstrndx;
+};
+
+struct elf32_phdr_t {
+  uint32_t type;
+  uint32_t offset;
+  uint32_t vaddr;
+  uint32_t paddr;
+  uint32_t filesz;
+  uint32_t memsz;
+  uint32_t flags;
+  uint32_t align;
+};
+
+struct elf32_shdr_t {
+  uint32_t name;
+  uint32_t type;
+  uint32_t flags;
+  uint32_t addr;
+  uint32_t offset;
+  uint32_t size;
+  uint32_t link;
+  uint32_t info;
+  uint32_t addralign;
+  uint32_t entsize;
+};
+
+struct elf32_sym_t {
+  uint32_t name;
+  uint32_t value;
+  uint32_t size;
+  uint8_t info;
+  uint8_t other;
+  uint16_t shndx;
+};
+
+// Arquivo ELF32 mapeado na memória (mmap, somente leitura). Os cabeçalhos são
+// validados no open e lidos diretamente do mapeamento, sem cópias.
+class elf_file_t {
+private:
+  const uint8_t *data;
+  size_t size;
+  elf32_ehdr_t header;
+
+  bool validate(std::string &error);
+
+public:
+  elf_file_t();
+  ~elf_file_t();
+  elf_file_t(const elf_file_t &) = delete;
+  elf_file_t &operator=(const elf_file_t &) = delete;
+
+  bool open(const char *path, std::string &error);
+  void close();
+
+  const elf32_ehdr_t &getHeader() const { return header; }
+  size_t getSize() const { return size; }
+  elf32_phdr_t getProgramHeader(int index) const;
+  elf32_shdr_t getSectionHeader(int index) const;
+  // Bytes do arquivo a partir de offset (nullptr se sair do arquivo)
+  const uint8_t *at(uint64_t offset, uint64_t length) const;
+
+  // Copia os segmentos PT_LOAD para a memória: p_filesz bytes do arquivo e o
+  // restante até p_memsz (BSS) zerado. Sem program headers, usa as seções
+  // SHF_ALLOC.
+  void load(memory_t &memory) const;
+};
+
+// Funções da tabela de símbolos (SHT_SYMTAB), ordenadas por endereço. Os
+// símbolos sem tipo definidos em seções (rótulos de código em assembly, como
+// _start) também entram, com o tamanho até o próximo símbolo.
+struct elf_symbol_t {
+  uint32_t address;
+  uint32_t size;
+  std::string name;
+};
+
+class symbol_table_t {
+private:
+  std::vector<elf_symbol_t> symbols;
+
+public:
+  // Retorna false se o ELF não tiver tabela de símbolos
+  bool load(const elf_file_t &elf);
+  bool empty() const { return symbols.empty(); }
+  // Função que contém address (nullptr se nenhuma)
+  const elf_symbol_t *find(uint32_t address) const;
+};
+
+// Carrega o programa na memória. Retorna false (com a mensagem em error) se o
+// arquivo não for um ELF32 RISC-V válido.
+bool load_elf(const char *elf_file, memory_t &memory, uint32_t *entry_point,
+              std::string &error);
+
+#endif
@@ -0,0 +1,95 @@
+#pragma once
+
+#ifndef _RVSIM_HOST_PROFILE_H
+#define _RVSIM_HOST_PROFILE_H
+
+// Perfil do próprio simulador (tempo do host gasto em cada estágio do laço de
+// simulação). Só existe quando compilado com RVSIM_HOST_PROFILE
+// (HOST_PROFILE=1 make); sem ele as macros não geram código nenhum.
+//
+// HOST_PROFILE_SCOPE(estágio) mede o tempo até o fim do bloco. Os blocos
+// podem ser aninhados: o tempo de um bloco interno é descontado do externo,
+// então cada estágio conta só o próprio tempo. Cada thread acumula em um
+// buffer próprio, somado no relatório impresso (em stderr) no fim do
+// processo.
+
+#ifdef RVSIM_HOST_PROFILE
+
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+// STEP é o laço de cada instrução (o modelo de temporização, descontados os
+// outros estágios) e conta as instruções do relatório
+enum class HOST_STAGE : int {
+  STEP = 0,
+  FETCH,
+  DECODE,
+  EXECUTE,
+  CACHE,
+  DINERO,
+  STATS,
+  LOG,
+  COUNT
+};
+
+// Blocos aninhados no máximo (o laço usa STEP > FETCH > CACHE > DINERO)
+#define HOST_PROFILE_MAX_DEPTH 16
+
+struct host_profile_buffer_t {
+  uint64_t ticks[(int)HOST_STAGE::COUNT];
+  uint64_t calls[(int)HOST_STAGE::COUNT];
+  // Tempo dos blocos internos de cada nível aberto
+  uint64_t inner[HOST_PROFILE_MAX_DEPTH + 1];
+  int depth;
+};
+
+// Buffer da thread atual (criado e registrado no primeiro uso)
+host_profile_buffer_t &hostProfileBuffer();
+
+static inline uint64_t hostProfileTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+class host_profile_scope_t {
+private:
+  host_profile_buffer_t &buffer;
+  int stage;
+  uint64_t start;
+
+public:
+  explicit host_profile_scope_t(HOST_STAGE pstage)
+      : buffer(hostProfileBuffer()), stage((int)pstage) {
+    buffer.inner[++buffer.depth] = 0;
+    start = hostProfileTicks();
+  }
+  ~host_profile_scope_t() {
+    uint64_t elapsed = hostProfileTicks() - start;
+    buffer.ticks[stage] += elapsed - buffer.inner[buffer.depth];
+    buffer.calls[stage]++;
+    buffer.depth--;
+    buffer.inner[buffer.depth] += elapsed;
+  }
+};
+
+#define HOST_PROFILE_CONCAT2(a, b) a##b
+#define HOST_PROFILE_CONCAT(a, b) HOST_PROFILE_CONCAT2(a, b)
+#define HOST_PROFILE_SCOPE(stage)                                              \
+  host_profile_scope_t HOST_PROFILE_CONCAT(host_profile_scope_, __LINE__)(     \
+      HOST_STAGE::stage)
+
+#else
+
+#define HOST_PROFILE_SCOPE(stage)
+
+#endif
+
+#endif
@@ -0,0 +1,89 @@
+#pragma once
+
+#ifndef _RVSIM_INTERVAL_H
+#define _RVSIM_INTERVAL_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "memory.h"
+#include "processor.h"
+
+#define STREAM_BUFFER_SIZE    (64 * 1024)
+// Buffers cheios esperando a thread no máximo
+#define STREAM_MAX_PENDING    8
+
+// Arquivo gravado por uma thread separada. O laço de simulação só copia os
+// dados para o buffer atual; quando ele enche, é entregue à thread, que faz o
+// fwrite enquanto a simulação continua em outro buffer. Os buffers já gravados
+// são reaproveitados. Se o disco não acompanhar, a simulação espera quando já
+// há STREAM_MAX_PENDING buffers na fila, em vez de acumular memória.
+class stream_writer_t {
+private:
+  FILE *file;
+  std::vector<char> current;
+  std::deque<std::vector<char>> pending;
+  std::vector<std::vector<char>> spare;
+  std::mutex mutex;
+  std::condition_variable wake;
+  // Avisa a simulação de que a fila diminuiu
+  std::condition_variable drained;
+  bool closing;
+  bool empty;
+  // Algum fwrite não gravou o buffer inteiro
+  bool failed;
+  std::thread thread;
+
+  void handOff();
+  void writerLoop();
+
+public:
+  stream_writer_t();
+  ~stream_writer_t();
+  stream_writer_t(const stream_writer_t &) = delete;
+  stream_writer_t &operator=(const stream_writer_t &) = delete;
+
+  // Abre o arquivo para acrescentar dados (criando-o se não existir)
+  bool open(const char *path);
+  // O arquivo estava vazio ao ser aberto
+  bool wasEmpty() const { return empty; }
+  void write(const char *data, size_t size);
+  // Grava o que falta e espera a thread terminar. Retorna false se alguma
+  // gravação falhou.
+  bool close();
+};
+
+// Séries temporais da execução: a cada intervalo (de instruções ou de ciclos)
+// uma linha CSV com o IPC, a precisão do gshare, as taxas de miss de cada
+// nível de cache e a ocupação das unidades funcionais naquele intervalo.
+class interval_sampler_t {
+private:
+  const processor_t &processor;
+  memory_t &memory;
+  stream_writer_t &writer;
+  int levels;
+  uint64_t intervals;
+  // Valores acumulados na amostra anterior
+  sim_stats_t last_stats;
+  stall_stats_t last_stalls;
+  uint64_t last_accesses[CACHE_MAX_LEVELS];
+  uint64_t last_misses[CACHE_MAX_LEVELS];
+
+public:
+  interval_sampler_t(const processor_t &pprocessor, memory_t &pmemory,
+                     stream_writer_t &pwriter);
+
+  // Cabeçalho do CSV (só em arquivos novos)
+  void writeHeader();
+  // Linha com as diferenças desde a amostra anterior
+  void sample();
+};
+
+#endif
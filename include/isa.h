@@ -7,8 +7,12 @@
 #include <stdint.h>
 #include <string>
 
+#include "memory.h"
 #include "utils.h"
 
+// Registrador não utilizado pela instrução
+#define REG_NONE 0xFF
+
 class instruction_t {
 private:
   uint32_t inst;
@@ -41,4 +45,56 @@ public:
   unsigned long int getInsAddress();
 };
 
+// Forma compacta de uma instrução já decodificada, com o imediato já com
+// extensão de sinal
+struct decoded_t {
+  uint32_t address;
+  uint32_t raw;
+  MNE op;
+  FU fu;
+  uint8_t rd, rs1, rs2, shammt;
+  int32_t imm;
+  bool valid;
+};
+
+decoded_t decodeInstruction(uint32_t raw, uint32_t address);
+
+// Disassembly (de acordo com os slides), montado apenas quando for impresso
+#define LOG_LINE_SIZE 96
+
+const char *getMnemonic(MNE op);
+void disassemble(const decoded_t &ins, char *out, size_t size);
+void formatLogLine(const decoded_t &ins, char *out, size_t size);
+
+// Cache de instruções decodificadas indexado pelo PC, organizado nas mesmas
+// páginas da memória para que escritas numa página de código invalidem apenas
+// as instruções dela
+#define DECODE_PAGE_ENTRIES (PAGE_SIZE / 4)
+
+struct decoded_page_t {
+  decoded_t entries[DECODE_PAGE_ENTRIES];
+};
+
+struct decoded_table_t {
+  decoded_page_t *pages[PT_ENTRIES];
+};
+
+class decode_cache_t {
+private:
+  decoded_table_t *page_dir[PT_ENTRIES];
+  uint32_t last_page_number;
+  decoded_page_t *last_page;
+
+public:
+  decode_cache_t();
+  ~decode_cache_t();
+  decode_cache_t(const decode_cache_t &) = delete;
+  decode_cache_t &operator=(const decode_cache_t &) = delete;
+
+  decoded_t *lookup(uint32_t pc);
+  decoded_t *insert(uint32_t pc, uint32_t raw);
+  void invalidatePage(uint32_t address);
+  void invalidateAll();
+};
+
 #endif
\ No newline at end of file
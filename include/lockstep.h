@@ -0,0 +1,64 @@
+#pragma once
+
+#ifndef _RVSIM_LOCKSTEP_H
+#define _RVSIM_LOCKSTEP_H
+
+#include <stdint.h>
+
+#include <memory>
+
+#include "elf_loader.h"
+#include "memory.h"
+#include "reference.h"
+#include "registers.h"
+#include "trace.h"
+
+// Últimos PCs mostrados quando a execução diverge
+#define LOCKSTEP_HISTORY 8
+
+// Execução em lockstep: depois de cada instrução aposentada o estado
+// arquitetural do processador é comparado com uma referência, e a simulação
+// para na primeira diferença com um resumo do estado.
+//
+// A referência é o interpretador independente (reference_model_t), que
+// compara o PC, os 32 registradores, o fim do programa e os bytes escritos na
+// memória, ou um log de commits gravado com --trace, que compara o PC, a
+// instrução, o valor escrito em rd e o endereço acessado de cada registro.
+class lockstep_t {
+private:
+  std::unique_ptr<reference_model_t> reference;
+  trace_reader_t log;
+  bool use_log;
+  // Instruções já comparadas
+  uint64_t instret;
+  uint32_t history[LOCKSTEP_HISTORY];
+  bool diverged;
+
+  void remember(uint32_t pc);
+  void printHeader(uint32_t pc, uint32_t raw, const char *reason);
+  void printHistory();
+
+public:
+  lockstep_t();
+
+  // Referência executando o próprio ELF (strict segue a especificação nos
+  // pontos em que o simulador diverge dela, ver reference.h)
+  void useReference(const elf_file_t &elf, bool strict);
+  // Referência lida de um trace gravado (retorna false se não abrir)
+  bool useLog(const char *path);
+  bool usesLog() const { return use_log; }
+
+  // Copia o PC e os registradores iniciais do processador para a referência
+  void start(uint32_t pc, const registers_t &registers, uint64_t pinstret);
+
+  // Executa uma instrução na referência e compara com o estado do processador
+  // depois da instrução. Retornam false (e imprimem o resumo) na divergência.
+  bool check(uint32_t pc, uint32_t raw, uint32_t next_pc,
+             const registers_t &registers, bool running, memory_t &memory);
+  bool checkRecord(const trace_record_t &record, bool running);
+
+  bool hasDiverged() const { return diverged; }
+  uint64_t getChecked() const { return instret; }
+};
+
+#endif
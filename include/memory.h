@@ -5,41 +5,154 @@
 
 #include <cstdint>
 
-#include <map>
+#include <string>
+#include <vector>
+
+#include "cache.h"
 
 // Tamanho da memória 
 #define MEM_SIZE          UINT32_MAX
 
-#define L1_MISS_PENALTY   10
-#define L2_MISS_PENALTY   50
-#define L3_MISS_PENALTY   100
+// Memória paginada: páginas de 4 KiB alocadas no primeiro acesso de escrita e
+// indexadas por uma tabela de dois níveis (10 + 10 bits do número da página)
+#define PAGE_BITS         12
+#define PAGE_SIZE         (1u << PAGE_BITS)
+#define PAGE_MASK         (PAGE_SIZE - 1)
+#define PT_BITS           10
+#define PT_ENTRIES        (1u << PT_BITS)
+
+class checkpoint_writer_t;
+class checkpoint_reader_t;
+class stats_registry_t;
 
 // foward declaration pro dinero
 typedef struct d4_cache_struct d4cache;
 
 enum class ACCESS_TYPE { INSTRUCTION, DATA, LOAD};
 
+// Modelo de cache usado na simulação: o nativo (cache.h), o dineroIV (quando
+// compilado com RVSIM_DINERO) ou os dois em paralelo, comparando os resultados
+enum class CACHE_BACKEND { NATIVE, DINERO, CROSSCHECK };
+
+// Segundo nível da tabela de páginas. Páginas compartilhadas pertencem a
+// outra memória (a imagem do programa) e são copiadas na primeira escrita
+struct page_table_t {
+  uint8_t *pages[PT_ENTRIES];
+  bool shared[PT_ENTRIES];
+};
+
 class memory_t {
 private:
   uint32_t add_offset;
-  std::map<uint32_t, uint8_t> memory_map;
-  std::map<std::string, d4cache *> caches;
-  int li_misses = 0;
-  int ld_misses = 0;
-  int l2_misses = 0;
-  int l2_misses_from_instructions = 0;
-  int l3_misses = 0;
-  int l3_misses_from_instructions = 0;
+  page_table_t *page_dir[PT_ENTRIES];
+  // Cache de uma entrada com a última página acessada
+  uint32_t last_page_number;
+  uint8_t *last_page;
+  bool last_page_writable;
+  // Páginas com instruções decodificadas e as que foram escritas desde então
+  std::vector<bool> code_pages;
+  std::vector<uint32_t> code_writes;
+  bool use_caches;
+  CACHE_BACKEND backend;
+  cache_config_t cache_config;
+  cache_hierarchy_t hierarchy;
+  // Índice na hierarquia (também usado nas máscaras de miss) dos níveis onde
+  // começam os acessos de instrução e de dados, e o tamanho de seus blocos
+  int l1i, l1d;
+  uint32_t l1i_block, l1d_block;
+  // Por nível: penalidade de miss e misses contados (total e de instruções)
+  uint32_t miss_penalty[CACHE_MAX_LEVELS];
+  int level_misses[CACHE_MAX_LEVELS];
+  int level_misses_from_instructions[CACHE_MAX_LEVELS];
+  // Níveis que falharam no último acesso às caches
+  uint32_t last_miss_mask;
+  // Caches do dineroIV, com o mesmo índice da hierarquia nativa, e o total de
+  // misses de cada uma após o último acesso
+  d4cache *d4_memory;
+  void setupDinero(int level);
+  d4cache *d4_caches[CACHE_MAX_LEVELS];
+  double d4_misses[CACHE_MAX_LEVELS];
+  uint64_t crosscheck_accesses = 0;
+  uint64_t crosscheck_divergences = 0;
+
+  uint8_t *getPage(uint32_t address, bool allocate);
+  void checkCodeWrite(uint32_t address);
+  void copyToPages(uint32_t address, const uint8_t *buffer, uint32_t size);
+  void copyFromPages(uint32_t address, uint8_t *buffer, uint32_t size);
+  // Modela um acesso de size bytes nas caches e retorna as penalidades
+  uint32_t cacheAccess(uint32_t address, uint32_t size, ACCESS_TYPE type,
+                       bool write);
+  // Acesso a um único bloco no dineroIV, retorna a máscara de misses
+  uint32_t dineroAccess(uint32_t address, uint32_t size, ACCESS_TYPE type,
+                        bool write);
 
 public:
-  memory_t();
+  memory_t(bool model_caches = true,
+           CACHE_BACKEND cache_backend = CACHE_BACKEND::NATIVE,
+           const cache_config_t &config = cache_config_t::defaults());
+  ~memory_t();
+  memory_t(const memory_t &) = delete;
+  memory_t &operator=(const memory_t &) = delete;
 
   uint32_t writeMem(uint32_t address, uint8_t value, ACCESS_TYPE type);
+  uint32_t writeMem16(uint32_t address, uint16_t value, ACCESS_TYPE type);
+  uint32_t writeMem32(uint32_t address, uint32_t value, ACCESS_TYPE type);
+  uint32_t writeBlock(uint32_t address, const uint8_t *buffer, uint32_t size,
+                      ACCESS_TYPE type);
+  // Zera a faixa sem passar pelas caches. Páginas nunca escritas já são lidas
+  // como 0 e continuam sem ser alocadas.
+  void zeroBlock(uint32_t address, uint32_t size);
   uint32_t readMem(uint32_t address, uint8_t *value, ACCESS_TYPE type);
+  uint32_t readMem16(uint32_t address, uint16_t *value, ACCESS_TYPE type);
+  uint32_t readMem32(uint32_t address, uint32_t *value, ACCESS_TYPE type);
+  uint32_t readBlock(uint32_t address, uint8_t *buffer, uint32_t size,
+                     ACCESS_TYPE type);
+
+  // Passa a usar as páginas de image (sem copiá-las) como conteúdo inicial da
+  // memória, que precisa estar vazia. As páginas são copiadas na primeira
+  // escrita, então image não pode ser alterada nem destruída enquanto esta
+  // memória existir, mas pode ser compartilhada por várias memórias (inclusive
+  // em threads diferentes).
+  void shareImage(const memory_t &image);
+
+  // Endereços das páginas alocadas, em ordem, e o conteúdo de uma página sem
+  // alocá-la (nullptr se nunca foi escrita), usados nos checkpoints
+  std::vector<uint32_t> getPageAddresses() const;
+  const uint8_t *peekPage(uint32_t address) const;
+  // Conteúdo aquecido das caches nativas. loadCacheState retorna false (sem
+  // alterar as caches) se a hierarquia gravada for diferente desta ou se o
+  // bloco estiver incompleto.
+  void saveCacheState(checkpoint_writer_t &writer) const;
+  bool loadCacheState(checkpoint_reader_t &reader);
+
+  void watchCodePage(uint32_t address);
+  bool popCodeWrite(uint32_t *address);
 
   uint32_t getTotalSize();
   void printCacheMisses();
   void printd4log();
+  void printCrossCheck();
+
+  // Misses de cada nível da hierarquia de caches
+  int getCacheLevels();
+  const std::string &getCacheName(int level);
+  int getCacheMisses(int level);
+  // Níveis onde começam os acessos de instruções e de dados
+  int getInstructionLevel() const { return l1i; }
+  int getDataLevel() const { return l1d; }
+  const cache_level_config_t &getCacheConfig(int level) const {
+    return cache_config.levels[level];
+  }
+  // Máscara (um bit por nível) dos misses do último acesso às caches
+  uint32_t getLastMissMask() const { return last_miss_mask; }
+  // Acessos ao nível contados pelas caches nativas (0 só com o dineroIV)
+  uint64_t getCacheAccesses(int level);
+  // Registra os misses de cada nível (e, nas caches nativas, os acessos,
+  // prefetches e writebacks) com os nomes cache.<nível>.*
+  void registerStats(stats_registry_t &registry);
+
+  // Indica se o simulador foi compilado com suporte ao dineroIV
+  static bool hasDinero();
 };
 
 #endif
\ No newline at end of file
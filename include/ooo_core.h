@@ -0,0 +1,197 @@
+#pragma once
+
+#ifndef _RVSIM_OOO_CORE_H
+#define _RVSIM_OOO_CORE_H
+
+#include <stdint.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "cache.h"
+#include "isa.h"
+#include "stats.h"
+#include "trace.h"
+
+class processor_t;
+
+// Modelo de temporização: a fórmula por instrução (processor_t::stepTimed)
+// ou o núcleo fora de ordem simulado ciclo a ciclo
+enum class CORE { ANALYTIC, OOO };
+
+// Parâmetros do núcleo fora de ordem (--core-opt=<chave>=<valor>). A largura
+// de busca, alocação e commit é a janela (number_i) e as unidades funcionais
+// são as mesmas do modelo analítico.
+struct ooo_config_t {
+  uint32_t rob_entries = 64;
+  // Filas de issue de cada classe de unidade funcional (ALU, AGU e BRU)
+  uint32_t iq_entries[3] = {16, 8, 8};
+  // Registradores físicos: os 32 arquiteturais mais os disponíveis para
+  // renomeação
+  uint32_t physical_registers = 96;
+  uint32_t lsq_entries = 16;
+  // Instruções buscadas esperando a alocação
+  uint32_t fetch_queue = 16;
+  // Loads podem ser enviados antes de stores anteriores com endereço ainda
+  // desconhecido (refeitos se um deles escrever nos mesmos bytes)
+  bool spec_loads = true;
+
+  // "<chave>=<valor>": rob, iq.alu, iq.agu, iq.bru, prf, lsq, fetch_queue e
+  // spec_loads (0 ou 1)
+  bool set(const std::string &option, std::string &error);
+  bool validate(std::string &error) const;
+};
+
+// Contadores do núcleo fora de ordem (exportados como ooo.* em --stats)
+struct ooo_stats_t {
+  // Ciclos em que a alocação parou por falta de recurso (o primeiro que
+  // faltou na instrução mais antiga)
+  uint64_t dispatch_rob = 0;
+  uint64_t dispatch_iq[3] = {0, 0, 0};
+  uint64_t dispatch_lsq = 0;
+  uint64_t dispatch_prf = 0;
+  // Ciclos sem busca: miss na cache de instruções, salto com predição errada
+  // ainda não resolvido e fila de busca cheia
+  uint64_t fetch_icache = 0;
+  uint64_t fetch_mispredict = 0;
+  uint64_t fetch_queue_full = 0;
+  // Instruções enviadas a cada classe de unidade funcional
+  uint64_t issued[3] = {0, 0, 0};
+  // Ciclos em que um load pronto esperou um store anterior (endereço ainda
+  // desconhecido ou sobreposição parcial)
+  uint64_t load_store_waits = 0;
+  // Loads que receberam o dado de um store da LSQ, enviados antes de stores
+  // com endereço desconhecido e refeitos porque um desses stores escrevia nos
+  // mesmos bytes
+  uint64_t loads_forwarded = 0;
+  uint64_t loads_speculative = 0;
+  uint64_t order_violations = 0;
+  // Misses de dados que aproveitaram um miss pendente da mesma linha, ciclos
+  // de acessos esperando um MSHR livre em cada nível e ciclos com o commit
+  // parado por um store sem MSHR
+  uint64_t mshr_merges = 0;
+  uint64_t mshr_waits[CACHE_MAX_LEVELS] = {0};
+  uint64_t store_commit_waits = 0;
+  // Soma da ocupação do ROB a cada ciclo (média = soma / ciclos)
+  uint64_t rob_occupancy = 0;
+};
+
+// Instrução em voo. A semântica é executada na busca (o front-end segue o
+// caminho correto e o estado arquitetural do processador fica à frente do
+// commit); o núcleo modela só o tempo de cada estágio.
+struct ooo_entry_t {
+  decoded_t ins;
+  uint32_t next_pc;
+  // Acesso à memória: endereço, tamanho e ciclos extras do acesso às caches
+  uint32_t mem_address;
+  uint32_t mem_size;
+  uint32_t mem_cycles;
+  // Níveis de cache em que o acesso falhou (um bit por nível)
+  uint32_t miss_mask;
+  bool is_load, is_store;
+  // Ordem de busca, usada entre loads e stores na LSQ
+  uint64_t seq;
+  // Store que forneceu o dado do load (0 quando veio da cache) e load
+  // enviado antes de um store com endereço desconhecido
+  uint64_t forward_seq;
+  bool speculative;
+  // Predição errada (perfil) e salto que ainda segura a busca
+  bool mispredicted;
+  bool blocks_fetch;
+  // Registradores físicos: destino, mapeamento anterior do destino (liberado
+  // no commit) e fontes (0 é o x0, sempre pronto)
+  uint32_t dest, old_dest;
+  uint32_t src[2];
+  // Ciclos de busca, em que pode ser alocada, de alocação, de issue e de
+  // conclusão (OOO_NEVER enquanto não aconteceram)
+  uint64_t fetched, decoded, dispatched, issued, completed;
+  // Perfil e trace (gravados no commit)
+  uint32_t icache_misses, dcache_misses;
+  trace_record_t record;
+};
+
+#define OOO_NEVER UINT64_MAX
+
+// Entradas da tabela de loads que já violaram a ordem com um store (indexada
+// pelo PC); esses loads não são mais enviados especulativamente
+#define OOO_WAIT_TABLE 1024
+
+// Miss pendente em um nível de cache: linha (endereço / tamanho da linha) e
+// ciclo em que o dado chega
+struct ooo_mshr_t {
+  uint32_t line;
+  uint64_t ready;
+};
+
+class ooo_core_t {
+private:
+  processor_t &p;
+  ooo_config_t config;
+  uint32_t width;
+  uint64_t now;
+  // Commits já feitos no ciclo atual (run pode parar no meio do ciclo)
+  uint32_t committed_in_cycle;
+  uint64_t last_commit;
+
+  // ROB circular
+  std::vector<ooo_entry_t> rob;
+  uint32_t rob_head, rob_count;
+  std::deque<ooo_entry_t> fetch_queue;
+  // Filas de issue e LSQ guardam índices do ROB, em ordem de idade
+  std::vector<uint32_t> iq[3];
+  std::deque<uint32_t> lsq;
+  // Ciclo a partir do qual cada registrador físico está disponível
+  std::vector<uint64_t> ready_at;
+  uint32_t rename_map[32];
+  std::vector<uint32_t> free_list;
+  uint64_t next_seq;
+
+  // MSHRs de cada nível de cache (livres quando ready <= now) e loads
+  // marcados por violações de ordem
+  std::vector<ooo_mshr_t> mshrs[CACHE_MAX_LEVELS];
+  int data_level;
+  uint32_t line_bits[CACHE_MAX_LEVELS];
+  std::vector<bool> wait_table;
+  // Load mais antigo que leu antes de um store anterior que escreve nos
+  // mesmos bytes, refeito no fim do issue (OOO_NEVER quando não há)
+  uint64_t squash_seq;
+
+  // Front-end: ciclo da próxima busca, salto com predição errada ainda não
+  // resolvido (a busca para até ele executar) e fim do programa
+  uint64_t fetch_cycle;
+  bool fetch_blocked;
+  bool fetch_done;
+
+  ooo_stats_t ooo_stats;
+
+  uint32_t robIndex(uint32_t position) const {
+    return (rob_head + position) % config.rob_entries;
+  }
+  uint32_t robPosition(uint32_t index) const {
+    return (index + config.rob_entries - rob_head) % config.rob_entries;
+  }
+  bool loadMayIssue(uint32_t index, uint32_t *latency);
+  void storeIssued(uint32_t index);
+  ooo_mshr_t *findMSHR(int level, uint32_t address);
+  bool allocateMSHRs(uint32_t miss_mask, uint32_t address, uint64_t ready);
+  void squash();
+  uint32_t commit(uint64_t budget);
+  void issue();
+  void dispatch();
+  void fetch();
+  void fetchOne(ooo_entry_t &entry, bool *stop);
+
+public:
+  ooo_core_t(processor_t &processor, const ooo_config_t &pconfig,
+             uint32_t pwidth);
+
+  void registerStats(stats_registry_t &registry);
+  // Simula ciclos até commitar max_instructions instruções, até o total de
+  // ciclos chegar a cycle_limit ou até o programa terminar e o pipeline
+  // esvaziar. Retorna as instruções commitadas.
+  uint64_t run(uint64_t max_instructions, uint64_t cycle_limit);
+  const ooo_stats_t &getStats() const { return ooo_stats; }
+};
+
+#endif
@@ -3,18 +3,31 @@
 #ifndef _RVSIM_PROCESSOR_H
 #define _RVSIM_PROCESSOR_H
 
-#include <sstream>
+#include <memory>
+#include <string>
 #include <vector>
 #include <queue>
 
+#include "checkpoint.h"
 #include "isa.h"
 #include "memory.h"
+#include "ooo_core.h"
 #include "registers.h"
+#include "stats.h"
+
+class trace_writer_t;
+class profiler_t;
+class lockstep_t;
+struct trace_record_t;
+class checkpoint_writer_t;
+class checkpoint_reader_t;
 
 //============== GSHARE
 class gshare_t {
 private:
   int size, btb_size;
+  // Bits do PC acima do índice da BTB formam a tag
+  int btb_tag_shift;
   int history, l_history;
   int table_entries;
   std::vector<bool> h_table;
@@ -32,6 +45,12 @@ public:
   
   int getHits();
   int getErrors();
+
+  // Tabelas e históricos para os checkpoints. loadState retorna false (sem
+  // alterar nada) se o estado foi gravado com outro tamanho de tabela ou BTB
+  // ou se o bloco estiver incompleto.
+  void saveState(checkpoint_writer_t &writer) const;
+  bool loadState(checkpoint_reader_t &reader);
 };
 
 //============== PROCESSOR
@@ -51,11 +70,108 @@ public:
 #define CICLES_AGU              1
 #define CICLES_BRU              1
 
+// Resultado de uma execução, usado no relatório final e nas varreduras
+struct sim_stats_t {
+  uint64_t instructions = 0;
+  uint64_t cycles = 0;
+  int gshare_hits = 0;
+  int gshare_errors = 0;
+};
+
+// Atribuição dos ciclos perdidos pelo modelo de temporização, por causa. Os
+// ciclos de cada causa são os que a instrução esperou além do mínimo do
+// estágio (as causas podem se sobrepor entre instruções da mesma janela).
+struct stall_stats_t {
+  // Misses na cache de instruções: ciclos do miss na própria busca, ciclos
+  // excedentes somados às buscas seguintes e atraso do bloco seguinte
+  uint64_t icache_misses = 0;
+  uint64_t icache_miss_cycles = 0;
+  uint64_t icache_excess_cycles = 0;
+  uint64_t icache_block_cycles = 0;
+  // Dependências de dados (RAW) em rs1/rs2
+  uint64_t raw_stalls = 0;
+  uint64_t raw_cycles = 0;
+  stats_histogram_t raw_histogram;
+  // Unidade funcional ocupada (indexado por FU: ALU, AGU e BRU)
+  uint64_t fu_stalls[3] = {0, 0, 0};
+  uint64_t fu_cycles[3] = {0, 0, 0};
+  // Porta de memória ocupada e ciclos extras dos acessos à memória
+  uint64_t mem_port_stalls = 0;
+  uint64_t mem_port_cycles = 0;
+  stats_histogram_t mem_latency_histogram;
+  // Predições erradas e ciclos entre o início previsto da próxima instrução
+  // e o reinício da busca
+  uint64_t mispredictions = 0;
+  uint64_t flush_cycles = 0;
+  stats_histogram_t flush_histogram;
+  // Commits atrasados por já terem sido feitos number_i commits no ciclo
+  uint64_t commit_width_cycles = 0;
+  // Ocupação: ciclos em que as unidades funcionais e a porta de memória
+  // ficaram reservadas
+  uint64_t fu_busy_cycles[3] = {0, 0, 0};
+  uint64_t mem_port_busy_cycles = 0;
+};
+
+// Motor de execução funcional: o switch de Execute é a referência, o threaded
+// traduz blocos básicos em vetores de handlers
+enum class ENGINE { SWITCH, THREADED };
+
+// Configuração de uma instância do processador. Todo o estado da simulação
+// pertence à instância, então várias podem executar ao mesmo tempo (cada uma
+// com a sua memória)
+struct processor_config_t {
+  int window = 1;
+  int gshare_bits = 10;
+  int btb_entries = 1024;
+  // Executa só a semântica das instruções, sem temporização nem caches
+  bool functional = false;
+  ENGINE engine = ENGINE::SWITCH;
+  // Modelo de temporização (só na execução temporizada)
+  CORE core = CORE::ANALYTIC;
+  ooo_config_t ooo;
+  // Impressões (normalmente lidas das variáveis de ambiente PRINT_*)
+  bool print_instruction_log = false;
+  bool print_instruction_end_time = false;
+  bool print_cache_misses = false;
+  bool print_gshare = false;
+  bool print_final_state = false;
+
+  // Liga as impressões cujas variáveis de ambiente valem "true"
+  void readEnvironment();
+};
+
+// Estado do modelo de temporização que passa de uma instrução para a próxima
+struct timing_state_t {
+  uint32_t previous_finish = 0;
+  uint32_t linst = 0;
+  uint32_t commit_count = 0;
+  uint32_t instruction_start = 0;
+  uint32_t instruction_block = 1;
+  uint32_t excendent_cycles = 0;
+  uint32_t block_busy = 0;
+};
+
+// Estado do processador lido de um checkpoint (readState), ainda não aplicado
+struct processor_state_t {
+  uint32_t pc = 0;
+  uint32_t registers[32] = {0};
+  bool warm = false;
+  // Blocos do gshare e do pipeline, dentro do corpo do checkpoint
+  checkpoint_reader_t predictor{nullptr, 0};
+  checkpoint_reader_t pipeline{nullptr, 0};
+};
+
 class processor_t {
+  friend class block_engine_t;
+  friend class ooo_core_t;
+
 private:
-  gshare_t *gshare;
+  processor_config_t config;
+  std::unique_ptr<gshare_t> gshare;
+  // A memória e o trace pertencem a quem cria o processador
   memory_t *memory;
   registers_t registers;
+  decode_cache_t decoder;
   std::vector<uint32_t> ALU;
   std::vector<uint32_t> AGU;
   std::vector<uint32_t> BRU;
@@ -64,18 +180,95 @@ private:
   int PC;
   bool running;
   int number_i;
+  ENGINE engine;
+  bool functional;
+  // Trace binário de execução (nullptr quando desligado)
+  trace_writer_t *trace;
+  // Perfil por PC do programa simulado (nullptr quando desligado)
+  profiler_t *profiler;
+  // Comparação com a referência a cada instrução (nullptr quando desligada)
+  lockstep_t *lockstep;
+  sim_stats_t stats;
+  stall_stats_t stalls;
+  // Estatísticas exportadas (--stats): contadores do processador e da memória
+  stats_registry_t registry;
+  // Instruções executadas antes do checkpoint restaurado e o ciclo em que a
+  // execução restaurada começou (os ciclos do relatório são contados a partir
+  // dele)
+  uint64_t restored_instret;
+  uint32_t cycles_base;
+  timing_state_t timing;
+  // Núcleo fora de ordem (nullptr com o modelo analítico)
+  std::unique_ptr<ooo_core_t> ooo;
   // variaveis relacionadas a branching
   bool branched = false, is_branch;
   bool wrote;
 
+  // Registra os contadores do modelo de temporização e os da memória
+  void registerStats();
+
 public:
-  processor_t(memory_t *mem, uint32_t entry_point, int n_ins, int b_gshare);
+  processor_t(memory_t *mem, uint32_t entry_point,
+              const processor_config_t &pconfig);
+  processor_t(const processor_t &) = delete;
+  processor_t &operator=(const processor_t &) = delete;
 
+  void setTrace(trace_writer_t *writer);
+  void setProfiler(profiler_t *pprofiler);
+  // Deve ser chamado depois de restaurar um checkpoint: a referência começa
+  // do estado atual
+  void setLockstep(lockstep_t *plockstep);
+  // Executa o programa até o fim com o motor configurado
   void executeProgram();
+  // Executam no máximo max_instructions instruções (ou até o total de ciclos
+  // avançar max_cycles) com o motor switch e retornam quantas executaram
+  uint64_t run(uint64_t max_instructions);
+  uint64_t runCycles(uint64_t max_cycles);
+  // Aquecimento funcional: executa até max_instructions instruções passando
+  // pelas caches e pelo gshare, sem o modelo de temporização (os ciclos não
+  // avançam). Só na execução temporizada com o modelo analítico.
+  uint64_t warm(uint64_t max_instructions);
+  bool isRunning() const { return running; }
+  void stepTimed();
+  void stepFunctional();
+  void executeBlocks();
+  // Imprime o relatório da última execução
+  void printReport();
+  void printFinalState();
+  const sim_stats_t &getStats() const { return stats; }
+  const stall_stats_t &getStalls() const { return stalls; }
+  const stats_registry_t &getRegistry() const { return registry; }
+  uint32_t getPC() const { return PC; }
+  uint32_t readRegister(int reg) { return registers.readReg(reg); }
+  // Instruções executadas desde o início do programa (inclusive as anteriores
+  // ao checkpoint restaurado)
+  uint64_t getInstret() const { return restored_instret + stats.instructions; }
+
+  // Estado arquitetural (PC e registradores) e, com warm, o do gshare e o do
+  // modelo de temporização (instantes em que as unidades funcionais, a
+  // memória e os registradores ficam livres). Sem ele a execução restaurada
+  // começa com o pipeline vazio. readState só lê o estado (retorna false se
+  // o corpo estiver incompleto); loadState o aplica e retorna false se alguma
+  // parte do estado aquecido foi gravada com outra configuração (ou está
+  // incompleta) e não pôde ser usada.
+  void saveState(checkpoint_writer_t &writer, bool warm) const;
+  static bool readState(checkpoint_reader_t &reader, bool warm,
+                        processor_state_t &state);
+  bool loadState(const processor_state_t &state, uint64_t instret);
 
   uint32_t Fetch(uint32_t *raw_instruction, uint32_t *pc_address, bool *pred);
-  uint32_t Execute(instruction_t ins, char *disassembly);
-  std::string doLogLine(instruction_t ins, char *disassembly);
+  decoded_t Decode(uint32_t raw_instruction, uint32_t pc_address);
+  void syncDecodeCache();
+  uint32_t Execute(const decoded_t &ins);
+  std::string doLogLine(const decoded_t &ins);
+  void traceRecord(const decoded_t &ins, uint32_t mem_address,
+                   uint32_t started, uint32_t finished, uint32_t commited,
+                   trace_record_t *record);
+  void traceInstruction(const decoded_t &ins, uint32_t mem_address,
+                        uint32_t started, uint32_t finished,
+                        uint32_t commited);
+  // Compara a instrução aposentada com a referência e para na divergência
+  void checkLockstep(const decoded_t &ins, uint32_t mem_address);
   uint32_t getNextALU(uint32_t time);
   uint32_t getNextAGU(uint32_t time);
   uint32_t getNextBRU(uint32_t time);
@@ -0,0 +1,104 @@
+#pragma once
+
+#ifndef _RVSIM_PROFILER_H
+#define _RVSIM_PROFILER_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "elf_loader.h"
+#include "isa.h"
+
+// Capacidade inicial das tabelas (potência de 2). Elas dobram quando passam
+// da metade, então a alocação só acontece no crescimento, não por evento.
+#define PROFILE_INITIAL_ENTRIES   4096
+// Chamadas aninhadas além disso são contadas na função do limite
+#define PROFILE_MAX_DEPTH         512
+
+// Contadores de uma instrução do programa
+struct profile_entry_t {
+  uint32_t pc;
+  uint32_t raw;
+  uint64_t count;
+  uint64_t cycles;
+  uint64_t icache_misses;
+  uint64_t dcache_misses;
+  uint64_t mispredictions;
+};
+
+// Nó da árvore de chamadas: a função chamada a partir do nó pai
+struct profile_node_t {
+  uint32_t parent;
+  uint32_t function;
+  uint64_t cycles;
+  uint64_t count;
+};
+
+// Perfil do programa simulado. Cada instrução acumula a contagem dinâmica,
+// os ciclos atribuídos a ela (o quanto o commit avançou), os misses nas
+// caches L1 de instruções e de dados e as predições erradas, em uma tabela
+// hash aberta indexada pelo PC. Uma pilha de chamadas paralela (JAL/JALR com
+// rd = ra ou t0 são chamadas, JALR para ra com rd = zero são retornos) forma
+// a árvore de chamadas do arquivo de pilhas agregadas (folded stacks, o
+// formato dos flamegraphs).
+class profiler_t {
+private:
+  std::vector<profile_entry_t> entries;
+  uint32_t used;
+  std::vector<profile_node_t> nodes;
+  // Filhos de cada nó: chave (pai, função) -> índice em nodes + 1 (0 = vazio)
+  std::vector<uint64_t> child_keys;
+  std::vector<uint32_t> child_nodes;
+  uint32_t child_used;
+  std::vector<uint32_t> stack;
+  // Chamadas além de PROFILE_MAX_DEPTH ainda abertas (não empilhadas)
+  uint32_t overflow_depth;
+  uint32_t current;
+  uint32_t entry_point;
+  symbol_table_t symbols;
+
+  profile_entry_t &find(uint32_t pc);
+  void growEntries();
+  uint32_t child(uint32_t parent, uint32_t function);
+  void growChildren();
+  // Início da função que contém address (o próprio address sem símbolos)
+  uint32_t functionOf(uint32_t address) const;
+  std::string functionName(uint32_t function) const;
+
+public:
+  explicit profiler_t(uint32_t pentry_point);
+
+  // Lê os símbolos para agregar por função. Sem a tabela de símbolos o perfil
+  // continua por instrução e as funções são identificadas pelo endereço.
+  bool loadSymbols(const elf_file_t &elf);
+  bool hasSymbols() const { return !symbols.empty(); }
+
+  // Chamado no fim de cada instrução, com o PC seguinte já resolvido
+  void record(const decoded_t &ins, uint32_t next_pc, uint32_t cycles,
+              uint32_t icache_misses, uint32_t dcache_misses,
+              bool mispredicted) {
+    profile_entry_t &entry = find(ins.address);
+    entry.raw = ins.raw;
+    entry.count++;
+    entry.cycles += cycles;
+    entry.icache_misses += icache_misses;
+    entry.dcache_misses += dcache_misses;
+    entry.mispredictions += mispredicted;
+    nodes[current].count++;
+    nodes[current].cycles += cycles;
+    if (ins.op == MNE::JAL || ins.op == MNE::JALR)
+      callOrReturn(ins, next_pc);
+  }
+  void callOrReturn(const decoded_t &ins, uint32_t next_pc);
+
+  // Relatório com as funções e as top instruções mais caras (em ciclos, ou
+  // em contagem quando não há temporização)
+  void writeReport(FILE *out, unsigned top) const;
+  // Uma linha "main;f;g ciclos" por caminho da árvore de chamadas
+  void writeFolded(FILE *out) const;
+};
+
+#endif
@@ -0,0 +1,70 @@
+#pragma once
+
+#ifndef _RVSIM_REFERENCE_H
+#define _RVSIM_REFERENCE_H
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "elf_loader.h"
+
+// Interpretador RV32IM mínimo usado como referência na execução em lockstep.
+// É independente do resto do simulador: decodifica os bits da instrução
+// diretamente, tem a sua própria memória (páginas esparsas carregadas dos
+// PT_LOAD do ELF) e não usa o decode_cache_t, o memory_t nem o registers_t.
+//
+// Por padrão ele reproduz os desvios conhecidos do simulador em relação à
+// especificação, para que o lockstep valide os motores (e não acuse sempre
+// as mesmas diferenças):
+//   - LUI e AUIPC copiam o bit 30 do imediato para o bit 31;
+//   - SH grava só os 12 bits menores de rs2;
+//   - MULH, MULHU e MULHSU calculam o produto em 32 bits (a parte alta é a
+//     extensão de sinal do produto em MULH e 0 nos outros);
+//   - REM calcula o resto sem sinal;
+//   - SRA e SRAI com deslocamento 0 resultam em 0;
+//   - JALR não zera o bit 0 do destino;
+//   - instruções desconhecidas não fazem nada.
+// No modo estrito todos seguem a especificação (e uma instrução desconhecida
+// é uma divergência). Em ambos os modos os contadores (RDCYCLE...) não
+// escrevem rd, já que o simulador não os implementa.
+class reference_model_t {
+private:
+  std::unordered_map<uint32_t, std::unique_ptr<uint8_t[]>> pages;
+  uint32_t last_page_number;
+  uint8_t *last_page;
+  bool strict;
+
+  uint8_t *page(uint32_t address);
+  uint8_t load8(uint32_t address);
+  void store8(uint32_t address, uint8_t value);
+  uint32_t load(uint32_t address, int size);
+  void store(uint32_t address, uint32_t value, int size);
+  void write(int reg, uint32_t value) {
+    if (reg != 0)
+      x[reg] = value;
+  }
+
+public:
+  uint32_t pc;
+  uint32_t x[32];
+  bool running;
+  // Instrução desconhecida encontrada no modo estrito
+  bool illegal;
+  // Último acesso de escrita (size = 0 se a instrução não escreveu)
+  uint32_t store_address;
+  int store_size;
+
+  explicit reference_model_t(bool pstrict);
+
+  // Copia os segmentos do programa para a memória da referência
+  void load(const elf_file_t &elf);
+  // Executa uma instrução
+  void step();
+  // Lê a memória da referência (para comparar as escritas)
+  uint8_t peek(uint32_t address) { return load8(address); }
+};
+
+#endif
@@ -15,9 +15,9 @@ public:
   registers_t();
 
   void writeReg(unsigned int reg, uint32_t value);
-  uint32_t readReg(unsigned int reg);
+  uint32_t readReg(unsigned int reg) const;
   void setUW(unsigned int reg, uint32_t time);
-  uint32_t checkUW(unsigned int reg);
+  uint32_t checkUW(unsigned int reg) const;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,115 @@
+#pragma once
+
+#ifndef _RVSIM_API_H
+#define _RVSIM_API_H
+
+/*
+ * API C do simulador (librvsim). Permite carregar um ELF, executar um número
+ * de instruções ou de ciclos, ler registradores e memória e coletar as
+ * estatísticas sem criar um processo por simulação.
+ *
+ * As funções que podem falhar retornam 0 em caso de sucesso e -1 em caso de
+ * erro, com a mensagem disponível em rvsim_last_error. Cada rvsim_t é
+ * independente: instâncias diferentes podem ser usadas em threads diferentes,
+ * mas uma mesma instância não pode ser usada por duas threads ao mesmo tempo.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Incrementada a cada mudança incompatível na API */
+#define RVSIM_API_VERSION 2
+
+#define RVSIM_MAX_CACHE_LEVELS 8
+
+/* Modelos de temporização (rvsim_options_t.core) */
+#define RVSIM_CORE_ANALYTIC 0
+#define RVSIM_CORE_OOO 1
+
+typedef struct rvsim rvsim_t;
+
+typedef struct {
+  int window;         /* janela de instruções */
+  int gshare_bits;    /* bits do histórico do gshare */
+  int btb_entries;    /* entradas da BTB (potência de 2) */
+  int functional;     /* 1: executa sem temporização nem caches */
+  int core;           /* RVSIM_CORE_ANALYTIC ou RVSIM_CORE_OOO */
+  /* Arquivo com a hierarquia de caches (NULL para a padrão) */
+  const char *cache_config;
+} rvsim_options_t;
+
+typedef struct {
+  uint64_t instructions;
+  uint64_t cycles;
+  int gshare_hits;
+  int gshare_errors;
+  int cache_levels;
+  int cache_misses[RVSIM_MAX_CACHE_LEVELS];
+} rvsim_stats_t;
+
+int rvsim_api_version(void);
+
+/* Preenche as opções com os valores padrão do simulador */
+void rvsim_default_options(rvsim_options_t *options);
+
+/* Cria uma instância; options pode ser NULL (valores padrão). Retorna NULL se
+ * a configuração for inválida. */
+rvsim_t *rvsim_create(const rvsim_options_t *options);
+/* Como rvsim_create, mas em caso de erro copia a mensagem para error (até
+ * error_size bytes, sempre terminada em '\0'; error pode ser NULL). */
+rvsim_t *rvsim_create2(const rvsim_options_t *options, char *error,
+                       size_t error_size);
+void rvsim_destroy(rvsim_t *sim);
+
+/* Aplica uma opção da hierarquia de caches (<nível>.<chave>=<valor>, como
+ * --cache-opt). Só pode ser usada antes de rvsim_load_elf. */
+int rvsim_set_cache_option(rvsim_t *sim, const char *option);
+
+/* Carrega o programa e posiciona o PC no entry point */
+int rvsim_load_elf(rvsim_t *sim, const char *path);
+
+/* Executam no máximo n instruções (ou até o total de ciclos avançar n) e
+ * retornam quantas instruções foram executadas */
+uint64_t rvsim_step(rvsim_t *sim, uint64_t instructions);
+uint64_t rvsim_step_cycles(rvsim_t *sim, uint64_t cycles);
+/* Executa até o fim do programa */
+uint64_t rvsim_run(rvsim_t *sim);
+/* 1 enquanto o programa não executou SCALL/SBREAK */
+int rvsim_running(const rvsim_t *sim);
+
+/* Grava o estado atual (e, na execução temporizada, o do gshare, das caches e
+ * do pipeline) em um checkpoint. rvsim_restore_checkpoint aplica um checkpoint
+ * do mesmo programa logo depois de rvsim_load_elf (antes de executar qualquer
+ * instrução; depois disso ela retorna -1). Com RVSIM_CORE_OOO o estado
+ * arquitetural fica à frente do commit e o checkpoint não pode ser gravado,
+ * só restaurado. */
+int rvsim_save_checkpoint(rvsim_t *sim, const char *path);
+int rvsim_restore_checkpoint(rvsim_t *sim, const char *path);
+
+uint32_t rvsim_get_pc(const rvsim_t *sim);
+uint32_t rvsim_read_reg(const rvsim_t *sim, int reg);
+int rvsim_read_mem(rvsim_t *sim, uint32_t address, void *buffer,
+                   uint32_t size);
+/* Escritas sobre código já executado valem a partir da próxima instrução. */
+int rvsim_write_mem(rvsim_t *sim, uint32_t address, const void *buffer,
+                    uint32_t size);
+
+void rvsim_get_stats(const rvsim_t *sim, rvsim_stats_t *stats);
+/* Acrescenta ao arquivo uma linha JSON com todo o registro de estatísticas
+ * (inclusive a atribuição dos stalls). Com descriptions != 0, a linha inclui
+ * também a descrição de cada estatística. */
+int rvsim_write_stats(rvsim_t *sim, const char *path, int descriptions);
+/* Nome do nível de cache (índice de cache_misses), NULL se não existir */
+const char *rvsim_cache_name(const rvsim_t *sim, int level);
+
+const char *rvsim_last_error(const rvsim_t *sim);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
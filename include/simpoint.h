@@ -0,0 +1,51 @@
+#pragma once
+
+#ifndef _RVSIM_SIMPOINT_H
+#define _RVSIM_SIMPOINT_H
+
+#include <stdint.h>
+
+#include <string>
+
+#include "cache.h"
+#include "memory.h"
+#include "processor.h"
+
+// Simulação amostrada no estilo SimPoint: uma execução funcional coleta os
+// vetores de blocos básicos (BBV) de cada intervalo de instruções, os
+// intervalos são agrupados por k-means e só alguns intervalos de cada grupo
+// (o representante, mais próximo do centro, e outros sorteados) são simulados
+// com o modelo temporizado, a partir de um checkpoint e depois de um
+// aquecimento funcional das caches e do gshare. O CPI estimado é a média dos
+// grupos ponderada pelas instruções de cada um, e a variação do CPI dentro dos
+// grupos dá o erro padrão da estimativa.
+#define SIMPOINT_WARMUP_INTERVAL UINT64_MAX
+
+struct simpoint_options_t {
+  // Instruções por intervalo
+  uint64_t interval = 100000;
+  // Máximo de grupos (o número usado é escolhido pelo BIC)
+  unsigned max_clusters = 10;
+  // Intervalos simulados com temporização por grupo (o representante e os
+  // sorteados para o erro padrão; com 1 não há estimativa de erro)
+  unsigned cluster_samples = 3;
+  // Instruções executadas antes de cada intervalo só para aquecer as caches e
+  // o gshare, sem temporização (SIMPOINT_WARMUP_INTERVAL: o tamanho do
+  // intervalo)
+  uint64_t warmup = SIMPOINT_WARMUP_INTERVAL;
+  // Dimensões da projeção aleatória dos BBVs
+  unsigned dimensions = 15;
+  // Threads das simulações detalhadas
+  unsigned jobs = 1;
+  // Executa também o programa inteiro para conferir o erro real da estimativa
+  bool verify = false;
+};
+
+// Retorna o código de saída do simulador. image é o programa já carregado
+// (compartilhado por todas as simulações) e elf_path identifica os checkpoints.
+int runSimPoint(const char *elf_path, const memory_t &image,
+                uint32_t entry_point, const processor_config_t &config,
+                const cache_config_t &cache_config,
+                const simpoint_options_t &options);
+
+#endif
@@ -0,0 +1,70 @@
+#pragma once
+
+#ifndef _RVSIM_STATS_H
+#define _RVSIM_STATS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Histograma com buckets em potências de 2: o bucket i conta os valores em
+// [2^(i-1), 2^i), o bucket 0 conta os zeros
+#define STATS_HISTOGRAM_BUCKETS 33
+
+class stats_histogram_t {
+private:
+  uint64_t buckets[STATS_HISTOGRAM_BUCKETS];
+  uint64_t count, sum, max;
+
+public:
+  stats_histogram_t() { reset(); }
+
+  void sample(uint32_t value) {
+    int bucket = value == 0 ? 0 : 32 - __builtin_clz(value);
+    buckets[bucket]++;
+    count++;
+    sum += value;
+    if (value > max)
+      max = value;
+  }
+
+  void reset();
+  uint64_t getCount() const { return count; }
+  uint64_t getSum() const { return sum; }
+  uint64_t getMax() const { return max; }
+  uint64_t getBucket(int bucket) const { return buckets[bucket]; }
+};
+
+// Registro das estatísticas de uma simulação. Os contadores e histogramas
+// pertencem aos componentes (que só os incrementam no laço de simulação); o
+// registro guarda o nome, a descrição e como ler cada um para exportar.
+// Os nomes usam pontos para a hierarquia (stall.raw.cycles).
+class stats_registry_t {
+private:
+  struct entry_t {
+    std::string name;
+    std::string description;
+    const uint64_t *counter;
+    std::function<double()> value;
+    const stats_histogram_t *histogram;
+  };
+  std::vector<entry_t> entries;
+
+public:
+  void addCounter(const std::string &name, const std::string &description,
+                  const uint64_t *counter);
+  // Valor calculado na exportação (CPI, contadores de outras estruturas)
+  void addValue(const std::string &name, const std::string &description,
+                std::function<double()> value);
+  void addHistogram(const std::string &name, const std::string &description,
+                    const stats_histogram_t *histogram);
+
+  // Escreve todas as estatísticas como um objeto JSON em uma linha. Com
+  // descriptions, inclui também o objeto "descriptions" (nome -> descrição).
+  void writeJSON(FILE *out, bool descriptions) const;
+};
+
+#endif
@@ -0,0 +1,61 @@
+#pragma once
+
+#ifndef _RVSIM_SWEEP_H
+#define _RVSIM_SWEEP_H
+
+#include <stdint.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cache.h"
+#include "memory.h"
+#include "ooo_core.h"
+
+// Grade de parâmetros de uma varredura. Cada configuração é uma combinação de
+// um valor de cada dimensão (produto cartesiano).
+struct sweep_grid_t {
+  std::vector<uint32_t> windows;
+  std::vector<uint32_t> gshare_bits;
+  std::vector<uint32_t> btb_sizes;
+  // Dimensões da hierarquia de caches: a opção (<nível>.<chave>, como em
+  // --cache-opt) e os valores que ela assume
+  std::vector<std::pair<std::string, std::vector<std::string>>> cache_options;
+
+  // Lê a grade de um arquivo com uma dimensão por linha:
+  //   window = 1,2,4,8
+  //   gshare = 6,8,10
+  //   btb = 256,1024
+  //   cache.L1d.size = 16K,32K,64K
+  bool load(const std::string &path, std::string &error);
+  size_t getPoints() const;
+};
+
+struct sweep_options_t {
+  // Número de threads de simulação
+  unsigned jobs = 1;
+  // Arquivo de saída (.json para JSON, CSV nos demais casos), vazio para a
+  // saída padrão em CSV
+  std::string output;
+  // Modelo de temporização de todas as configurações
+  CORE core = CORE::ANALYTIC;
+  ooo_config_t ooo;
+};
+
+// Simula todas as configurações da grade sobre a mesma imagem do programa
+// (carregada uma única vez) e escreve uma linha por configuração, na ordem da
+// grade. Retorna o código de saída do simulador.
+int runSweep(const sweep_grid_t &grid, const cache_config_t &base_config,
+             const memory_t &image, uint32_t entry_point,
+             const sweep_options_t &options);
+
+// Verificação de reentrância: simula instances configurações em série e
+// depois todas ao mesmo tempo (uma thread por instância), e compara os
+// resultados (estatísticas, misses, PC e registradores finais), que devem ser
+// idênticos. Retorna 0 se forem.
+int runConcurrencyCheck(const cache_config_t &cache_config,
+                        const memory_t &image, uint32_t entry_point,
+                        unsigned instances);
+
+#endif
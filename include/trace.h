@@ -0,0 +1,96 @@
+#pragma once
+
+#ifndef _RVSIM_TRACE_H
+#define _RVSIM_TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <vector>
+
+// Trace binário de execução: um cabeçalho seguido de um registro por
+// instrução executada. Sem compressão cada registro tem tamanho fixo
+// (TRACE_RECORD_SIZE bytes, little-endian); com compressão os campos são
+// gravados como varints da diferença em relação ao registro anterior.
+#define TRACE_MAGIC           "RVSTRACE"
+#define TRACE_VERSION         1
+#define TRACE_RECORD_SIZE     29
+#define TRACE_BUFFER_SIZE     (1 << 20)
+
+// Flags do cabeçalho
+#define TRACE_F_COMPRESSED    0x1
+#define TRACE_F_TIMING        0x2 // registros possuem os ciclos de cada estágio
+
+// Flags de cada registro
+#define TRACE_R_RD_WRITTEN    0x1
+#define TRACE_R_MEM_ACCESS    0x2
+
+struct trace_record_t {
+  uint32_t pc;
+  uint32_t raw;
+  uint32_t rd_value;
+  uint32_t mem_address;
+  uint32_t started;
+  uint32_t finished;
+  uint32_t committed;
+  uint8_t flags;
+};
+
+class trace_writer_t {
+private:
+  FILE *file;
+  uint32_t header_flags;
+  std::vector<uint8_t> buffer;
+  size_t used;
+  trace_record_t last;
+  uint64_t records;
+  // Alguma escrita no arquivo falhou (disco cheio, erro de E/S)
+  bool failed;
+
+  void put(const uint8_t *data, size_t size);
+  void putVarint(uint64_t value);
+  void flush();
+
+public:
+  trace_writer_t();
+  ~trace_writer_t();
+  trace_writer_t(const trace_writer_t &) = delete;
+  trace_writer_t &operator=(const trace_writer_t &) = delete;
+
+  bool open(const char *path, bool compressed, bool timing);
+  void write(const trace_record_t &record);
+  // Retorna false se alguma escrita do trace falhou
+  bool close();
+  uint64_t getRecords();
+};
+
+class trace_reader_t {
+private:
+  FILE *file;
+  uint32_t header_flags;
+  std::vector<uint8_t> buffer;
+  size_t used, filled;
+  trace_record_t last;
+  // O arquivo terminou (ou falhou) no meio de um registro
+  bool truncated;
+
+  bool get(uint8_t *data, size_t size);
+  bool getVarint(uint64_t *value);
+  bool readRecord(trace_record_t *record);
+
+public:
+  trace_reader_t();
+  ~trace_reader_t();
+  trace_reader_t(const trace_reader_t &) = delete;
+  trace_reader_t &operator=(const trace_reader_t &) = delete;
+
+  bool open(const char *path);
+  // Retorna false no fim do trace. Se o último registro estiver incompleto,
+  // isTruncated passa a retornar true.
+  bool next(trace_record_t *record);
+  bool isTruncated();
+  bool hasTiming();
+  void close();
+};
+
+#endif
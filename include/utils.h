@@ -70,14 +70,15 @@ enum class MNE : int {
   RDTIME,
   RDTIMEH,
   RDINSTRRET,
-  RDINSTRETH
+  RDINSTRETH,
+  // Codificação desconhecida, executada como NOP
+  ILLEGAL
 };
 
 uint32_t sign_extend(uint32_t value, uint8_t bits);
-
-uint32_t get_elf_entry(std::vector<uint8_t> mem, uint32_t address, uint32_t size);
-
-std::vector<uint8_t> elf_by_byte(const char * elf_file);
+// Remove os espaços e quebras de linha do começo e do fim (arquivos de
+// configuração)
+std::string trim(const std::string &text);
 
 extern std::string register_name[32];
 extern std::string status_register_name[6];
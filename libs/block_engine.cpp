@@ -0,0 +1,434 @@
+#include "block_engine.h"
+
+#include "lockstep.h"
+#include "processor.h"
+#include "utils.h"
+
+// Os blocos são executados apenas funcionalmente: os acessos à memória não
+// passam pelas caches e nenhuma temporização é calculada.
+#define MEM_ACCESS ACCESS_TYPE::LOAD
+
+static inline uint32_t rs1Value(block_engine_t &e, const decoded_t &ins) {
+  return e.regs->readReg(ins.rs1);
+}
+
+static inline uint32_t rs2Value(block_engine_t &e, const decoded_t &ins) {
+  return e.regs->readReg(ins.rs2);
+}
+
+// Uma escrita numa página de código interrompe o bloco logo após o store para
+// que os blocos traduzidos sejam descartados
+static void checkCodeWrite(block_engine_t &e, const decoded_t &ins) {
+  uint32_t page_address;
+  bool code_written = false;
+  while (e.memory->popCodeWrite(&page_address))
+    code_written = true;
+  if (code_written) {
+    *e.PC = ins.address + 4;
+    e.flush_pending = true;
+    e.exit_block = true;
+  }
+}
+
+//============== HANDLERS
+// Cada handler reproduz exatamente a semântica de processor_t::Execute
+
+static void opLUI(block_engine_t &e, const decoded_t &ins) {
+  e.regs->writeReg(ins.rd, ins.imm);
+}
+
+static void opAUIPC(block_engine_t &e, const decoded_t &ins) {
+  e.regs->writeReg(ins.rd, ins.imm + ins.address);
+}
+
+static void opLB(block_engine_t &e, const decoded_t &ins) {
+  uint8_t mem_value;
+  e.memory->readMem(rs1Value(e, ins) + ins.imm, &mem_value, MEM_ACCESS);
+  e.regs->writeReg(ins.rd, sign_extend(mem_value, 8));
+}
+
+static void opLH(block_engine_t &e, const decoded_t &ins) {
+  uint16_t mem_value;
+  e.memory->readMem16(rs1Value(e, ins) + ins.imm, &mem_value, MEM_ACCESS);
+  e.regs->writeReg(ins.rd, sign_extend(mem_value, 16));
+}
+
+static void opLW(block_engine_t &e, const decoded_t &ins) {
+  uint32_t value;
+  e.memory->readMem32(rs1Value(e, ins) + ins.imm, &value, MEM_ACCESS);
+  e.regs->writeReg(ins.rd, value);
+}
+
+static void opLBU(block_engine_t &e, const decoded_t &ins) {
+  uint8_t mem_value;
+  e.memory->readMem(rs1Value(e, ins) + ins.imm, &mem_value, MEM_ACCESS);
+  e.regs->writeReg(ins.rd, mem_value);
+}
+
+static void opLHU(block_engine_t &e, const decoded_t &ins) {
+  uint16_t mem_value;
+  e.memory->readMem16(rs1Value(e, ins) + ins.imm, &mem_value, MEM_ACCESS);
+  e.regs->writeReg(ins.rd, mem_value);
+}
+
+static void opSB(block_engine_t &e, const decoded_t &ins) {
+  e.memory->writeMem(rs1Value(e, ins) + ins.imm, rs2Value(e, ins) & 255,
+                     MEM_ACCESS);
+  checkCodeWrite(e, ins);
+}
+
+static void opSH(block_engine_t &e, const decoded_t &ins) {
+  e.memory->writeMem16(rs1Value(e, ins) + ins.imm, rs2Value(e, ins) & 4095,
+                       MEM_ACCESS);
+  checkCodeWrite(e, ins);
+}
+
+static void opSW(block_engine_t &e, const decoded_t &ins) {
+  e.memory->writeMem32(rs1Value(e, ins) + ins.imm, rs2Value(e, ins),
+                       MEM_ACCESS);
+  checkCodeWrite(e, ins);
+}
+
+static void opSLL(block_engine_t &e, const decoded_t &ins) {
+  uint32_t shammt = rs2Value(e, ins) & 31;
+  e.regs->writeReg(ins.rd, rs1Value(e, ins) << shammt);
+}
+
+static void opSLLI(block_engine_t &e, const decoded_t &ins) {
+  e.regs->writeReg(ins.rd, rs1Value(e, ins) << ins.shammt);
+}
+
+static void opSRL(block_engine_t &e, const decoded_t &ins) {
+  uint32_t shammt = rs2Value(e, ins) & 31;
+  e.regs->writeReg(ins.rd, rs1Value(e, ins) >> shammt);
+}
+
+static void opSRLI(block_engine_t &e, const decoded_t &ins) {
+  e.regs->writeReg(ins.rd, rs1Value(e, ins) >> ins.shammt);
+}
+
+static void opSRA(block_engine_t &e, const decoded_t &ins) {
+  uint32_t shammt = rs2Value(e, ins) & 31;
+  uint32_t value = rs1Value(e, ins) >> shammt;
+  e.regs->writeReg(ins.rd, sign_extend(value, 32 - shammt));
+}
+
+static void opSRAI(block_engine_t &e, const decoded_t &ins) {
+  int32_t value = rs1Value(e, ins) >> ins.shammt;
+  e.regs->writeReg(ins.rd, sign_extend(value, 32 - ins.shammt));
+}
+
+static void opADD(block_engine_t &e, const decoded_t &ins) {
+  e.regs->writeReg(ins.rd, (int32_t)rs1Value(e, ins) + (int32_t)rs2Value(e, ins));
+}
+
+static void opADDI(block_engine_t &e, const decoded_t &ins) {
+  e.regs->writeReg(ins.rd, (int32_t)rs1Value(e, ins) + ins.imm);
+}
+
+static void opSUB(block_engine_t &e, const decoded_t &ins) {
+  e.regs->writeReg(ins.rd, (int32_t)rs1Value(e, ins) - (int32_t)rs2Value(e, ins));
+}
+
+static void opXOR(block_engine_t &e, const decoded_t &ins) {
+  e.regs->writeReg(ins.rd, rs1Value(e, ins) ^ rs2Value(e, ins));
+}
+
+static void opXORI(block_engine_t &e, const decoded_t &ins) {
+  e.regs->writeReg(ins.rd, rs1Value(e, ins) ^ ins.imm);
+}
+
+static void opOR(block_engine_t &e, const decoded_t &ins) {
+  e.regs->writeReg(ins.rd, rs1Value(e, ins) | rs2Value(e, ins));
+}
+
+static void opORI(block_engine_t &e, const decoded_t &ins) {
+  e.regs->writeReg(ins.rd, rs1Value(e, ins) | ins.imm);
+}
+
+static void opAND(block_engine_t &e, const decoded_t &ins) {
+  e.regs->writeReg(ins.rd, rs1Value(e, ins) & rs2Value(e, ins));
+}
+
+static void opANDI(block_engine_t &e, const decoded_t &ins) {
+  e.regs->writeReg(ins.rd, rs1Value(e, ins) & ins.imm);
+}
+
+static void opSLT(block_engine_t &e, const decoded_t &ins) {
+  bool lessthan = (int32_t)rs1Value(e, ins) < (int32_t)rs2Value(e, ins);
+  e.regs->writeReg(ins.rd, lessthan ? 1 : 0);
+}
+
+static void opSLTI(block_engine_t &e, const decoded_t &ins) {
+  bool lessthan = (int32_t)rs1Value(e, ins) < ins.imm;
+  e.regs->writeReg(ins.rd, lessthan ? 1 : 0);
+}
+
+static void opSLTU(block_engine_t &e, const decoded_t &ins) {
+  bool lessthan = rs1Value(e, ins) < rs2Value(e, ins);
+  e.regs->writeReg(ins.rd, lessthan ? 1 : 0);
+}
+
+static void opSLTIU(block_engine_t &e, const decoded_t &ins) {
+  bool lessthan = rs1Value(e, ins) < (uint32_t)ins.imm;
+  e.regs->writeReg(ins.rd, lessthan ? 1 : 0);
+}
+
+// Os saltos só alteram o PC quando tomados, o PC já aponta para a instrução
+// seguinte ao bloco
+static void opBEQ(block_engine_t &e, const decoded_t &ins) {
+  if (rs1Value(e, ins) == rs2Value(e, ins))
+    *e.PC = (uint32_t)((int32_t)ins.address + ins.imm);
+}
+
+static void opBNE(block_engine_t &e, const decoded_t &ins) {
+  if (rs1Value(e, ins) != rs2Value(e, ins))
+    *e.PC = (uint32_t)((int32_t)ins.address + ins.imm);
+}
+
+static void opBLT(block_engine_t &e, const decoded_t &ins) {
+  if ((int32_t)rs1Value(e, ins) < (int32_t)rs2Value(e, ins))
+    *e.PC = (uint32_t)((int32_t)ins.address + ins.imm);
+}
+
+static void opBGE(block_engine_t &e, const decoded_t &ins) {
+  if ((int32_t)rs1Value(e, ins) >= (int32_t)rs2Value(e, ins))
+    *e.PC = (uint32_t)((int32_t)ins.address + ins.imm);
+}
+
+static void opBLTU(block_engine_t &e, const decoded_t &ins) {
+  if (rs1Value(e, ins) < rs2Value(e, ins))
+    *e.PC = (uint32_t)((int32_t)ins.address + ins.imm);
+}
+
+static void opBGEU(block_engine_t &e, const decoded_t &ins) {
+  if (rs1Value(e, ins) >= rs2Value(e, ins))
+    *e.PC = (uint32_t)((int32_t)ins.address + ins.imm);
+}
+
+static void opJAL(block_engine_t &e, const decoded_t &ins) {
+  e.regs->writeReg(ins.rd, ins.address + 4);
+  *e.PC = (uint32_t)((int32_t)ins.address + ins.imm);
+}
+
+static void opJALR(block_engine_t &e, const decoded_t &ins) {
+  // Assim como no Execute, rd é escrito antes de ler rs1
+  e.regs->writeReg(ins.rd, ins.address + 4);
+  *e.PC = (uint32_t)((int32_t)rs1Value(e, ins) + ins.imm);
+}
+
+static void opNOP(block_engine_t &, const decoded_t &) {}
+
+static void opFENCEI(block_engine_t &e, const decoded_t &) {
+  e.flush_pending = true;
+  e.exit_block = true;
+}
+
+static void opSTOP(block_engine_t &e, const decoded_t &) {
+  *e.running = false;
+  e.exit_block = true;
+}
+
+static void opMUL(block_engine_t &e, const decoded_t &ins) {
+  int64_t res = (int32_t)rs1Value(e, ins) * (int32_t)rs2Value(e, ins);
+  e.regs->writeReg(ins.rd, (int32_t)res);
+}
+
+static void opMULH(block_engine_t &e, const decoded_t &ins) {
+  int64_t res = (int32_t)rs1Value(e, ins) * (int32_t)rs2Value(e, ins);
+  e.regs->writeReg(ins.rd, (int32_t)(res >> 32));
+}
+
+static void opMULHU(block_engine_t &e, const decoded_t &ins) {
+  int64_t res = rs1Value(e, ins) * rs2Value(e, ins);
+  e.regs->writeReg(ins.rd, (uint32_t)(res >> 32));
+}
+
+static void opMULHSU(block_engine_t &e, const decoded_t &ins) {
+  int64_t res = (int32_t)rs1Value(e, ins) * (uint32_t)rs2Value(e, ins);
+  e.regs->writeReg(ins.rd, (uint32_t)(res >> 32));
+}
+
+static void opDIV(block_engine_t &e, const decoded_t &ins) {
+  e.regs->writeReg(ins.rd, (int32_t)rs1Value(e, ins) / (int32_t)rs2Value(e, ins));
+}
+
+static void opDIVU(block_engine_t &e, const decoded_t &ins) {
+  e.regs->writeReg(ins.rd, rs1Value(e, ins) / rs2Value(e, ins));
+}
+
+static void opREM(block_engine_t &e, const decoded_t &ins) {
+  uint32_t value = rs1Value(e, ins) % rs2Value(e, ins);
+  // Mesmo teste de sinal do Execute (feito sobre o índice de rs1)
+  uint32_t dividend_sign = (ins.rs1 >> 31);
+  int32_t value_s = (dividend_sign == 1) ? value * -1 : value;
+  e.regs->writeReg(ins.rd, value_s);
+}
+
+static void opREMU(block_engine_t &e, const decoded_t &ins) {
+  e.regs->writeReg(ins.rd, rs1Value(e, ins) % rs2Value(e, ins));
+}
+
+op_handler_t block_engine_t::getHandler(MNE op) {
+  switch (op) {
+  case MNE::LUI: return opLUI;
+  case MNE::AUIPC: return opAUIPC;
+  case MNE::LB: return opLB;
+  case MNE::LH: return opLH;
+  case MNE::LW: return opLW;
+  case MNE::LBU: return opLBU;
+  case MNE::LHU: return opLHU;
+  case MNE::SB: return opSB;
+  case MNE::SH: return opSH;
+  case MNE::SW: return opSW;
+  case MNE::SLL: return opSLL;
+  case MNE::SLLI: return opSLLI;
+  case MNE::SRL: return opSRL;
+  case MNE::SRLI: return opSRLI;
+  case MNE::SRA: return opSRA;
+  case MNE::SRAI: return opSRAI;
+  case MNE::ADD: return opADD;
+  case MNE::ADDI: return opADDI;
+  case MNE::SUB: return opSUB;
+  case MNE::XOR: return opXOR;
+  case MNE::XORI: return opXORI;
+  case MNE::OR: return opOR;
+  case MNE::ORI: return opORI;
+  case MNE::AND: return opAND;
+  case MNE::ANDI: return opANDI;
+  case MNE::SLT: return opSLT;
+  case MNE::SLTI: return opSLTI;
+  case MNE::SLTU: return opSLTU;
+  case MNE::SLTIU: return opSLTIU;
+  case MNE::BEQ: return opBEQ;
+  case MNE::BNE: return opBNE;
+  case MNE::BLT: return opBLT;
+  case MNE::BGE: return opBGE;
+  case MNE::BLTU: return opBLTU;
+  case MNE::BGEU: return opBGEU;
+  case MNE::JAL: return opJAL;
+  case MNE::JALR: return opJALR;
+  case MNE::FENCEI: return opFENCEI;
+  case MNE::SCALL: return opSTOP;
+  case MNE::SBREAK: return opSTOP;
+  case MNE::MUL: return opMUL;
+  case MNE::MULH: return opMULH;
+  case MNE::MULHU: return opMULHU;
+  case MNE::MULHSU: return opMULHSU;
+  case MNE::DIV: return opDIV;
+  case MNE::DIVU: return opDIVU;
+  case MNE::REM: return opREM;
+  case MNE::REMU: return opREMU;
+  default: return opNOP; // FENCE, contadores e desconhecidas não fazem nada
+  }
+}
+
+/***************************************************************************
+Block engine
+***************************************************************************/
+block_engine_t::block_engine_t(processor_t &p) {
+  regs = &p.registers;
+  memory = p.memory;
+  PC = &p.PC;
+  running = &p.running;
+  lockstep = p.lockstep;
+  exit_block = false;
+  flush_pending = false;
+}
+
+block_t *block_engine_t::translate(uint32_t pc) {
+  block_t *block = new block_t();
+  block->start = pc;
+  block->successor[0] = block->successor[1] = nullptr;
+  block->successor_pc[0] = block->successor_pc[1] = 0;
+  memory->watchCodePage(pc);
+
+  uint32_t address = pc;
+  while (true) {
+    uint32_t raw;
+    memory->readMem32(address, &raw, MEM_ACCESS);
+    block_op_t op;
+    op.ins = decodeInstruction(raw, address);
+    op.handler = getHandler(op.ins.op);
+    block->ops.push_back(op);
+    address += 4;
+
+    // Saltos, fim do programa e FENCE.I terminam o bloco
+    if (op.ins.fu == FU::BRU || op.ins.op == MNE::SCALL ||
+        op.ins.op == MNE::SBREAK || op.ins.op == MNE::FENCEI)
+      break;
+    // Um bloco nunca atravessa páginas, assim a invalidação é por página
+    if ((address & PAGE_MASK) == 0 ||
+        block->ops.size() == BLOCK_MAX_INSTRUCTIONS)
+      break;
+  }
+  block->next_pc = address;
+  return block;
+}
+
+block_t *block_engine_t::getBlock(uint32_t pc) {
+  std::unique_ptr<block_t> &block = blocks[pc];
+  if (!block)
+    block.reset(translate(pc));
+  return block.get();
+}
+
+void block_engine_t::flush() {
+  blocks.clear();
+  flush_pending = false;
+}
+
+uint64_t block_engine_t::run() {
+  uint64_t executed = 0;
+  block_t *block = getBlock(*PC);
+  while (*running) {
+    // Se nenhum salto for tomado, o próximo bloco começa logo após este
+    *PC = block->next_pc;
+    exit_block = false;
+    const block_op_t *ops = block->ops.data();
+    size_t count = block->ops.size();
+    size_t i = 0;
+    while (i < count) {
+      ops[i].handler(*this, ops[i].ins);
+      i++;
+      // Dentro do bloco o PC só é atualizado pelos saltos
+      if (lockstep != nullptr) {
+        uint32_t next_pc =
+            (i < count && !exit_block) ? ops[i].ins.address : *PC;
+        if (!lockstep->check(ops[i - 1].ins.address, ops[i - 1].ins.raw,
+                             next_pc, *regs, *running, *memory)) {
+          *running = false;
+          break;
+        }
+      }
+      if (exit_block)
+        break;
+    }
+    executed += i;
+
+    if (!*running)
+      break;
+    uint32_t next_pc = *PC;
+    if (flush_pending) {
+      // Os blocos traduzidos (inclusive o atual) não são mais válidos
+      flush();
+      block = getBlock(next_pc);
+      continue;
+    }
+
+    // Segue o encadeamento do bloco, traduzindo o sucessor se necessário
+    if (block->successor[0] != nullptr && block->successor_pc[0] == next_pc) {
+      block = block->successor[0];
+    } else if (block->successor[1] != nullptr &&
+               block->successor_pc[1] == next_pc) {
+      block = block->successor[1];
+    } else {
+      block_t *next = getBlock(next_pc);
+      int slot = (block->successor[0] == nullptr) ? 0 : 1;
+      block->successor[slot] = next;
+      block->successor_pc[slot] = next_pc;
+      block = next;
+    }
+  }
+  return executed;
+}
@@ -0,0 +1,303 @@
+#include "cache.h"
+
+#include <cerrno>
+#include <cstdlib>
+
+#include <fstream>
+
+#include "checkpoint.h"
+#include "utils.h"
+
+// Aceita números com os sufixos K e M (potências de 1024). O valor é
+// calculado em 64 bits e recusado se não couber em 32.
+static bool parseSize(const std::string &value, uint32_t &result) {
+  // O strtoull aceitaria espaços e sinal na frente
+  if (value.empty() || value[0] < '0' || value[0] > '9')
+    return false;
+  char *end;
+  errno = 0;
+  uint64_t number = strtoull(value.c_str(), &end, 10);
+  if (errno == ERANGE)
+    return false;
+  std::string suffix = end;
+  int shift = 0;
+  if (suffix == "K" || suffix == "k")
+    shift = 10;
+  else if (suffix == "M" || suffix == "m")
+    shift = 20;
+  else if (!suffix.empty())
+    return false;
+  if (number > (UINT32_MAX >> shift))
+    return false;
+  result = number << shift;
+  return true;
+}
+
+static bool parseBool(const std::string &value, bool &result) {
+  if (value == "true" || value == "1" || value == "yes") {
+    result = true;
+    return true;
+  }
+  if (value == "false" || value == "0" || value == "no") {
+    result = false;
+    return true;
+  }
+  return false;
+}
+
+static bool isPowerOf2(uint32_t value) {
+  return value != 0 && (value & (value - 1)) == 0;
+}
+
+cache_config_t cache_config_t::defaults() {
+  cache_config_t config;
+  cache_level_config_t level;
+
+  level.name = "L1i";
+  level.line_size = 1u << 7;
+  level.size = 1u << 15;
+  level.ways = 4;
+  level.read_only = true;
+  level.miss_penalty = 10;
+  level.next = "L2";
+  config.levels.push_back(level);
+
+  level.name = "L1d";
+  level.read_only = false;
+  config.levels.push_back(level);
+
+  level.name = "L2";
+  level.line_size = 1u << 10;
+  level.size = 1u << 18;
+  level.miss_penalty = 50;
+  level.next = "L3";
+  config.levels.push_back(level);
+
+  level.name = "L3";
+  level.size = 1u << 23;
+  level.miss_penalty = 100;
+  level.next = "";
+  config.levels.push_back(level);
+
+  config.instruction_level = "L1i";
+  config.data_level = "L1d";
+  return config;
+}
+
+int cache_config_t::find(const std::string &name) const {
+  for (size_t i = 0; i < levels.size(); i++)
+    if (levels[i].name == name)
+      return i;
+  return -1;
+}
+
+bool cache_config_t::setKey(const std::string &level, const std::string &key,
+                            const std::string &value, std::string &error) {
+  // Chaves globais da hierarquia
+  if (level.empty()) {
+    if (key == "instruction")
+      instruction_level = value;
+    else if (key == "data")
+      data_level = value;
+    else {
+      error = "chave desconhecida: " + key;
+      return false;
+    }
+    return true;
+  }
+
+  // Um nível desconhecido é criado com os valores padrão
+  int index = find(level);
+  if (index < 0) {
+    cache_level_config_t config;
+    config.name = level;
+    levels.push_back(config);
+    index = levels.size() - 1;
+  }
+  cache_level_config_t &config = levels[index];
+  bool ok = true;
+  if (key == "line")
+    ok = parseSize(value, config.line_size);
+  else if (key == "size")
+    ok = parseSize(value, config.size);
+  else if (key == "ways")
+    ok = parseSize(value, config.ways);
+  else if (key == "miss_penalty")
+    ok = parseSize(value, config.miss_penalty);
+  else if (key == "mshrs")
+    ok = parseSize(value, config.mshrs) && config.mshrs > 0;
+  else if (key == "replacement") {
+    if (value == "lru")
+      config.replacement = REPLACEMENT::LRU;
+    else if (value == "plru")
+      config.replacement = REPLACEMENT::PLRU;
+    else if (value == "random")
+      config.replacement = REPLACEMENT::RANDOM;
+    else
+      ok = false;
+  } else if (key == "prefetch") {
+    if (value == "none")
+      config.prefetch = PREFETCH::NONE;
+    else if (value == "next")
+      config.prefetch = PREFETCH::NEXT_LINE;
+    else
+      ok = false;
+  } else if (key == "write") {
+    if (value == "through")
+      config.write_back = false;
+    else if (value == "back")
+      config.write_back = true;
+    else
+      ok = false;
+  } else if (key == "allocate")
+    ok = parseBool(value, config.write_allocate);
+  else if (key == "read_only")
+    ok = parseBool(value, config.read_only);
+  else if (key == "next")
+    config.next = (value == "memory") ? "" : value;
+  else {
+    error = "chave desconhecida: " + level + "." + key;
+    return false;
+  }
+  if (!ok)
+    error = "valor inválido para " + level + "." + key + ": " + value;
+  return ok;
+}
+
+bool cache_config_t::set(const std::string &option, std::string &error) {
+  size_t equal = option.find('=');
+  if (equal == std::string::npos) {
+    error = "opção sem valor: " + option;
+    return false;
+  }
+  std::string name = trim(option.substr(0, equal));
+  std::string value = trim(option.substr(equal + 1));
+  size_t dot = name.find('.');
+  if (dot == std::string::npos)
+    return setKey("", name, value, error);
+  return setKey(name.substr(0, dot), name.substr(dot + 1), value, error);
+}
+
+bool cache_config_t::load(const std::string &path, std::string &error) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    error = "não foi possível abrir " + path;
+    return false;
+  }
+  std::string line, section;
+  int line_number = 0;
+  while (std::getline(file, line)) {
+    line_number++;
+    size_t comment = line.find_first_of("#;");
+    if (comment != std::string::npos)
+      line = line.substr(0, comment);
+    line = trim(line);
+    if (line.empty())
+      continue;
+    if (line.front() == '[' && line.back() == ']') {
+      section = trim(line.substr(1, line.size() - 2));
+      // A seção sozinha já cria o nível
+      if (find(section) < 0) {
+        cache_level_config_t config;
+        config.name = section;
+        levels.push_back(config);
+      }
+      continue;
+    }
+    size_t equal = line.find('=');
+    if (equal == std::string::npos) {
+      error = path + ":" + std::to_string(line_number) + ": linha inválida";
+      return false;
+    }
+    if (!setKey(section, trim(line.substr(0, equal)),
+                trim(line.substr(equal + 1)), error)) {
+      error = path + ":" + std::to_string(line_number) + ": " + error;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool cache_config_t::validate(std::string &error) const {
+  if (levels.empty()) {
+    error = "nenhum nível de cache definido";
+    return false;
+  }
+  if (levels.size() > CACHE_MAX_LEVELS) {
+    error = "no máximo " + std::to_string(CACHE_MAX_LEVELS) +
+            " níveis de cache são suportados";
+    return false;
+  }
+  if (find(instruction_level) < 0 || find(data_level) < 0) {
+    error = "instruction e data devem indicar níveis existentes";
+    return false;
+  }
+  for (const cache_level_config_t &level : levels) {
+    if (!isPowerOf2(level.line_size) || !isPowerOf2(level.size) ||
+        level.ways == 0 ||
+        (uint64_t)level.line_size * level.ways > level.size) {
+      error = level.name + ": line e size devem ser potências de 2 e o "
+                           "tamanho deve comportar ao menos um conjunto";
+      return false;
+    }
+    if (level.replacement == REPLACEMENT::PLRU &&
+        (!isPowerOf2(level.ways) || level.ways > 32)) {
+      error = level.name + ": plru exige ways potência de 2 (até 32)";
+      return false;
+    }
+    if (!level.next.empty() && find(level.next) < 0) {
+      error = level.name + ": nível abaixo inexistente: " + level.next;
+      return false;
+    }
+    // Seguindo os níveis abaixo a memória deve ser alcançada sem repetições
+    std::string next = level.next;
+    for (size_t steps = 0; !next.empty(); steps++) {
+      if (steps >= levels.size()) {
+        error = level.name + ": a hierarquia possui um ciclo";
+        return false;
+      }
+      next = levels[find(next)].next;
+    }
+  }
+  return true;
+}
+
+void cache_t::saveGeometry(checkpoint_writer_t &writer) const {
+  writer.putVarint(sets);
+  writer.putVarint(ways);
+  writer.putVarint(lg2_line);
+  writer.putU8((uint8_t)policy);
+}
+
+bool cache_t::sameGeometry(checkpoint_reader_t &reader) const {
+  uint64_t saved_sets = reader.getVarint();
+  uint64_t saved_ways = reader.getVarint();
+  uint64_t saved_line = reader.getVarint();
+  uint8_t saved_policy = reader.getU8();
+  return reader.good() && saved_sets == sets && saved_ways == ways &&
+         saved_line == lg2_line && saved_policy == (uint8_t)policy;
+}
+
+void cache_t::saveState(checkpoint_writer_t &writer) const {
+  for (size_t line = 0; line < tags.size(); line++) {
+    writer.putVarint(tags[line]);
+    writer.putU8(dirty[line]);
+    writer.putVarint(stamps[line]);
+  }
+  for (uint64_t bits : plru)
+    writer.putVarint(bits);
+  writer.putVarint(clock);
+  writer.putU32(random_state);
+}
+
+void cache_t::loadState(checkpoint_reader_t &reader) {
+  for (size_t line = 0; line < tags.size(); line++) {
+    tags[line] = reader.getVarint();
+    dirty[line] = reader.getU8();
+    stamps[line] = reader.getVarint();
+  }
+  for (uint64_t &bits : plru)
+    bits = reader.getVarint();
+  clock = reader.getVarint();
+  random_state = reader.getU32();
+}
@@ -0,0 +1,362 @@
+#include "checkpoint.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "elf_loader.h"
+#include "memory.h"
+#include "processor.h"
+
+// Sequências de zeros menores que isso continuam no trecho literal
+#define CHECKPOINT_MIN_ZERO_RUN 8
+
+/***************************************************************************
+Serialização
+***************************************************************************/
+void checkpoint_writer_t::putU32(uint32_t value) {
+  for (int i = 0; i < 4; i++)
+    data.push_back(value >> (8 * i));
+}
+
+void checkpoint_writer_t::putU64(uint64_t value) {
+  for (int i = 0; i < 8; i++)
+    data.push_back(value >> (8 * i));
+}
+
+void checkpoint_writer_t::putVarint(uint64_t value) {
+  do {
+    uint8_t byte = value & 0x7F;
+    value >>= 7;
+    if (value != 0)
+      byte |= 0x80;
+    data.push_back(byte);
+  } while (value != 0);
+}
+
+void checkpoint_writer_t::putBytes(const uint8_t *bytes, size_t size) {
+  data.insert(data.end(), bytes, bytes + size);
+}
+
+void checkpoint_writer_t::putBlock(const checkpoint_writer_t &block) {
+  putVarint(block.data.size());
+  putBytes(block.data.data(), block.data.size());
+}
+
+checkpoint_reader_t::checkpoint_reader_t(const uint8_t *bytes, size_t length)
+    : data(bytes), size(length), position(0), valid(true) {}
+
+bool checkpoint_reader_t::require(size_t count) {
+  if (!valid || count > size - position) {
+    valid = false;
+    return false;
+  }
+  return true;
+}
+
+uint8_t checkpoint_reader_t::getU8() {
+  if (!require(1))
+    return 0;
+  return data[position++];
+}
+
+uint32_t checkpoint_reader_t::getU32() {
+  if (!require(4))
+    return 0;
+  uint32_t value = 0;
+  for (int i = 0; i < 4; i++)
+    value |= (uint32_t)data[position++] << (8 * i);
+  return value;
+}
+
+uint64_t checkpoint_reader_t::getU64() {
+  if (!require(8))
+    return 0;
+  uint64_t value = 0;
+  for (int i = 0; i < 8; i++)
+    value |= (uint64_t)data[position++] << (8 * i);
+  return value;
+}
+
+uint64_t checkpoint_reader_t::getVarint() {
+  uint64_t value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    uint8_t byte = getU8();
+    value |= (uint64_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80))
+      return value;
+  }
+  valid = false;
+  return 0;
+}
+
+void checkpoint_reader_t::getBytes(uint8_t *bytes, size_t count) {
+  if (!require(count)) {
+    memset(bytes, 0, count);
+    return;
+  }
+  memcpy(bytes, data + position, count);
+  position += count;
+}
+
+checkpoint_reader_t checkpoint_reader_t::getBlock() {
+  uint64_t length = getVarint();
+  if (!require(length))
+    return checkpoint_reader_t(nullptr, 0);
+  checkpoint_reader_t block(data + position, length);
+  position += length;
+  return block;
+}
+
+/***************************************************************************
+Compressão: o corpo é uma sequência de pares (zeros, literais), cada um com o
+tamanho em varint e os literais copiados. Páginas de memória e as tabelas das
+caches são quase todas zeros, então isso basta sem depender de uma biblioteca
+externa.
+***************************************************************************/
+static std::vector<uint8_t> compress(const std::vector<uint8_t> &input) {
+  checkpoint_writer_t output;
+  size_t i = 0, size = input.size();
+  while (i < size) {
+    size_t zeros = 0;
+    while (i + zeros < size && input[i + zeros] == 0)
+      zeros++;
+    i += zeros;
+    // O trecho literal termina em uma sequência longa de zeros
+    size_t literal = 0, run = 0;
+    while (i + literal + run < size) {
+      if (input[i + literal + run] == 0) {
+        run++;
+        if (run >= CHECKPOINT_MIN_ZERO_RUN)
+          break;
+      } else {
+        literal += run + 1;
+        run = 0;
+      }
+    }
+    if (i + literal + run >= size)
+      literal += run;
+    output.putVarint(zeros);
+    output.putVarint(literal);
+    output.putBytes(input.data() + i, literal);
+    i += literal;
+  }
+  return output.getData();
+}
+
+static bool decompress(const uint8_t *input, size_t size,
+                       std::vector<uint8_t> &output, size_t expected) {
+  checkpoint_reader_t reader(input, size);
+  output.clear();
+  output.reserve(expected);
+  while (output.size() < expected && reader.good()) {
+    uint64_t zeros = reader.getVarint();
+    uint64_t literal = reader.getVarint();
+    if (zeros + literal > expected - output.size())
+      return false;
+    output.resize(output.size() + zeros, 0);
+    size_t start = output.size();
+    output.resize(start + literal);
+    reader.getBytes(output.data() + start, literal);
+  }
+  return reader.good() && output.size() == expected;
+}
+
+/***************************************************************************
+Checkpoint
+***************************************************************************/
+static uint64_t fnv1a(const uint8_t *data, size_t size) {
+  uint64_t hash = 14695981039346656037ull;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= data[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+// Mapeia o ELF e calcula a identificação (tamanho e hash) gravada no
+// checkpoint
+static bool elfIdentity(elf_file_t &elf, const char *elf_path, uint64_t *size,
+                        uint64_t *hash, std::string &error) {
+  if (!elf.open(elf_path, error))
+    return false;
+  *size = elf.getSize();
+  *hash = fnv1a(elf.at(0, *size), *size);
+  return true;
+}
+
+bool encodeCheckpoint(std::vector<uint8_t> &contents, const char *elf_path,
+                      const processor_t &processor, const memory_t &memory,
+                      bool warm, checkpoint_info_t *info, std::string &error) {
+  // O checkpoint não guarda o fim do programa: restaurado, ele continuaria
+  // depois do SCALL
+  if (!processor.isRunning()) {
+    error = "o programa já terminou";
+    return false;
+  }
+  elf_file_t elf;
+  uint64_t elf_size, elf_hash;
+  if (!elfIdentity(elf, elf_path, &elf_size, &elf_hash, error))
+    return false;
+  // Imagem inicial do programa, para gravar só as páginas alteradas
+  memory_t image(false);
+  elf.load(image);
+
+  checkpoint_writer_t body;
+  processor.saveState(body, warm);
+
+  std::vector<uint32_t> pages = memory.getPageAddresses();
+  std::vector<uint32_t> dirty;
+  static const uint8_t zero_page[PAGE_SIZE] = {0};
+  for (uint32_t address : pages) {
+    const uint8_t *original = image.peekPage(address);
+    if (original == nullptr)
+      original = zero_page;
+    if (memcmp(memory.peekPage(address), original, PAGE_SIZE) != 0)
+      dirty.push_back(address);
+  }
+  body.putU32(dirty.size());
+  for (uint32_t address : dirty) {
+    body.putU32(address);
+    body.putBytes(memory.peekPage(address), PAGE_SIZE);
+  }
+  if (warm)
+    memory.saveCacheState(body);
+
+  std::vector<uint8_t> compressed = compress(body.getData());
+  checkpoint_writer_t header;
+  header.putBytes((const uint8_t *)CHECKPOINT_MAGIC, 8);
+  header.putU32(CHECKPOINT_VERSION);
+  header.putU32(warm ? CHECKPOINT_F_WARM : 0);
+  header.putU64(processor.getInstret());
+  header.putU64(elf_size);
+  header.putU64(elf_hash);
+  header.putU32(body.getData().size());
+  header.putU32(compressed.size());
+  contents = header.getData();
+  contents.insert(contents.end(), compressed.begin(), compressed.end());
+
+  if (info != nullptr) {
+    info->instret = processor.getInstret();
+    info->pages = dirty.size();
+    info->warm = warm;
+    info->warm_ignored = false;
+  }
+  return true;
+}
+
+bool decodeCheckpoint(const std::vector<uint8_t> &contents,
+                      const char *elf_path, processor_t &processor,
+                      memory_t &memory, checkpoint_info_t *info,
+                      std::string &error) {
+  checkpoint_reader_t header(contents.data(), contents.size());
+  uint8_t magic[8];
+  header.getBytes(magic, 8);
+  uint32_t version = header.getU32();
+  uint32_t flags = header.getU32();
+  uint64_t instret = header.getU64();
+  uint64_t elf_size = header.getU64();
+  uint64_t elf_hash = header.getU64();
+  uint32_t body_size = header.getU32();
+  uint32_t compressed_size = header.getU32();
+  if (!header.good() || memcmp(magic, CHECKPOINT_MAGIC, 8) != 0 ||
+      version != CHECKPOINT_VERSION ||
+      compressed_size != contents.size() - CHECKPOINT_HEADER_SIZE) {
+    error = "não é um checkpoint válido";
+    return false;
+  }
+
+  elf_file_t elf;
+  uint64_t current_size, current_hash;
+  if (!elfIdentity(elf, elf_path, &current_size, &current_hash, error))
+    return false;
+  if (current_size != elf_size || current_hash != elf_hash) {
+    error = "gravado com outro programa";
+    return false;
+  }
+
+  std::vector<uint8_t> body;
+  if (!decompress(contents.data() + CHECKPOINT_HEADER_SIZE, compressed_size,
+                  body, body_size)) {
+    error = "conteúdo corrompido";
+    return false;
+  }
+  // O corpo inteiro é lido antes de alterar o processador e a memória, para
+  // que um checkpoint corrompido não deixe a restauração pela metade
+  checkpoint_reader_t reader(body.data(), body.size());
+  bool warm = flags & CHECKPOINT_F_WARM;
+  processor_state_t state;
+  processor_t::readState(reader, warm, state);
+  uint32_t pages = reader.getU32();
+  std::vector<uint32_t> addresses;
+  std::vector<uint8_t> page_data;
+  for (uint32_t i = 0; i < pages && reader.good(); i++) {
+    addresses.push_back(reader.getU32());
+    page_data.resize(page_data.size() + PAGE_SIZE);
+    reader.getBytes(page_data.data() + i * PAGE_SIZE, PAGE_SIZE);
+  }
+  // O estado das caches é o último bloco; ele é lido (e conferido) só ao
+  // ser aplicado
+  checkpoint_reader_t caches = reader;
+  if (warm)
+    reader.getBlock();
+  if (!reader.good()) {
+    error = "conteúdo corrompido";
+    return false;
+  }
+
+  bool warm_ignored = !processor.loadState(state, instret);
+  for (size_t i = 0; i < addresses.size(); i++)
+    memory.writeBlock(addresses[i], page_data.data() + i * PAGE_SIZE,
+                      PAGE_SIZE, ACCESS_TYPE::LOAD);
+  if (warm && !memory.loadCacheState(caches))
+    warm_ignored = true;
+  if (info != nullptr) {
+    info->instret = instret;
+    info->pages = pages;
+    info->warm = warm;
+    info->warm_ignored = warm_ignored;
+  }
+  return true;
+}
+
+bool saveCheckpoint(const char *path, const char *elf_path,
+                    const processor_t &processor, const memory_t &memory,
+                    bool warm, checkpoint_info_t *info, std::string &error) {
+  std::vector<uint8_t> contents;
+  if (!encodeCheckpoint(contents, elf_path, processor, memory, warm, info,
+                        error))
+    return false;
+  FILE *file = fopen(path, "wb");
+  if (file == nullptr) {
+    error = std::string("não foi possível criar ") + path;
+    return false;
+  }
+  bool written =
+      fwrite(contents.data(), 1, contents.size(), file) == contents.size();
+  if (fclose(file) != 0 || !written) {
+    error = std::string("erro ao gravar ") + path;
+    return false;
+  }
+  return true;
+}
+
+bool restoreCheckpoint(const char *path, const char *elf_path,
+                       processor_t &processor, memory_t &memory,
+                       checkpoint_info_t *info, std::string &error) {
+  FILE *file = fopen(path, "rb");
+  if (file == nullptr) {
+    error = std::string("não foi possível abrir ") + path;
+    return false;
+  }
+  std::vector<uint8_t> contents;
+  uint8_t chunk[1 << 16];
+  size_t read;
+  while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0)
+    contents.insert(contents.end(), chunk, chunk + read);
+  fclose(file);
+  if (!decodeCheckpoint(contents, elf_path, processor, memory, info, error)) {
+    error = std::string(path) + ": " + error;
+    return false;
+  }
+  return true;
+}
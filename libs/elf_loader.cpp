@@ -0,0 +1,222 @@
+#include "elf_loader.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include <algorithm>
+
+#include "memory.h"
+
+elf_file_t::elf_file_t() : data(nullptr), size(0), header() {}
+
+elf_file_t::~elf_file_t() { close(); }
+
+bool elf_file_t::open(const char *path, std::string &error) {
+  close();
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0) {
+    error = std::string("não foi possível abrir ") + path;
+    return false;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size == 0) {
+    ::close(fd);
+    error = std::string("arquivo vazio: ") + path;
+    return false;
+  }
+  void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // O mapeamento continua válido depois de fechar o descritor
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    error = std::string("não foi possível mapear ") + path;
+    return false;
+  }
+  data = static_cast<const uint8_t *>(mapping);
+  size = info.st_size;
+  if (!validate(error)) {
+    error = std::string(path) + ": " + error;
+    close();
+    return false;
+  }
+  return true;
+}
+
+void elf_file_t::close() {
+  if (data != nullptr)
+    munmap(const_cast<uint8_t *>(data), size);
+  data = nullptr;
+  size = 0;
+}
+
+const uint8_t *elf_file_t::at(uint64_t offset, uint64_t length) const {
+  if (offset > size || length > size - offset)
+    return nullptr;
+  return data + offset;
+}
+
+bool elf_file_t::validate(std::string &error) {
+  if (size < sizeof(elf32_ehdr_t)) {
+    error = "arquivo menor que o cabeçalho ELF";
+    return false;
+  }
+  memcpy(&header, data, sizeof(header));
+  if (memcmp(header.ident, ELF_MAGIC, 4) != 0) {
+    error = "não é um arquivo ELF";
+    return false;
+  }
+  if (header.ident[4] != ELF_CLASS_32 || header.ident[5] != ELF_DATA_LSB ||
+      header.machine != ELF_MACHINE_RV) {
+    error = "não é um ELF32 little-endian de RISC-V";
+    return false;
+  }
+  if (header.phnum > 0 &&
+      (header.phentsize < sizeof(elf32_phdr_t) ||
+       at(header.phoff, (uint64_t)header.phnum * header.phentsize) ==
+           nullptr)) {
+    error = "program headers fora do arquivo";
+    return false;
+  }
+  if (header.shnum > 0 &&
+      (header.shentsize < sizeof(elf32_shdr_t) ||
+       at(header.shoff, (uint64_t)header.shnum * header.shentsize) ==
+           nullptr)) {
+    error = "section headers fora do arquivo";
+    return false;
+  }
+  for (int i = 0; i < header.phnum; i++) {
+    elf32_phdr_t segment = getProgramHeader(i);
+    if (segment.type != ELF_PT_LOAD)
+      continue;
+    if (segment.filesz > segment.memsz ||
+        at(segment.offset, segment.filesz) == nullptr ||
+        segment.memsz > UINT32_MAX - segment.vaddr) {
+      error = "segmento PT_LOAD " + std::to_string(i) + " inválido";
+      return false;
+    }
+  }
+  return true;
+}
+
+elf32_phdr_t elf_file_t::getProgramHeader(int index) const {
+  elf32_phdr_t segment;
+  memcpy(&segment, data + header.phoff + (size_t)index * header.phentsize,
+         sizeof(segment));
+  return segment;
+}
+
+elf32_shdr_t elf_file_t::getSectionHeader(int index) const {
+  elf32_shdr_t section;
+  memcpy(&section, data + header.shoff + (size_t)index * header.shentsize,
+         sizeof(section));
+  return section;
+}
+
+void elf_file_t::load(memory_t &memory) const {
+  for (int i = 0; i < header.phnum; i++) {
+    elf32_phdr_t segment = getProgramHeader(i);
+    if (segment.type != ELF_PT_LOAD)
+      continue;
+    memory.writeBlock(segment.vaddr, data + segment.offset, segment.filesz,
+                      ACCESS_TYPE::LOAD);
+    memory.zeroBlock(segment.vaddr + segment.filesz,
+                     segment.memsz - segment.filesz);
+  }
+  if (header.phnum > 0)
+    return;
+
+  // Sem program headers (ELF relocável ligado manualmente): seções alocadas
+  for (int i = 0; i < header.shnum; i++) {
+    elf32_shdr_t section = getSectionHeader(i);
+    if (!(section.flags & ELF_SHF_ALLOC))
+      continue;
+    if (section.type == ELF_SHT_NOBITS)
+      memory.zeroBlock(section.addr, section.size);
+    else if (at(section.offset, section.size) != nullptr)
+      memory.writeBlock(section.addr, data + section.offset, section.size,
+                        ACCESS_TYPE::LOAD);
+  }
+}
+
+bool load_elf(const char *elf_file, memory_t &memory, uint32_t *entry_point,
+              std::string &error) {
+  elf_file_t elf;
+  if (!elf.open(elf_file, error))
+    return false;
+  elf.load(memory);
+  *entry_point = elf.getHeader().entry;
+  return true;
+}
+
+bool symbol_table_t::load(const elf_file_t &elf) {
+  symbols.clear();
+  const elf32_ehdr_t &header = elf.getHeader();
+  for (int i = 0; i < header.shnum; i++) {
+    elf32_shdr_t section = elf.getSectionHeader(i);
+    if (section.type != ELF_SHT_SYMTAB || section.link >= header.shnum)
+      continue;
+    elf32_shdr_t strings = elf.getSectionHeader(section.link);
+    const uint8_t *table = elf.at(section.offset, section.size);
+    const char *names =
+        reinterpret_cast<const char *>(elf.at(strings.offset, strings.size));
+    if (table == nullptr || names == nullptr)
+      continue;
+    for (uint32_t offset = 0; offset + sizeof(elf32_sym_t) <= section.size;
+         offset += sizeof(elf32_sym_t)) {
+      elf32_sym_t symbol;
+      memcpy(&symbol, table + offset, sizeof(symbol));
+      int type = symbol.info & 0xf;
+      if ((type != ELF_STT_FUNC && type != ELF_STT_NOTYPE) ||
+          symbol.shndx == ELF_SHN_UNDEF || symbol.name >= strings.size)
+        continue;
+      // Só os rótulos de seções executáveis interessam, mas a seção de um
+      // símbolo sem tipo é conferida pelas flags
+      if (type == ELF_STT_NOTYPE) {
+        if (symbol.shndx >= header.shnum ||
+            !(elf.getSectionHeader(symbol.shndx).flags & ELF_SHF_EXECINSTR))
+          continue;
+      }
+      const char *name = names + symbol.name;
+      size_t length = strnlen(name, strings.size - symbol.name);
+      // Rótulos locais gerados pelo compilador (.L*) e o símbolo vazio
+      if (length == 0 || name[0] == '.')
+        continue;
+      symbols.push_back({symbol.value, symbol.size, std::string(name, length)});
+    }
+  }
+  std::sort(symbols.begin(), symbols.end(),
+            [](const elf_symbol_t &a, const elf_symbol_t &b) {
+              if (a.address != b.address)
+                return a.address < b.address;
+              // Com vários nomes no mesmo endereço, fica o da função
+              return a.size > b.size;
+            });
+  symbols.erase(std::unique(symbols.begin(), symbols.end(),
+                            [](const elf_symbol_t &a, const elf_symbol_t &b) {
+                              return a.address == b.address;
+                            }),
+                symbols.end());
+  // Símbolos sem tamanho vão até o próximo
+  for (size_t i = 0; i + 1 < symbols.size(); i++)
+    if (symbols[i].size == 0)
+      symbols[i].size = symbols[i + 1].address - symbols[i].address;
+  return !symbols.empty();
+}
+
+const elf_symbol_t *symbol_table_t::find(uint32_t address) const {
+  auto next = std::upper_bound(
+      symbols.begin(), symbols.end(), address,
+      [](uint32_t value, const elf_symbol_t &symbol) {
+        return value < symbol.address;
+      });
+  if (next == symbols.begin())
+    return nullptr;
+  const elf_symbol_t &symbol = *(next - 1);
+  // O último símbolo sem tamanho cobre o resto do programa
+  if (symbol.size != 0 && address - symbol.address >= symbol.size)
+    return nullptr;
+  return &symbol;
+}
@@ -0,0 +1,89 @@
+#include "host_profile.h"
+
+#ifdef RVSIM_HOST_PROFILE
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+static const char *stage_names[(int)HOST_STAGE::COUNT] = {
+    "laço/temporização", "fetch", "decode", "execute",
+    "caches nativas",    "dineroIV", "estatísticas", "log/trace"};
+
+// Os buffers continuam registrados depois que as threads terminam, para
+// entrar no relatório
+static std::mutex buffers_mutex;
+static std::vector<std::unique_ptr<host_profile_buffer_t>> buffers;
+// Início da medição, para converter os ticks em ns
+static uint64_t start_ticks;
+static std::chrono::steady_clock::time_point start_time;
+
+// Nome alinhado em width colunas (os nomes têm acentos, o printf contaria
+// bytes)
+static void printName(const char *name, int width) {
+  int columns = 0;
+  for (const char *c = name; *c != '\0'; c++)
+    if ((*c & 0xc0) != 0x80)
+      columns++;
+  fprintf(stderr, "  %s%*s", name, width > columns ? width - columns : 0, "");
+}
+
+static void hostProfileReport() {
+  uint64_t elapsed_ticks = hostProfileTicks() - start_ticks;
+  double elapsed_ns = std::chrono::duration<double, std::nano>(
+                          std::chrono::steady_clock::now() - start_time)
+                          .count();
+  double ns_per_tick = elapsed_ticks > 0 ? elapsed_ns / elapsed_ticks : 0;
+
+  std::lock_guard<std::mutex> lock(buffers_mutex);
+  uint64_t ticks[(int)HOST_STAGE::COUNT] = {0};
+  uint64_t calls[(int)HOST_STAGE::COUNT] = {0};
+  uint64_t total = 0;
+  for (const auto &buffer : buffers) {
+    for (int stage = 0; stage < (int)HOST_STAGE::COUNT; stage++) {
+      ticks[stage] += buffer->ticks[stage];
+      calls[stage] += buffer->calls[stage];
+      total += buffer->ticks[stage];
+    }
+  }
+  uint64_t instructions = calls[(int)HOST_STAGE::STEP];
+  if (instructions == 0)
+    return;
+  fprintf(stderr, "\nPERFIL DO HOST (%lu instruções, %zu threads):\n",
+          (unsigned long)instructions, buffers.size());
+  printName("estágio", 20);
+  fprintf(stderr, " %10s %8s %14s\n", "ns/instr", "%", "chamadas");
+  for (int stage = 0; stage < (int)HOST_STAGE::COUNT; stage++) {
+    if (calls[stage] == 0)
+      continue;
+    printName(stage_names[stage], 20);
+    fprintf(stderr, " %10.2f %7.2f%% %14lu\n",
+            ticks[stage] * ns_per_tick / instructions,
+            total ? 100.0 * ticks[stage] / total : 0,
+            (unsigned long)calls[stage]);
+  }
+  printName("total", 20);
+  fprintf(stderr, " %10.2f\n", total * ns_per_tick / instructions);
+}
+
+static host_profile_buffer_t *registerBuffer() {
+  std::lock_guard<std::mutex> lock(buffers_mutex);
+  if (buffers.empty()) {
+    start_ticks = hostProfileTicks();
+    start_time = std::chrono::steady_clock::now();
+    atexit(hostProfileReport);
+  }
+  buffers.emplace_back(new host_profile_buffer_t());
+  return buffers.back().get();
+}
+
+host_profile_buffer_t &hostProfileBuffer() {
+  static thread_local host_profile_buffer_t *buffer = registerBuffer();
+  return *buffer;
+}
+
+#endif
@@ -0,0 +1,175 @@
+#include "interval.h"
+
+#include <cstring>
+
+/***************************************************************************
+Stream writer
+***************************************************************************/
+stream_writer_t::stream_writer_t() {
+  file = nullptr;
+  closing = false;
+  empty = true;
+  failed = false;
+}
+
+stream_writer_t::~stream_writer_t() { close(); }
+
+bool stream_writer_t::open(const char *path) {
+  close();
+  file = fopen(path, "ab");
+  if (file == nullptr)
+    return false;
+  fseek(file, 0, SEEK_END);
+  empty = ftell(file) == 0;
+  closing = false;
+  failed = false;
+  current.reserve(STREAM_BUFFER_SIZE);
+  thread = std::thread(&stream_writer_t::writerLoop, this);
+  return true;
+}
+
+void stream_writer_t::write(const char *data, size_t size) {
+  current.insert(current.end(), data, data + size);
+  if (current.size() >= STREAM_BUFFER_SIZE)
+    handOff();
+}
+
+void stream_writer_t::handOff() {
+  std::unique_lock<std::mutex> lock(mutex);
+  drained.wait(lock, [this]() { return pending.size() < STREAM_MAX_PENDING; });
+  pending.push_back(std::move(current));
+  if (spare.empty()) {
+    current = std::vector<char>();
+    current.reserve(STREAM_BUFFER_SIZE);
+  } else {
+    current = std::move(spare.back());
+    spare.pop_back();
+  }
+  wake.notify_one();
+}
+
+void stream_writer_t::writerLoop() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    wake.wait(lock, [this]() { return closing || !pending.empty(); });
+    if (pending.empty())
+      return;
+    std::vector<char> buffer = std::move(pending.front());
+    pending.pop_front();
+    // O fwrite é feito sem o lock, a simulação pode entregar outros buffers
+    lock.unlock();
+    bool written =
+        fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    buffer.clear();
+    lock.lock();
+    failed |= !written;
+    spare.push_back(std::move(buffer));
+    drained.notify_one();
+  }
+}
+
+bool stream_writer_t::close() {
+  if (file == nullptr)
+    return !failed;
+  if (!current.empty())
+    handOff();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    closing = true;
+  }
+  wake.notify_one();
+  thread.join();
+  if (fclose(file) != 0)
+    failed = true;
+  file = nullptr;
+  current.clear();
+  spare.clear();
+  return !failed;
+}
+
+/***************************************************************************
+Interval sampler
+***************************************************************************/
+interval_sampler_t::interval_sampler_t(const processor_t &pprocessor,
+                                       memory_t &pmemory,
+                                       stream_writer_t &pwriter)
+    : processor(pprocessor), memory(pmemory), writer(pwriter) {
+  levels = memory.getCacheLevels();
+  intervals = 0;
+  last_stats = processor.getStats();
+  last_stalls = processor.getStalls();
+  for (int level = 0; level < levels; level++) {
+    last_accesses[level] = memory.getCacheAccesses(level);
+    last_misses[level] = memory.getCacheMisses(level);
+  }
+}
+
+void interval_sampler_t::writeHeader() {
+  std::string header = "interval,instret,instructions,cycles,ipc,"
+                       "branch_accuracy,mispredictions";
+  for (int level = 0; level < levels; level++) {
+    const std::string &name = memory.getCacheName(level);
+    header += "," + name + "_miss_rate," + name + "_mpki";
+  }
+  header += ",alu_occupancy,agu_occupancy,bru_occupancy,mem_port_occupancy\n";
+  writer.write(header.data(), header.size());
+}
+
+// Razão formatada, vazia quando o denominador é 0
+static void putRatio(std::string &line, double value, double total) {
+  char field[32];
+  if (total > 0)
+    snprintf(field, sizeof(field), ",%.6g", value / total);
+  else
+    snprintf(field, sizeof(field), ",");
+  line += field;
+}
+
+void interval_sampler_t::sample() {
+  const sim_stats_t &stats = processor.getStats();
+  const stall_stats_t &stalls = processor.getStalls();
+  uint64_t instructions = stats.instructions - last_stats.instructions;
+  uint64_t cycles = stats.cycles - last_stats.cycles;
+  // Nada foi executado desde a última amostra (fim do programa exatamente no
+  // limite do intervalo)
+  if (instructions == 0)
+    return;
+
+  char field[64];
+  snprintf(field, sizeof(field), "%lu,%lu,%lu,%lu", (unsigned long)intervals,
+           (unsigned long)processor.getInstret(), (unsigned long)instructions,
+           (unsigned long)cycles);
+  std::string line = field;
+  putRatio(line, instructions, cycles);
+  uint64_t hits = stats.gshare_hits - last_stats.gshare_hits;
+  uint64_t errors = stats.gshare_errors - last_stats.gshare_errors;
+  putRatio(line, hits, hits + errors);
+  snprintf(field, sizeof(field), ",%lu",
+           (unsigned long)(stalls.mispredictions - last_stalls.mispredictions));
+  line += field;
+
+  for (int level = 0; level < levels; level++) {
+    uint64_t accesses = memory.getCacheAccesses(level);
+    uint64_t misses = memory.getCacheMisses(level);
+    putRatio(line, misses - last_misses[level],
+             accesses - last_accesses[level]);
+    putRatio(line, (misses - last_misses[level]) * 1000.0, instructions);
+    last_accesses[level] = accesses;
+    last_misses[level] = misses;
+  }
+
+  const int units[] = {NUMBER_OF_ALU, NUMBER_OF_AGU, NUMBER_OF_BRU};
+  for (int unit = 0; unit < 3; unit++)
+    putRatio(line,
+             stalls.fu_busy_cycles[unit] - last_stalls.fu_busy_cycles[unit],
+             (double)cycles * units[unit]);
+  putRatio(line,
+           stalls.mem_port_busy_cycles - last_stalls.mem_port_busy_cycles,
+           cycles);
+  line += '\n';
+  writer.write(line.data(), line.size());
+
+  intervals++;
+  last_stats = stats;
+  last_stalls = stalls;
+}
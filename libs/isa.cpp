@@ -17,7 +17,7 @@ instruction_t::instruction_t() {
   imm = -1;
   shammt = -1;
   cycle = 1; // Atualmente todas instruções levam 1 ciclo
-  op = MNE::FENCEI;
+  op = MNE::ILLEGAL;
 }
 
 instruction_t::instruction_t(uint32_t ins, unsigned long int add) {
@@ -32,8 +32,9 @@ instruction_t::instruction_t(uint32_t ins, unsigned long int add) {
   imm = -1;
   shammt = -1;
   cycle = 1; // Atualmente todas instruções levam 1 ciclo
-  op = MNE::FENCEI;
+  op = MNE::ILLEGAL;
   fu = FU::NONE;
+  type = INST_TYPE::R; // opcodes desconhecidos não possuem imediato
 
   // INSTRUCTION DECODE
   // Atualmente no IM temos 11 OPCODES
@@ -374,6 +375,7 @@ uint8_t instruction_t::getImmSize() {
     return 21;
     break;
   }
+  return 0;
 }
 
 uint32_t instruction_t::getShammt() { return shammt; }
@@ -382,4 +384,239 @@ uint32_t instruction_t::getInsCycle() { return cycle; }
 
 unsigned long int instruction_t::getInsAddress() { return address; }
 
-uint32_t instruction_t::getIns() { return inst; }
\ No newline at end of file
+uint32_t instruction_t::getIns() { return inst; }
+
+decoded_t decodeInstruction(uint32_t raw, uint32_t address) {
+  instruction_t ins(raw, address);
+  decoded_t dec;
+  dec.address = address;
+  dec.raw = raw;
+  dec.op = ins.getOperation();
+  dec.fu = ins.getFU();
+  dec.rd = (ins.getRd() != (uint32_t)-1) ? ins.getRd() : REG_NONE;
+  dec.rs1 = (ins.getRs1() != (uint32_t)-1) ? ins.getRs1() : REG_NONE;
+  dec.rs2 = (ins.getRs2() != (uint32_t)-1) ? ins.getRs2() : REG_NONE;
+  dec.shammt = ins.getShammt();
+  // Instruções do tipo R não possuem imediato
+  dec.imm = (ins.getType() != INST_TYPE::R)
+                ? sign_extend(ins.getImm(), ins.getImmSize())
+                : 0;
+  dec.valid = true;
+  return dec;
+}
+
+const char *getMnemonic(MNE op) {
+  switch (op) {
+  case MNE::LB: return "LB";
+  case MNE::LH: return "LH";
+  case MNE::LW: return "LW";
+  case MNE::LBU: return "LBU";
+  case MNE::LHU: return "LHU";
+  case MNE::SB: return "SB";
+  case MNE::SH: return "SH";
+  case MNE::SW: return "SW";
+  case MNE::SLL: return "SLL";
+  case MNE::SLLI: return "SLLI";
+  case MNE::SRL: return "SRL";
+  case MNE::SRLI: return "SRLI";
+  case MNE::SRA: return "SRA";
+  case MNE::SRAI: return "SRAI";
+  case MNE::ADD: return "ADD";
+  case MNE::ADDI: return "ADDI";
+  case MNE::SUB: return "SUB";
+  case MNE::LUI: return "LUI";
+  case MNE::AUIPC: return "AUIPC";
+  case MNE::XOR: return "XOR";
+  case MNE::XORI: return "XORI";
+  case MNE::OR: return "OR";
+  case MNE::ORI: return "ORI";
+  case MNE::AND: return "AND";
+  case MNE::ANDI: return "ANDI";
+  case MNE::SLT: return "SLT";
+  case MNE::SLTI: return "SLTI";
+  case MNE::SLTU: return "SLTU";
+  case MNE::SLTIU: return "SLTIU";
+  case MNE::MUL: return "MUL";
+  case MNE::MULH: return "MULH";
+  case MNE::MULHSU: return "MULHSU";
+  case MNE::MULHU: return "MULHU";
+  case MNE::DIV: return "DIV";
+  case MNE::DIVU: return "DIVU";
+  case MNE::REM: return "REM";
+  case MNE::REMU: return "REMU";
+  case MNE::BEQ: return "BEQ";
+  case MNE::BNE: return "BNE";
+  case MNE::BLT: return "BLT";
+  case MNE::BGE: return "BGE";
+  case MNE::BLTU: return "BLTU";
+  case MNE::BGEU: return "BGEU";
+  case MNE::JAL: return "JAL";
+  case MNE::JALR: return "JALR";
+  case MNE::FENCE: return "FENCE";
+  case MNE::FENCEI: return "FENCE.I";
+  case MNE::SCALL: return "SCALL";
+  case MNE::SBREAK: return "SBREAK";
+  case MNE::RDCYCLE: return "RDCYCLE";
+  case MNE::RDCYCLEH: return "RDCYCLEH";
+  case MNE::RDTIME: return "RDTIME";
+  case MNE::RDTIMEH: return "RDTIMEH";
+  case MNE::RDINSTRRET: return "RDINSTRRET";
+  case MNE::RDINSTRETH: return "RDINSTRETH";
+  case MNE::ILLEGAL: return "ILLEGAL";
+  }
+  return "";
+}
+
+void disassemble(const decoded_t &ins, char *out, size_t size) {
+  const char *name = getMnemonic(ins.op);
+  switch (ins.op) {
+  case MNE::LUI:
+  case MNE::AUIPC:
+  case MNE::JAL: // rd, imm
+    snprintf(out, size, "%-8s %s, %d", name, register_name[ins.rd].c_str(),
+             ins.imm);
+    break;
+  case MNE::LB:
+  case MNE::LH:
+  case MNE::LW:
+  case MNE::LBU:
+  case MNE::LHU:
+  case MNE::ADDI:
+  case MNE::XORI:
+  case MNE::ORI:
+  case MNE::ANDI:
+  case MNE::SLTI:
+  case MNE::SLTIU:
+  case MNE::JALR: // rd, rs1, imm
+    snprintf(out, size, "%-8s %s, %s, %d", name,
+             register_name[ins.rd].c_str(), register_name[ins.rs1].c_str(),
+             ins.imm);
+    break;
+  case MNE::SLLI:
+  case MNE::SRLI:
+  case MNE::SRAI: // rd, rs1, shammt
+    snprintf(out, size, "%-8s %s, %s, %d", name,
+             register_name[ins.rd].c_str(), register_name[ins.rs1].c_str(),
+             ins.shammt);
+    break;
+  case MNE::SB:
+  case MNE::SH:
+  case MNE::SW:
+  case MNE::BEQ:
+  case MNE::BNE:
+  case MNE::BLT:
+  case MNE::BGE:
+  case MNE::BLTU:
+  case MNE::BGEU: // rs1, rs2, imm
+    snprintf(out, size, "%-8s %s, %s, %d", name,
+             register_name[ins.rs1].c_str(), register_name[ins.rs2].c_str(),
+             ins.imm);
+    break;
+  case MNE::SLL:
+  case MNE::SRL:
+  case MNE::SRA:
+  case MNE::ADD:
+  case MNE::SUB:
+  case MNE::XOR:
+  case MNE::OR:
+  case MNE::AND:
+  case MNE::SLT:
+  case MNE::SLTU:
+  case MNE::MUL:
+  case MNE::MULH:
+  case MNE::MULHSU:
+  case MNE::MULHU:
+  case MNE::DIV:
+  case MNE::DIVU:
+  case MNE::REM:
+  case MNE::REMU: // rd, rs1, rs2
+    snprintf(out, size, "%-8s %s, %s, %s", name,
+             register_name[ins.rd].c_str(), register_name[ins.rs1].c_str(),
+             register_name[ins.rs2].c_str());
+    break;
+  default: // instruções sem operandos
+    snprintf(out, size, "%-8s", name);
+    break;
+  }
+}
+
+void formatLogLine(const decoded_t &ins, char *out, size_t size) {
+  char disassembly[50];
+  disassemble(ins, disassembly, sizeof(disassembly));
+  snprintf(out, size, "[PC=%08X] [%08X] %s", ins.address, ins.raw,
+           disassembly);
+}
+
+/***************************************************************************
+Decode cache
+***************************************************************************/
+decode_cache_t::decode_cache_t() {
+  for (uint32_t i = 0; i < PT_ENTRIES; i++)
+    page_dir[i] = nullptr;
+  last_page_number = UINT32_MAX;
+  last_page = nullptr;
+}
+
+decode_cache_t::~decode_cache_t() { invalidateAll(); }
+
+decoded_t *decode_cache_t::lookup(uint32_t pc) {
+  uint32_t page_number = pc >> PAGE_BITS;
+  decoded_page_t *page;
+  if (page_number == last_page_number) {
+    page = last_page;
+  } else {
+    decoded_table_t *table = page_dir[page_number >> PT_BITS];
+    if (table == nullptr)
+      return nullptr;
+    page = table->pages[page_number & (PT_ENTRIES - 1)];
+    if (page == nullptr)
+      return nullptr;
+    last_page_number = page_number;
+    last_page = page;
+  }
+  decoded_t *entry = &page->entries[(pc & PAGE_MASK) >> 2];
+  return entry->valid ? entry : nullptr;
+}
+
+decoded_t *decode_cache_t::insert(uint32_t pc, uint32_t raw) {
+  uint32_t page_number = pc >> PAGE_BITS;
+  decoded_table_t *&table = page_dir[page_number >> PT_BITS];
+  if (table == nullptr)
+    table = new decoded_table_t();
+  decoded_page_t *&page = table->pages[page_number & (PT_ENTRIES - 1)];
+  if (page == nullptr)
+    page = new decoded_page_t(); // todas as entradas começam inválidas
+  last_page_number = page_number;
+  last_page = page;
+
+  decoded_t *entry = &page->entries[(pc & PAGE_MASK) >> 2];
+  *entry = decodeInstruction(raw, pc);
+  return entry;
+}
+
+void decode_cache_t::invalidatePage(uint32_t address) {
+  uint32_t page_number = address >> PAGE_BITS;
+  decoded_table_t *table = page_dir[page_number >> PT_BITS];
+  if (table == nullptr)
+    return;
+  decoded_page_t *&page = table->pages[page_number & (PT_ENTRIES - 1)];
+  delete page;
+  page = nullptr;
+  if (page_number == last_page_number) {
+    last_page_number = UINT32_MAX;
+    last_page = nullptr;
+  }
+}
+
+void decode_cache_t::invalidateAll() {
+  for (uint32_t i = 0; i < PT_ENTRIES; i++) {
+    if (page_dir[i] == nullptr)
+      continue;
+    for (uint32_t j = 0; j < PT_ENTRIES; j++)
+      delete page_dir[i]->pages[j];
+    delete page_dir[i];
+    page_dir[i] = nullptr;
+  }
+  last_page_number = UINT32_MAX;
+  last_page = nullptr;
+}
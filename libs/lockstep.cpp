@@ -0,0 +1,149 @@
+#include "lockstep.h"
+
+#include <stdio.h>
+
+#include "isa.h"
+#include "utils.h"
+
+lockstep_t::lockstep_t() {
+  use_log = false;
+  instret = 0;
+  for (int i = 0; i < LOCKSTEP_HISTORY; i++)
+    history[i] = 0;
+  diverged = false;
+}
+
+void lockstep_t::useReference(const elf_file_t &elf, bool strict) {
+  reference.reset(new reference_model_t(strict));
+  reference->load(elf);
+  use_log = false;
+}
+
+bool lockstep_t::useLog(const char *path) {
+  use_log = log.open(path);
+  return use_log;
+}
+
+void lockstep_t::start(uint32_t pc, const registers_t &registers,
+                       uint64_t pinstret) {
+  instret = pinstret;
+  if (use_log)
+    return;
+  reference->pc = pc;
+  for (int r = 0; r < 32; r++)
+    reference->x[r] = registers.readReg(r);
+}
+
+void lockstep_t::remember(uint32_t pc) {
+  history[instret % LOCKSTEP_HISTORY] = pc;
+  instret++;
+}
+
+void lockstep_t::printHeader(uint32_t pc, uint32_t raw, const char *reason) {
+  char text[LOG_LINE_SIZE];
+  disassemble(decodeInstruction(raw, pc), text, sizeof(text));
+  printf("\nLOCKSTEP: divergência na instrução %lu (%s)\n",
+         (unsigned long)instret, reason);
+  printf("  instrução:  0x%08x  %08x  %s\n", pc, raw, text);
+}
+
+void lockstep_t::printHistory() {
+  printf("  últimos PCs:");
+  uint64_t first = instret > LOCKSTEP_HISTORY ? instret - LOCKSTEP_HISTORY : 0;
+  for (uint64_t i = first; i < instret; i++)
+    printf(" 0x%08x", history[i % LOCKSTEP_HISTORY]);
+  printf("\n");
+  diverged = true;
+}
+
+bool lockstep_t::check(uint32_t pc, uint32_t raw, uint32_t next_pc,
+                       const registers_t &registers, bool running,
+                       memory_t &memory) {
+  remember(pc);
+  uint32_t reference_pc = reference->pc;
+  reference->step();
+
+  bool same_pc = reference_pc == pc && reference->pc == next_pc;
+  bool same_end = reference->running == running && !reference->illegal;
+  bool same_registers = true;
+  for (int r = 1; r < 32; r++)
+    same_registers &= reference->x[r] == registers.readReg(r);
+  bool same_memory = true;
+  for (int i = 0; i < reference->store_size; i++) {
+    uint8_t value;
+    memory.readMem(reference->store_address + i, &value, ACCESS_TYPE::LOAD);
+    same_memory &= value == reference->peek(reference->store_address + i);
+  }
+  if (same_pc && same_end && same_registers && same_memory)
+    return true;
+
+  printHeader(pc, raw,
+              reference->illegal ? "instrução desconhecida na referência"
+              : !same_pc         ? "PC"
+              : !same_end        ? "fim do programa"
+              : !same_registers  ? "registradores"
+                                 : "memória");
+  printf("  %-12s referência   simulador\n", "");
+  if (reference_pc != pc)
+    printf("  %-12s 0x%08x   0x%08x\n", "pc", reference_pc, pc);
+  if (reference->pc != next_pc)
+    printf("  %-12s 0x%08x   0x%08x\n", "pc seguinte", reference->pc, next_pc);
+  if (reference->running != running)
+    printf("  %-12s %-12s %s\n", "executando",
+           reference->running ? "sim" : "não", running ? "sim" : "não");
+  for (int r = 1; r < 32; r++)
+    if (reference->x[r] != registers.readReg(r))
+      printf("  %-12s 0x%08x   0x%08x\n", register_name[r].c_str(),
+             reference->x[r], registers.readReg(r));
+  for (int i = 0; i < reference->store_size; i++) {
+    uint32_t address = reference->store_address + i;
+    uint8_t value;
+    memory.readMem(address, &value, ACCESS_TYPE::LOAD);
+    if (value != reference->peek(address))
+      printf("  [0x%08x] 0x%02x         0x%02x\n", address,
+             reference->peek(address), value);
+  }
+  printHistory();
+  return false;
+}
+
+bool lockstep_t::checkRecord(const trace_record_t &record, bool running) {
+  remember(record.pc);
+  trace_record_t expected;
+  if (!log.next(&expected)) {
+    printHeader(record.pc, record.raw,
+                log.isTruncated() ? "o log termina em um registro incompleto"
+                                  : "o log terminou antes");
+    printHistory();
+    return false;
+  }
+  uint8_t compared = TRACE_R_RD_WRITTEN | TRACE_R_MEM_ACCESS;
+  bool same = expected.pc == record.pc && expected.raw == record.raw &&
+              (expected.flags & compared) == (record.flags & compared);
+  if (same && (record.flags & TRACE_R_RD_WRITTEN))
+    same = expected.rd_value == record.rd_value;
+  if (same && (record.flags & TRACE_R_MEM_ACCESS))
+    same = expected.mem_address == record.mem_address;
+  if (same && (running || (!log.next(&expected) && !log.isTruncated())))
+    return true;
+  if (same) {
+    printHeader(record.pc, record.raw,
+                log.isTruncated() ? "o log termina em um registro incompleto"
+                                  : "o programa terminou antes do log");
+    printHistory();
+    return false;
+  }
+
+  printHeader(record.pc, record.raw, "log de commits");
+  printf("  %-12s log          simulador\n", "");
+  printf("  %-12s 0x%08x   0x%08x\n", "pc", expected.pc, record.pc);
+  printf("  %-12s %08x     %08x\n", "raw", expected.raw, record.raw);
+  if ((expected.flags | record.flags) & TRACE_R_RD_WRITTEN)
+    printf("  %-12s 0x%08x   0x%08x\n", "rd", expected.rd_value,
+           record.rd_value);
+  if ((expected.flags | record.flags) & TRACE_R_MEM_ACCESS)
+    printf("  %-12s 0x%08x   0x%08x\n", "acesso", expected.mem_address,
+           record.mem_address);
+  printHistory();
+  return false;
+}
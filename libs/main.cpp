@@ -1,54 +1,555 @@
 #include <iostream>
+#include <memory>
+#include <thread>
 #include <stdio.h>
 #include <stdint.h>
 #include "utils.h"
+#include "checkpoint.h"
+#include "elf_loader.h"
+#include "interval.h"
+#include "lockstep.h"
 #include "memory.h"
 #include "processor.h"
+#include "profiler.h"
+#include "simpoint.h"
+#include "sweep.h"
+#include "trace.h"
 
 using namespace std;
 
+static void usage() {
+  std::cout << "Uso: rvsim [--engine=switch|threaded] [--functional] "
+               "[--trace=<arquivo> [--trace-compress]] "
+               "[--cache-backend=native|dinero|crosscheck] "
+               "[--cache-config=<arquivo>] [--cache-opt=<nível>.<chave>=<valor>] "
+               "[--checkpoint-at=<instruções> [--checkpoint-file=<arquivo>]] "
+               "[--restore=<arquivo>] "
+               "[--stats=<arquivo> [--stats-interval=<instruções>]] "
+               "[--intervals=<arquivo> --interval=<instruções>|"
+               "--interval-cycles=<ciclos>] "
+               "[--profile=<arquivo> [--profile-folded=<arquivo>] "
+               "[--profile-top=<n>]] "
+               "[--lockstep [--lockstep-strict]|--lockstep-log=<trace>] "
+               "[--core=analytic|ooo [--core-opt=<chave>=<valor>]] "
+               "<elf_program> "
+               "<janela_instruções:int> <bits_gshare:int>"
+            << std::endl;
+  std::cout << "     rvsim --sweep=<grade> [--jobs=<n>] [--sweep-output=<arquivo>] "
+               "[opções de cache] <elf_program>"
+            << std::endl;
+  std::cout << "     rvsim --simpoint=<instruções> [--simpoint-clusters=<k>] "
+               "[--simpoint-warmup=<instruções>] [--simpoint-samples=<n>] "
+               "[--simpoint-verify] "
+               "[--jobs=<n>] [opções de cache] <elf_program> "
+               "<janela_instruções:int> <bits_gshare:int>"
+            << std::endl;
+  std::cout << "     rvsim --check-threads=<instâncias> [opções de cache] "
+               "<elf_program>"
+            << std::endl;
+}
+
+// Grava o relatório e as pilhas agregadas do perfil (caminhos vazios são
+// ignorados)
+static bool writeProfile(const profiler_t &profiler,
+                         const std::string &report_path,
+                         const std::string &folded_path, unsigned top) {
+  if (!report_path.empty()) {
+    FILE *out = fopen(report_path.c_str(), "w");
+    if (out == nullptr) {
+      std::cout << "Não foi possível criar " << report_path << std::endl;
+      return false;
+    }
+    profiler.writeReport(out, top);
+    fclose(out);
+  }
+  if (!folded_path.empty()) {
+    FILE *out = fopen(folded_path.c_str(), "w");
+    if (out == nullptr) {
+      std::cout << "Não foi possível criar " << folded_path << std::endl;
+      return false;
+    }
+    profiler.writeFolded(out);
+    fclose(out);
+  }
+  return true;
+}
+
 int main(int argc, char** argv) {
-  if ( argc != 4 ) {
-      std::cout << "Uso: rvsim <elf_program> <janela_instruções:int> <bits_gshare:int>" << std::endl;
+  // Opções (--nome=valor) podem aparecer em qualquer posição, o restante são
+  // os argumentos posicionais
+  std::vector<char *> args;
+  ENGINE engine = ENGINE::SWITCH;
+  CORE core = CORE::ANALYTIC;
+  ooo_config_t ooo_config;
+  bool functional = false;
+  std::string trace_path;
+  bool trace_compress = false;
+  CACHE_BACKEND cache_backend = CACHE_BACKEND::NATIVE;
+  std::string cache_config_path;
+  std::vector<std::string> cache_options;
+  std::string sweep_path;
+  sweep_options_t sweep_options;
+  sweep_options.jobs = std::thread::hardware_concurrency();
+  unsigned check_instances = 0;
+  uint64_t checkpoint_at = 0;
+  std::string checkpoint_path;
+  std::string restore_path;
+  simpoint_options_t simpoint_options;
+  bool simpoint = false;
+  std::string stats_path;
+  uint64_t stats_interval = 0;
+  std::string intervals_path;
+  uint64_t interval = 0;
+  bool interval_cycles = false;
+  std::string profile_path;
+  std::string folded_path;
+  unsigned profile_top = 30;
+  bool lockstep_reference = false;
+  bool lockstep_strict = false;
+  std::string lockstep_log;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--engine=switch") {
+      engine = ENGINE::SWITCH;
+    } else if (arg == "--engine=threaded") {
+      engine = ENGINE::THREADED;
+    } else if (arg == "--core=analytic") {
+      core = CORE::ANALYTIC;
+    } else if (arg == "--core=ooo") {
+      core = CORE::OOO;
+    } else if (arg.compare(0, 11, "--core-opt=") == 0) {
+      std::string core_error;
+      if (!ooo_config.set(arg.substr(11), core_error)) {
+        std::cout << "Núcleo fora de ordem: " << core_error << std::endl;
+        return 1;
+      }
+    } else if (arg == "--functional") {
+      functional = true;
+    } else if (arg.compare(0, 8, "--trace=") == 0) {
+      trace_path = arg.substr(8);
+    } else if (arg == "--trace-compress") {
+      trace_compress = true;
+    } else if (arg == "--cache-backend=native") {
+      cache_backend = CACHE_BACKEND::NATIVE;
+    } else if (arg == "--cache-backend=dinero") {
+      cache_backend = CACHE_BACKEND::DINERO;
+    } else if (arg == "--cache-backend=crosscheck") {
+      cache_backend = CACHE_BACKEND::CROSSCHECK;
+    } else if (arg.compare(0, 15, "--cache-config=") == 0) {
+      cache_config_path = arg.substr(15);
+    } else if (arg.compare(0, 12, "--cache-opt=") == 0) {
+      cache_options.push_back(arg.substr(12));
+    } else if (arg.compare(0, 8, "--sweep=") == 0) {
+      sweep_path = arg.substr(8);
+    } else if (arg.compare(0, 15, "--sweep-output=") == 0) {
+      sweep_options.output = arg.substr(15);
+    } else if (arg.compare(0, 16, "--check-threads=") == 0) {
+      check_instances = std::stoi(arg.substr(16));
+    } else if (arg.compare(0, 7, "--jobs=") == 0) {
+      sweep_options.jobs = std::stoi(arg.substr(7));
+    } else if (arg.compare(0, 16, "--checkpoint-at=") == 0) {
+      checkpoint_at = std::stoull(arg.substr(16));
+    } else if (arg.compare(0, 18, "--checkpoint-file=") == 0) {
+      checkpoint_path = arg.substr(18);
+    } else if (arg.compare(0, 10, "--restore=") == 0) {
+      restore_path = arg.substr(10);
+    } else if (arg.compare(0, 11, "--simpoint=") == 0) {
+      simpoint = true;
+      simpoint_options.interval = std::stoull(arg.substr(11));
+    } else if (arg.compare(0, 20, "--simpoint-clusters=") == 0) {
+      simpoint_options.max_clusters = std::stoi(arg.substr(20));
+    } else if (arg.compare(0, 18, "--simpoint-warmup=") == 0) {
+      simpoint_options.warmup = std::stoull(arg.substr(18));
+    } else if (arg.compare(0, 19, "--simpoint-samples=") == 0) {
+      simpoint_options.cluster_samples = std::stoi(arg.substr(19));
+    } else if (arg.compare(0, 8, "--stats=") == 0) {
+      stats_path = arg.substr(8);
+    } else if (arg.compare(0, 17, "--stats-interval=") == 0) {
+      stats_interval = std::stoull(arg.substr(17));
+    } else if (arg.compare(0, 12, "--intervals=") == 0) {
+      intervals_path = arg.substr(12);
+    } else if (arg.compare(0, 11, "--interval=") == 0) {
+      interval = std::stoull(arg.substr(11));
+      interval_cycles = false;
+    } else if (arg.compare(0, 18, "--interval-cycles=") == 0) {
+      interval = std::stoull(arg.substr(18));
+      interval_cycles = true;
+    } else if (arg.compare(0, 10, "--profile=") == 0) {
+      profile_path = arg.substr(10);
+    } else if (arg.compare(0, 17, "--profile-folded=") == 0) {
+      folded_path = arg.substr(17);
+    } else if (arg.compare(0, 14, "--profile-top=") == 0) {
+      profile_top = std::stoul(arg.substr(14));
+    } else if (arg == "--lockstep") {
+      lockstep_reference = true;
+    } else if (arg == "--lockstep-strict") {
+      lockstep_reference = true;
+      lockstep_strict = true;
+    } else if (arg.compare(0, 15, "--lockstep-log=") == 0) {
+      lockstep_log = arg.substr(15);
+    } else if (arg == "--simpoint-verify") {
+      simpoint_options.verify = true;
+    } else if (arg.compare(0, 2, "--") == 0) {
+      std::cout << "Opção desconhecida: " << arg << std::endl;
+      usage();
       return 1;
+    } else {
+      args.push_back(argv[i]);
+    }
+  }
+  // Na varredura a janela e os bits do gshare são opcionais (valores usados
+  // quando a grade não possui essas dimensões)
+  bool sweep = !sweep_path.empty() || check_instances > 0;
+  if (args.size() != 3 && !(sweep && args.size() == 1)) {
+      usage();
+      return 1;
+  }
+  uint32_t i_window = (args.size() == 3) ? std::stoi(args[1]) : 4;
+  uint32_t b_gshare = (args.size() == 3) ? std::stoi(args[2]) : 10;
+  if (cache_backend != CACHE_BACKEND::NATIVE && !memory_t::hasDinero()) {
+    std::cout << "Simulador compilado sem o dineroIV (DINERO_INSTALL_DIR)"
+              << std::endl;
+    return 1;
   }
-  uint32_t i_window = std::stoi(argv[2]);
-  uint32_t b_gshare = std::stoi(argv[3]);
-
-  // Le arquivo ELF e retorna vetor com os bytes do arquivo
-  std::vector<uint8_t> elf_bytes = elf_by_byte(argv[1]);
-  // Pega informações relevantes pra execução
-  uint32_t entry_point = get_elf_entry(elf_bytes, 0x18, 4); // entry point do programa
-  uint32_t shes = get_elf_entry(elf_bytes, 0x2E, 2);
-  uint32_t shen = get_elf_entry(elf_bytes, 0x30, 2);
-  uint32_t entry_names = get_elf_entry(elf_bytes, 0x32, 2);
-  uint32_t shos = elf_bytes.size() - (shen * shes);
 
-  // Constroi a memoria do programa 
-  memory_t memory;
-  for (int i = 0; i < shen; i++) {
-    uint32_t s_addr = get_elf_entry(elf_bytes, shos + (i * shes) + 0x0C, 4);
-    uint32_t s_offset = get_elf_entry(elf_bytes, shos + (i * shes) + 0x10, 4);
-    uint32_t s_size = get_elf_entry(elf_bytes, shos + (i * shes) + 0x14, 4);
-    // printf("Address Entry: 0x%010X - Offset: 0x%010X\n", s_addr, s_offset);
-    for (int j = 0; j < s_size; j += 4) {
-      uint32_t base_address = s_addr + j;
-      if (base_address >= 0) {
-        memory.writeMem(base_address, elf_bytes[s_offset + j],
-                        ACCESS_TYPE::LOAD);
-        memory.writeMem(base_address + 1, elf_bytes[s_offset + j + 1],
-                        ACCESS_TYPE::LOAD);
-        memory.writeMem(base_address + 2, elf_bytes[s_offset + j + 2],
-                        ACCESS_TYPE::LOAD);
-        memory.writeMem(base_address + 3, elf_bytes[s_offset + j + 3],
-                        ACCESS_TYPE::LOAD);
+  // Hierarquia de caches: a padrão ou a do arquivo, com as opções da linha de
+  // comando aplicadas por cima
+  cache_config_t cache_config = cache_config_t::defaults();
+  std::string cache_error;
+  if (!cache_config_path.empty()) {
+    cache_config = cache_config_t();
+    if (!cache_config.load(cache_config_path, cache_error)) {
+      std::cout << "Configuração de caches: " << cache_error << std::endl;
+      return 1;
+    }
+  }
+  for (const std::string &option : cache_options) {
+    if (!cache_config.set(option, cache_error)) {
+      std::cout << "Configuração de caches: " << cache_error << std::endl;
+      return 1;
+    }
+  }
+  std::string core_error;
+  if (!ooo_config.validate(core_error)) {
+    std::cout << "Núcleo fora de ordem: " << core_error << std::endl;
+    return 1;
+  }
+  sweep_options.core = core;
+  sweep_options.ooo = ooo_config;
+  if (!cache_config.validate(cache_error)) {
+    std::cout << "Configuração de caches: " << cache_error << std::endl;
+    return 1;
+  }
+  if (cache_backend != CACHE_BACKEND::NATIVE) {
+    for (const cache_level_config_t &level : cache_config.levels) {
+      if (level.replacement == REPLACEMENT::PLRU) {
+        std::cout << "O dineroIV não suporta a substituição plru ("
+                  << level.name << ")" << std::endl;
+        return 1;
       }
     }
   }
 
+  // Varredura: a imagem do programa é carregada uma única vez e compartilhada
+  // por todas as simulações
+  if (sweep) {
+    if (cache_backend != CACHE_BACKEND::NATIVE || engine != ENGINE::SWITCH ||
+        functional || !trace_path.empty() || checkpoint_at > 0 ||
+        !restore_path.empty()) {
+      std::cout << "A varredura usa apenas o modelo temporizado com as caches "
+                   "nativas"
+                << std::endl;
+      return 1;
+    }
+    memory_t image(false);
+    uint32_t entry_point;
+    std::string elf_error;
+    if (!load_elf(args[0], image, &entry_point, elf_error)) {
+      std::cout << "ELF: " << elf_error << std::endl;
+      return 1;
+    }
+    if (check_instances > 0)
+      return runConcurrencyCheck(cache_config, image, entry_point,
+                                 check_instances);
+
+    sweep_grid_t grid;
+    std::string sweep_error;
+    if (!grid.load(sweep_path, sweep_error)) {
+      std::cout << "Varredura: " << sweep_error << std::endl;
+      return 1;
+    }
+    if (grid.windows.empty())
+      grid.windows.push_back(i_window);
+    if (grid.gshare_bits.empty())
+      grid.gshare_bits.push_back(b_gshare);
+    if (grid.btb_sizes.empty())
+      grid.btb_sizes.push_back(1024);
+    return runSweep(grid, cache_config, image, entry_point, sweep_options);
+  }
+
+  // Simulação amostrada: como na varredura, a imagem é carregada uma vez e
+  // compartilhada pelas execuções funcionais e detalhadas
+  if (simpoint) {
+    if (cache_backend != CACHE_BACKEND::NATIVE || engine != ENGINE::SWITCH ||
+        functional || !trace_path.empty() || checkpoint_at > 0 ||
+        !restore_path.empty() || core != CORE::ANALYTIC) {
+      std::cout << "O SimPoint usa apenas o modelo temporizado com as caches "
+                   "nativas"
+                << std::endl;
+      return 1;
+    }
+    if (simpoint_options.interval == 0 || simpoint_options.max_clusters == 0 ||
+        simpoint_options.cluster_samples == 0) {
+      usage();
+      return 1;
+    }
+    memory_t image(false);
+    uint32_t entry_point;
+    std::string elf_error;
+    if (!load_elf(args[0], image, &entry_point, elf_error)) {
+      std::cout << "ELF: " << elf_error << std::endl;
+      return 1;
+    }
+    processor_config_t processor_config;
+    processor_config.window = i_window;
+    processor_config.gshare_bits = b_gshare;
+    simpoint_options.jobs = sweep_options.jobs;
+    return runSimPoint(args[0], image, entry_point, processor_config,
+                       cache_config, simpoint_options);
+  }
+
+  // O motor de blocos é sempre funcional
+  if (engine == ENGINE::THREADED)
+    functional = true;
+
+  // O núcleo fora de ordem é um modelo de temporização. O estado arquitetural
+  // dele fica à frente do commit, então não pode ser gravado em checkpoints
+  // (mas pode continuar de um gravado pelo modelo analítico).
+  if (core == CORE::OOO && (functional || checkpoint_at > 0)) {
+    std::cout << "--core=ooo precisa do modelo temporizado e não pode gravar "
+                 "checkpoints"
+              << std::endl;
+    return 1;
+  }
+
+  // O checkpoint é gravado depois de um número exato de instruções
+  if (checkpoint_at > 0 && engine == ENGINE::THREADED) {
+    std::cout << "O checkpoint não está disponível com --engine=threaded"
+              << std::endl;
+    return 1;
+  }
+  if (checkpoint_path.empty())
+    checkpoint_path = std::string(args[0]) + ".ckpt";
+
+  // O trace é gravado instrução a instrução, só o motor switch o produz
+  trace_writer_t trace;
+  if (!trace_path.empty()) {
+    if (engine == ENGINE::THREADED) {
+      std::cout << "O trace não está disponível com --engine=threaded"
+                << std::endl;
+      return 1;
+    }
+    if (!trace.open(trace_path.c_str(), trace_compress, !functional)) {
+      std::cout << "Não foi possível criar o trace " << trace_path
+                << std::endl;
+      return 1;
+    }
+  }
+
+  // As estatísticas intermediárias precisam parar a execução a cada
+  // intervalo, o que o motor de blocos não faz
+  if (stats_interval > 0 && (stats_path.empty() || engine == ENGINE::THREADED)) {
+    std::cout << "--stats-interval precisa de --stats e do motor switch"
+              << std::endl;
+    return 1;
+  }
+  // O perfil é coletado instrução a instrução, como o trace
+  if ((!profile_path.empty() || !folded_path.empty()) &&
+      engine == ENGINE::THREADED) {
+    std::cout << "O perfil não está disponível com --engine=threaded"
+              << std::endl;
+    return 1;
+  }
+
+  // A referência começa do ELF, sem o estado de um checkpoint; o log de
+  // commits é comparado instrução a instrução, como o trace é gravado
+  bool use_lockstep = lockstep_reference || !lockstep_log.empty();
+  if (use_lockstep && !restore_path.empty()) {
+    std::cout << "O lockstep não está disponível com --restore" << std::endl;
+    return 1;
+  }
+  if (lockstep_reference && !lockstep_log.empty()) {
+    std::cout << "Use --lockstep ou --lockstep-log, não os dois" << std::endl;
+    return 1;
+  }
+  if (!lockstep_log.empty() && engine == ENGINE::THREADED) {
+    std::cout << "--lockstep-log não está disponível com --engine=threaded"
+              << std::endl;
+    return 1;
+  }
+  lockstep_t lockstep;
+  if (!lockstep_log.empty() && !lockstep.useLog(lockstep_log.c_str())) {
+    std::cout << "Não foi possível abrir o trace " << lockstep_log
+              << std::endl;
+    return 1;
+  }
+
+  // As séries por intervalo precisam do modelo temporizado
+  if (!intervals_path.empty() &&
+      (interval == 0 || functional || stats_interval > 0)) {
+    std::cout << "--intervals precisa de --interval ou --interval-cycles, do "
+                 "modelo temporizado e não pode ser usado com --stats-interval"
+              << std::endl;
+    return 1;
+  }
+  stream_writer_t intervals_writer;
+  if (!intervals_path.empty() && !intervals_writer.open(intervals_path.c_str())) {
+    std::cout << "Não foi possível abrir " << intervals_path << std::endl;
+    return 1;
+  }
+  FILE *stats_file = nullptr;
+  if (!stats_path.empty()) {
+    stats_file = fopen(stats_path.c_str(), "w");
+    if (stats_file == nullptr) {
+      std::cout << "Não foi possível criar " << stats_path << std::endl;
+      return 1;
+    }
+  }
+
+  // Constroi a memoria do programa 
+  memory_t memory(!functional, cache_backend, cache_config);
+  uint32_t entry_point;
+  std::string elf_error;
+  if (!load_elf(args[0], memory, &entry_point, elf_error)) {
+    std::cout << "ELF: " << elf_error << std::endl;
+    return 1;
+  }
+
   // Executa o simulador
-  processor_t processor(&memory, entry_point, i_window, b_gshare);
-  processor.executeProgram();
+  processor_config_t processor_config;
+  processor_config.window = i_window;
+  processor_config.gshare_bits = b_gshare;
+  processor_config.functional = functional;
+  processor_config.engine = engine;
+  processor_config.core = core;
+  processor_config.ooo = ooo_config;
+  processor_config.readEnvironment();
+  processor_t processor(&memory, entry_point, processor_config);
+  if (!trace_path.empty())
+    processor.setTrace(&trace);
+  std::unique_ptr<profiler_t> profiler;
+  if (!profile_path.empty() || !folded_path.empty()) {
+    profiler.reset(new profiler_t(entry_point));
+    elf_file_t elf;
+    if (elf.open(args[0], elf_error) && !profiler->loadSymbols(elf))
+      std::cout << "Perfil: o ELF não tem tabela de símbolos, as funções são "
+                   "identificadas pelo endereço"
+                << std::endl;
+    processor.setProfiler(profiler.get());
+  }
+  if (lockstep_reference) {
+    elf_file_t elf;
+    if (!elf.open(args[0], elf_error)) {
+      std::cout << "ELF: " << elf_error << std::endl;
+      return 1;
+    }
+    lockstep.useReference(elf, lockstep_strict);
+  }
+  if (use_lockstep)
+    processor.setLockstep(&lockstep);
+
+  // O checkpoint substitui o estado inicial do programa (que continua sendo
+  // carregado do ELF, o checkpoint só tem as páginas alteradas)
+  checkpoint_info_t checkpoint_info;
+  std::string checkpoint_error;
+  if (!restore_path.empty()) {
+    if (!restoreCheckpoint(restore_path.c_str(), args[0], processor, memory,
+                           &checkpoint_info, checkpoint_error)) {
+      std::cout << "Checkpoint: " << checkpoint_error << std::endl;
+      return 1;
+    }
+    std::cout << "Checkpoint restaurado: " << checkpoint_info.instret
+              << " instruções executadas" << std::endl;
+    if (checkpoint_info.warm_ignored && !functional)
+      std::cout << "Checkpoint: parte do estado aquecido (gshare, caches ou "
+                   "temporização) é de outra configuração e foi ignorada"
+                << std::endl;
+  }
+
+  if (checkpoint_at > 0) {
+    // Executa até a instrução pedida (contada desde o início do programa),
+    // grava o checkpoint e termina
+    if (checkpoint_at > processor.getInstret())
+      processor.run(checkpoint_at - processor.getInstret());
+    processor.printReport();
+    if (!trace.close()) {
+      std::cout << "Erro ao gravar o trace " << trace_path << std::endl;
+      return 1;
+    }
+    if (processor.getInstret() != checkpoint_at || !processor.isRunning()) {
+      std::cout << "O programa terminou antes de " << checkpoint_at
+                << " instruções, checkpoint não gravado" << std::endl;
+      return 1;
+    }
+    if (!saveCheckpoint(checkpoint_path.c_str(), args[0], processor, memory,
+                        !functional, &checkpoint_info, checkpoint_error)) {
+      std::cout << "Checkpoint: " << checkpoint_error << std::endl;
+      return 1;
+    }
+    std::cout << "Checkpoint gravado em " << checkpoint_path << ": "
+              << checkpoint_info.instret << " instruções, "
+              << checkpoint_info.pages << " páginas alteradas" << std::endl;
+    return 0;
+  }
+
+  if (!intervals_path.empty()) {
+    // Uma linha CSV por intervalo, gravada por outra thread
+    interval_sampler_t sampler(processor, memory, intervals_writer);
+    if (intervals_writer.wasEmpty())
+      sampler.writeHeader();
+    while (processor.isRunning()) {
+      if (interval_cycles)
+        processor.runCycles(interval);
+      else
+        processor.run(interval);
+      sampler.sample();
+    }
+  } else if (stats_interval > 0) {
+    // Uma linha JSON (acumulada desde o início) a cada intervalo; a última,
+    // com as descrições, é escrita no fim da execução
+    while (processor.isRunning()) {
+      processor.run(stats_interval);
+      if (processor.isRunning())
+        processor.getRegistry().writeJSON(stats_file, false);
+    }
+  } else {
+    processor.executeProgram();
+  }
+  processor.printReport();
+  if (!trace.close()) {
+    std::cout << "Erro ao gravar o trace " << trace_path << std::endl;
+    return 1;
+  }
+  if (!intervals_writer.close()) {
+    std::cout << "Erro ao gravar os intervalos em " << intervals_path
+              << std::endl;
+    return 1;
+  }
+  if (stats_file != nullptr) {
+    processor.getRegistry().writeJSON(stats_file, true);
+    fclose(stats_file);
+  }
+  if (profiler && !writeProfile(*profiler, profile_path, folded_path,
+                                profile_top))
+    return 1;
+  if (cache_backend == CACHE_BACKEND::CROSSCHECK && !functional)
+    memory.printCrossCheck();
+  if (use_lockstep) {
+    if (lockstep.hasDiverged())
+      return 1;
+    std::cout << "Lockstep: " << lockstep.getChecked()
+              << " instruções sem divergência" << std::endl;
+  }
 
   return 0;
 }
\ No newline at end of file
@@ -1,27 +1,29 @@
 #include "memory.h"
 
-#include <cmath>
 #include <cstdio>
+#include <cstring>
 
-#include <map>
+#include <atomic>
 #include <string>
 
+#include "checkpoint.h"
+#include "host_profile.h"
+#include "stats.h"
+
+#ifdef RVSIM_DINERO
 extern "C" {
 #include "d4.h"
 }
 
-#define INT_MAX (2147483647)
-
-// Get Misses from cache X
-#define cacheMisses(x)                                                         \
-  static_cast<int>(std::floor(caches[x]->miss[D4XREAD]) +                      \
-                   std::floor(caches[x]->miss[D4XWRITE]) +                     \
-                   std::floor(caches[x]->miss[D4XINSTRN]) +                    \
-                   std::floor(caches[x]->miss[D4XMISC]) +                      \
-                   std::floor(caches[x]->miss[D4XREAD + D4PREFETCH]) +         \
-                   std::floor(caches[x]->miss[D4XWRITE + D4PREFETCH]) +        \
-                   std::floor(caches[x]->miss[D4XINSTRN + D4PREFETCH]) +       \
-                   std::floor(caches[x]->miss[D4XMISC + D4PREFETCH]))
+// Total de misses de uma cache do dinero (os contadores são double)
+static inline double dineroMisses(d4cache *cache) {
+  return cache->miss[D4XREAD] + cache->miss[D4XWRITE] +
+         cache->miss[D4XINSTRN] + cache->miss[D4XMISC] +
+         cache->miss[D4XREAD + D4PREFETCH] +
+         cache->miss[D4XWRITE + D4PREFETCH] +
+         cache->miss[D4XINSTRN + D4PREFETCH] +
+         cache->miss[D4XMISC + D4PREFETCH];
+}
 
 void SetupDineroCache(d4cache *cache, const char *pname, int pflags,
                       int plg2bsize, int plg2sbsize, int plg2size, int passoc,
@@ -52,144 +54,433 @@ void SetupDineroCache(d4cache *cache, const char *pname, int pflags,
   cache->name_wback = (char *)"Wback";
 }
 
-memory_t::memory_t() { // size in MiBytes
+#endif
+
+memory_t::memory_t(bool model_caches, CACHE_BACKEND cache_backend,
+                   const cache_config_t &config) {
+  // Nenhuma página alocada inicialmente
+  for (uint32_t i = 0; i < PT_ENTRIES; i++)
+    page_dir[i] = nullptr;
+  last_page_number = UINT32_MAX;
+  last_page = nullptr;
+  last_page_writable = false;
+  code_pages.resize(1u << (32 - PAGE_BITS), false);
+
+  // Sem caches (modo funcional) nenhum acesso passa pelo modelo de caches
+  use_caches = model_caches;
+  backend = cache_backend;
+  cache_config = config;
+  l1i = l1d = 0;
+  last_miss_mask = 0;
+  d4_memory = nullptr;
+  for (int level = 0; level < CACHE_MAX_LEVELS; level++) {
+    miss_penalty[level] = 0;
+    level_misses[level] = 0;
+    level_misses_from_instructions[level] = 0;
+    d4_caches[level] = nullptr;
+    d4_misses[level] = 0;
+  }
+  if (!use_caches)
+    return;
+
+  // Modelo nativo, um nível da hierarquia para cada nível da descrição (a
+  // descrição já foi validada)
+  for (const cache_level_config_t &level : cache_config.levels) {
+    int index = hierarchy.addLevel(
+        cache_t(level), level.next.empty() ? -1 : cache_config.find(level.next));
+    miss_penalty[index] = level.miss_penalty;
+  }
+  l1i = cache_config.find(cache_config.instruction_level);
+  l1d = cache_config.find(cache_config.data_level);
+  l1i_block = hierarchy.getLevel(l1i).getLineSize();
+  l1d_block = hierarchy.getLevel(l1d).getLineSize();
+  if (backend == CACHE_BACKEND::NATIVE)
+    return;
+
+#ifdef RVSIM_DINERO
+  // O dinero guarda as caches em estado global (d4setup só pode ser chamado
+  // uma vez), então só uma memória por processo pode usá-lo
+  static std::atomic<bool> dinero_in_use(false);
+  if (dinero_in_use.exchange(true)) {
+    printf("O dineroIV só pode ser usado por uma memória por processo\n");
+    exit(1);
+  }
+
   // Cria cache mais baixo nível (memoria);
-  caches["memory"] = d4new(NULL);
-  // Cria L3
-  caches["L3"] = d4new(caches["memory"]);
-  SetupDineroCache(caches["L3"], "L3", 0, 10, 10, 23, 4, d4rep_lru,
-                   d4prefetch_none, 1, 0, d4walloc_always, d4wback_never);
-  // Cria L2
-  caches["L2"] = d4new(caches["L3"]);
-  SetupDineroCache(caches["L2"], "L3", 0, 10, 10, 18, 4, d4rep_lru,
-                   d4prefetch_none, 1, 0, d4walloc_always, d4wback_never);
-  // Cria L1
-  caches["L1d"] = d4new(caches["L2"]);
-  SetupDineroCache(caches["L1d"], "L1d", 0, 7, 7, 15, 4, d4rep_lru,
-                   d4prefetch_none, 1, 0, d4walloc_always, d4wback_never);
-  caches["L1i"] = d4new(caches["L2"]);
-  SetupDineroCache(caches["L1i"], "L1i", D4F_RO, 7, 7, 15, 4, d4rep_lru,
-                   d4prefetch_none, 1, 0, d4walloc_impossible, d4wback_never);
-
-  // // Cria L3
-  // caches["L3"] = d4new(caches["memory"]);
-  // SetupDineroCache(caches["L3"], "L3", 0, 7, 7, 23, 4, d4rep_lru,
-  //                  d4prefetch_none, 1, 0, d4walloc_always, d4wback_never);
-  // // Cria L2
-  // caches["L2"] = d4new(caches["L3"]);
-  // SetupDineroCache(caches["L2"], "L3", 0, 6, 6, 18, 4, d4rep_lru,
-  //                  d4prefetch_none, 1, 0, d4walloc_always, d4wback_never);
-  // // Cria L1
-  // caches["L1d"] = d4new(caches["L2"]);
-  // SetupDineroCache(caches["L1d"], "L1d", 0, 5, 5, 15, 4, d4rep_lru,
-  //                  d4prefetch_none, 1, 0, d4walloc_always, d4wback_never);
-  // caches["L1i"] = d4new(caches["L2"]);
-  // SetupDineroCache(caches["L1i"], "L1i", D4F_RO, 5, 5, 15, 4,
-  //                  d4rep_lru, d4prefetch_none, 1, 0, d4walloc_impossible,
-  //                  d4wback_never);
+  d4_memory = d4new(NULL);
+  for (int level = 0; level < hierarchy.getLevels(); level++)
+    setupDinero(level);
 
   // Setup Dinero
   if (d4setup() != 0) {
     printf("Dinero IV Setup Failed \n");
     exit(0);
   }
+#endif
 }
 
-uint32_t memory_t::writeMem(uint32_t address, uint8_t value, ACCESS_TYPE type) {
-  uint32_t cycles = 1;
-  if (type != ACCESS_TYPE::LOAD) {
-    // Verifica os misses antes do acesso
-    int pld_miss, pl2_miss, pl3_miss;
-    pld_miss = cacheMisses("L1d");
-    pl2_miss = cacheMisses("L2");
-    pl3_miss = cacheMisses("L3");
-
-    // Faz o acesso a memória
-    d4cache *top_level =
-        (type == ACCESS_TYPE::DATA) ? caches["L1d"] : caches["L1i"];
-    d4memref mem_ref;
-    mem_ref.address = (d4addr)address;
-    mem_ref.size = 1;
-    mem_ref.accesstype = D4XWRITE;
-    d4ref(top_level, mem_ref);
-
-    // Pega misses da cache depois de usá-la
-    int ld_miss, l2_miss, l3_miss;
-    ld_miss = cacheMisses("L1d");
-    l2_miss = cacheMisses("L2");
-    l3_miss = cacheMisses("L3");
-
-    // Verifica se houveram misses na cache
-    if (ld_miss > pld_miss) {
-      cycles += L1_MISS_PENALTY;
-      ld_misses++;
-    }
-    if (l2_miss > pl2_miss) {
-      cycles += L2_MISS_PENALTY;
-      l2_misses++;
-      if (type == ACCESS_TYPE::INSTRUCTION)
-        l2_misses_from_instructions++;
-    }
-    if (l3_miss > pl3_miss) {
-      cycles += L3_MISS_PENALTY;
-      l3_misses++;
-      if (type == ACCESS_TYPE::INSTRUCTION)
-        l3_misses_from_instructions++;
+// Cria a cache do dinero de um nível depois da cache do nível abaixo
+void memory_t::setupDinero([[maybe_unused]] int level) {
+#ifdef RVSIM_DINERO
+  if (d4_caches[level] != nullptr)
+    return;
+  int parent = hierarchy.getParent(level);
+  d4cache *downstream = d4_memory;
+  if (parent >= 0) {
+    setupDinero(parent);
+    downstream = d4_caches[parent];
+  }
+  const cache_level_config_t &config = cache_config.levels[level];
+  int lg2_line = cacheLog2(config.line_size);
+  d4_caches[level] = d4new(downstream);
+  // O dinero não possui pseudo-LRU, a validação da configuração do backend
+  // recusa essa política
+  SetupDineroCache(
+      d4_caches[level], config.name.c_str(), config.read_only ? D4F_RO : 0,
+      lg2_line, lg2_line, cacheLog2(config.size), config.ways,
+      config.replacement == REPLACEMENT::RANDOM ? d4rep_random : d4rep_lru,
+      config.prefetch == PREFETCH::NEXT_LINE ? d4prefetch_miss
+                                             : d4prefetch_none,
+      1, 0,
+      config.read_only        ? d4walloc_impossible
+      : config.write_allocate ? d4walloc_always
+                              : d4walloc_never,
+      config.write_back ? d4wback_always : d4wback_never);
+#endif
+}
+
+memory_t::~memory_t() {
+  for (uint32_t i = 0; i < PT_ENTRIES; i++) {
+    if (page_dir[i] == nullptr)
+      continue;
+    for (uint32_t j = 0; j < PT_ENTRIES; j++)
+      if (!page_dir[i]->shared[j])
+        delete[] page_dir[i]->pages[j];
+    delete page_dir[i];
+  }
+}
+
+uint8_t *memory_t::getPage(uint32_t address, bool allocate) {
+  uint32_t page_number = address >> PAGE_BITS;
+  // Acessos consecutivos costumam cair na mesma página
+  if (page_number == last_page_number && (!allocate || last_page_writable))
+    return last_page;
+
+  uint32_t dir_index = page_number >> PT_BITS;
+  uint32_t table_index = page_number & (PT_ENTRIES - 1);
+  page_table_t *table = page_dir[dir_index];
+  if (table == nullptr) {
+    if (!allocate)
+      return nullptr;
+    table = new page_table_t();
+    page_dir[dir_index] = table;
+  }
+  uint8_t *page = table->pages[table_index];
+  if (page == nullptr) {
+    if (!allocate)
+      return nullptr;
+    // Páginas novas começam zeradas, como a memória não escrita
+    page = new uint8_t[PAGE_SIZE]();
+    table->pages[table_index] = page;
+  } else if (allocate && table->shared[table_index]) {
+    // Primeira escrita em uma página da imagem: copia antes de alterar
+    uint8_t *copy = new uint8_t[PAGE_SIZE];
+    memcpy(copy, page, PAGE_SIZE);
+    page = copy;
+    table->pages[table_index] = page;
+    table->shared[table_index] = false;
+  }
+  last_page_number = page_number;
+  last_page = page;
+  last_page_writable = !table->shared[table_index];
+  return page;
+}
+
+void memory_t::shareImage(const memory_t &image) {
+  for (uint32_t i = 0; i < PT_ENTRIES; i++) {
+    if (image.page_dir[i] == nullptr)
+      continue;
+    page_table_t *table = new page_table_t();
+    for (uint32_t j = 0; j < PT_ENTRIES; j++) {
+      table->pages[j] = image.page_dir[i]->pages[j];
+      table->shared[j] = (table->pages[j] != nullptr);
     }
+    page_dir[i] = table;
   }
-  memory_map[address] = value;
-  return cycles;
+  last_page_number = UINT32_MAX;
+  last_page = nullptr;
 }
 
-uint32_t memory_t::readMem(uint32_t address, uint8_t *value, ACCESS_TYPE type) {
-  uint32_t cycles = 0;
-  if (type != ACCESS_TYPE::LOAD) {
-    // Verifica os misses antes do acesso
-    int pli_miss, pld_miss, pl2_miss, pl3_miss;
-    pli_miss = cacheMisses("L1i");
-    pld_miss = cacheMisses("L1d");
-    pl2_miss = cacheMisses("L2");
-    pl3_miss = cacheMisses("L3");
-
-    // Faz o acesso a memória
-    d4cache *top_level =
-        (type == ACCESS_TYPE::DATA) ? caches["L1d"] : caches["L1i"];
-    d4memref mem_ref;
-    mem_ref.address = (d4addr)address;
-    mem_ref.size = 1;
+uint32_t memory_t::dineroAccess([[maybe_unused]] uint32_t address,
+                                [[maybe_unused]] uint32_t size,
+                                [[maybe_unused]] ACCESS_TYPE type,
+                                [[maybe_unused]] bool write) {
+  uint32_t miss_mask = 0;
+#ifdef RVSIM_DINERO
+  HOST_PROFILE_SCOPE(DINERO);
+  d4cache *top_level =
+      (type == ACCESS_TYPE::DATA) ? d4_caches[l1d] : d4_caches[l1i];
+
+  // Faz o acesso a memória
+  d4memref mem_ref;
+  mem_ref.address = (d4addr)address;
+  mem_ref.size = size;
+  if (write)
+    mem_ref.accesstype = D4XWRITE;
+  else
     mem_ref.accesstype = (type == ACCESS_TYPE::DATA) ? D4XREAD : D4XINSTRN;
-    d4ref(top_level, mem_ref);
-
-    // Pega misses da cache depois de usá-la
-    int li_miss, ld_miss, l2_miss, l3_miss;
-    li_miss = cacheMisses("L1i");
-    ld_miss = cacheMisses("L1d");
-    l2_miss = cacheMisses("L2");
-    l3_miss = cacheMisses("L3");
-
-    // Verifica se houveram misses na cache
-    if (li_miss > pli_miss) {
-      cycles += L1_MISS_PENALTY;
-      li_misses++;
+  d4ref(top_level, mem_ref);
+
+  // Compara os misses de cada cache com o total após o acesso anterior
+  for (int level = 0; level < hierarchy.getLevels(); level++) {
+    double misses = dineroMisses(d4_caches[level]);
+    if (misses != d4_misses[level]) {
+      d4_misses[level] = misses;
+      miss_mask |= 1u << level;
     }
-    if (ld_miss > pld_miss) {
-      cycles += L1_MISS_PENALTY;
-      ld_misses++;
+  }
+#endif
+  return miss_mask;
+}
+
+uint32_t memory_t::cacheAccess(uint32_t address, uint32_t size,
+                               ACCESS_TYPE type, bool write) {
+  HOST_PROFILE_SCOPE(CACHE);
+  uint32_t cycles = 0;
+  int top_level = (type == ACCESS_TYPE::DATA) ? l1d : l1i;
+  uint32_t block_size = (type == ACCESS_TYPE::DATA) ? l1d_block : l1i_block;
+  last_miss_mask = 0;
+  while (size > 0) {
+    // O acesso é quebrado na fronteira do bloco da L1 (o dinero não aceita
+    // referências que cruzam blocos)
+    uint32_t chunk = block_size - (address & (block_size - 1));
+    if (chunk > size)
+      chunk = size;
+
+    uint32_t miss_mask;
+    if (backend == CACHE_BACKEND::DINERO) {
+      miss_mask = dineroAccess(address, chunk, type, write);
+    } else {
+      miss_mask = write ? hierarchy.write(top_level, address)
+                        : hierarchy.read(top_level, address);
+      // No modo de verificação o dinero é a referência para o tempo
+      if (backend == CACHE_BACKEND::CROSSCHECK) {
+        uint32_t dinero_mask = dineroAccess(address, chunk, type, write);
+        crosscheck_accesses++;
+        if (dinero_mask != miss_mask)
+          crosscheck_divergences++;
+        miss_mask = dinero_mask;
+      }
     }
-    if (l2_miss > pl2_miss) {
-      cycles += L2_MISS_PENALTY;
-      l2_misses++;
+
+    // Soma a penalidade de cada nível que teve miss
+    last_miss_mask |= miss_mask;
+    while (miss_mask != 0) {
+      int level = __builtin_ctz(miss_mask);
+      miss_mask &= miss_mask - 1;
+      cycles += miss_penalty[level];
+      level_misses[level]++;
       if (type == ACCESS_TYPE::INSTRUCTION)
-        l2_misses_from_instructions++;
+        level_misses_from_instructions[level]++;
     }
-    if (l3_miss > pl3_miss) {
-      cycles += L3_MISS_PENALTY;
-      l3_misses++;
-      if (type == ACCESS_TYPE::INSTRUCTION)
-        l3_misses_from_instructions++;
+    address += chunk;
+    size -= chunk;
+  }
+  return cycles;
+}
+
+std::vector<uint32_t> memory_t::getPageAddresses() const {
+  std::vector<uint32_t> addresses;
+  for (uint32_t i = 0; i < PT_ENTRIES; i++) {
+    if (page_dir[i] == nullptr)
+      continue;
+    for (uint32_t j = 0; j < PT_ENTRIES; j++)
+      if (page_dir[i]->pages[j] != nullptr)
+        addresses.push_back(((i << PT_BITS) | j) << PAGE_BITS);
+  }
+  return addresses;
+}
+
+const uint8_t *memory_t::peekPage(uint32_t address) const {
+  uint32_t page_number = address >> PAGE_BITS;
+  const page_table_t *table = page_dir[page_number >> PT_BITS];
+  if (table == nullptr)
+    return nullptr;
+  return table->pages[page_number & (PT_ENTRIES - 1)];
+}
+
+void memory_t::saveCacheState(checkpoint_writer_t &writer) const {
+  // Só o modelo nativo tem o estado acessível; o dineroIV fica de fora
+  checkpoint_writer_t block;
+  int levels = (use_caches && backend == CACHE_BACKEND::NATIVE)
+                   ? hierarchy.getLevels()
+                   : 0;
+  block.putVarint(levels);
+  for (int level = 0; level < levels; level++)
+    hierarchy.getLevel(level).saveGeometry(block);
+  for (int level = 0; level < levels; level++)
+    hierarchy.getLevel(level).saveState(block);
+  writer.putBlock(block);
+}
+
+bool memory_t::loadCacheState(checkpoint_reader_t &reader) {
+  checkpoint_reader_t block = reader.getBlock();
+  int levels = block.getVarint();
+  if (!use_caches || backend != CACHE_BACKEND::NATIVE || levels == 0 ||
+      levels != hierarchy.getLevels())
+    return false;
+  for (int level = 0; level < levels; level++)
+    if (!hierarchy.getLevel(level).sameGeometry(block))
+      return false;
+  // Cada nível é lido em uma cópia, aplicada só se o bloco inteiro for válido
+  std::vector<cache_t> staged;
+  for (int level = 0; level < levels; level++) {
+    staged.push_back(hierarchy.getLevel(level));
+    staged.back().loadState(block);
+  }
+  if (!block.good())
+    return false;
+  for (int level = 0; level < levels; level++)
+    hierarchy.getLevel(level) = staged[level];
+  return true;
+}
+
+void memory_t::watchCodePage(uint32_t address) {
+  code_pages[address >> PAGE_BITS] = true;
+}
+
+void memory_t::checkCodeWrite(uint32_t address) {
+  uint32_t page_number = address >> PAGE_BITS;
+  if (code_pages[page_number]) {
+    // Avisa uma única vez, a página volta a ser observada quando alguma
+    // instrução dela for decodificada novamente
+    code_pages[page_number] = false;
+    code_writes.push_back(page_number << PAGE_BITS);
+  }
+}
+
+bool memory_t::popCodeWrite(uint32_t *address) {
+  if (code_writes.empty())
+    return false;
+  *address = code_writes.back();
+  code_writes.pop_back();
+  return true;
+}
+
+void memory_t::copyToPages(uint32_t address, const uint8_t *buffer,
+                           uint32_t size) {
+  while (size > 0) {
+    uint32_t offset = address & PAGE_MASK;
+    uint32_t chunk = PAGE_SIZE - offset;
+    if (chunk > size)
+      chunk = size;
+    checkCodeWrite(address);
+    memcpy(getPage(address, true) + offset, buffer, chunk);
+    address += chunk;
+    buffer += chunk;
+    size -= chunk;
+  }
+}
+
+void memory_t::zeroBlock(uint32_t address, uint32_t size) {
+  while (size > 0) {
+    uint32_t offset = address & PAGE_MASK;
+    uint32_t chunk = PAGE_SIZE - offset;
+    if (chunk > size)
+      chunk = size;
+    if (getPage(address, false) != nullptr) {
+      checkCodeWrite(address);
+      memset(getPage(address, true) + offset, 0, chunk);
     }
+    address += chunk;
+    size -= chunk;
   }
-  *value = memory_map[address];
+}
+
+void memory_t::copyFromPages(uint32_t address, uint8_t *buffer,
+                             uint32_t size) {
+  while (size > 0) {
+    uint32_t offset = address & PAGE_MASK;
+    uint32_t chunk = PAGE_SIZE - offset;
+    if (chunk > size)
+      chunk = size;
+    // Leitura de página nunca escrita retorna 0 sem alocar a página
+    uint8_t *page = getPage(address, false);
+    if (page != nullptr)
+      memcpy(buffer, page + offset, chunk);
+    else
+      memset(buffer, 0, chunk);
+    address += chunk;
+    buffer += chunk;
+    size -= chunk;
+  }
+}
+
+// Escritas custam 1 ciclo por byte escrito, além das penalidades de miss
+uint32_t memory_t::writeMem(uint32_t address, uint8_t value, ACCESS_TYPE type) {
+  uint32_t cycles = 1;
+  if (type != ACCESS_TYPE::LOAD && use_caches)
+    cycles += cacheAccess(address, 1, type, true);
+  checkCodeWrite(address);
+  getPage(address, true)[address & PAGE_MASK] = value;
+  return cycles;
+}
+
+uint32_t memory_t::writeMem16(uint32_t address, uint16_t value,
+                              ACCESS_TYPE type) {
+  uint8_t bytes[2] = {(uint8_t)value, (uint8_t)(value >> 8)};
+  return writeBlock(address, bytes, 2, type);
+}
+
+uint32_t memory_t::writeMem32(uint32_t address, uint32_t value,
+                              ACCESS_TYPE type) {
+  uint8_t bytes[4] = {(uint8_t)value, (uint8_t)(value >> 8),
+                      (uint8_t)(value >> 16), (uint8_t)(value >> 24)};
+  return writeBlock(address, bytes, 4, type);
+}
+
+uint32_t memory_t::writeBlock(uint32_t address, const uint8_t *buffer,
+                              uint32_t size, ACCESS_TYPE type) {
+  uint32_t cycles = size;
+  if (type != ACCESS_TYPE::LOAD && use_caches)
+    cycles += cacheAccess(address, size, type, true);
+  copyToPages(address, buffer, size);
+  return cycles;
+}
+
+uint32_t memory_t::readMem(uint32_t address, uint8_t *value, ACCESS_TYPE type) {
+  uint32_t cycles = 0;
+  if (type != ACCESS_TYPE::LOAD && use_caches)
+    cycles += cacheAccess(address, 1, type, false);
+  // Leitura de página nunca escrita retorna 0 sem alocar a página
+  uint8_t *page = getPage(address, false);
+  *value = (page != nullptr) ? page[address & PAGE_MASK] : 0;
+  return cycles;
+}
+
+uint32_t memory_t::readMem16(uint32_t address, uint16_t *value,
+                             ACCESS_TYPE type) {
+  uint8_t bytes[2];
+  uint32_t cycles = readBlock(address, bytes, 2, type);
+  *value = bytes[0] | (bytes[1] << 8);
+  return cycles;
+}
+
+uint32_t memory_t::readMem32(uint32_t address, uint32_t *value,
+                             ACCESS_TYPE type) {
+  uint8_t bytes[4];
+  uint32_t cycles = readBlock(address, bytes, 4, type);
+  *value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) |
+           ((uint32_t)bytes[3] << 24);
+  return cycles;
+}
+
+uint32_t memory_t::readBlock(uint32_t address, uint8_t *buffer, uint32_t size,
+                             ACCESS_TYPE type) {
+  uint32_t cycles = 0;
+  if (type != ACCESS_TYPE::LOAD && use_caches)
+    cycles += cacheAccess(address, size, type, false);
+  copyFromPages(address, buffer, size);
   return cycles;
 }
 
@@ -198,51 +489,98 @@ uint32_t memory_t::getTotalSize() {
   }
 
 void memory_t::printCacheMisses() {
-  printf("  Li Misses: %d\n", li_misses);
-  printf("  Ld Misses: %d\n", ld_misses);
-  printf("  L2 Misses: %d - From instructions: %d\n", l2_misses,
-         l2_misses_from_instructions);
-  printf("  L3 Misses: %d - From instructions: %d\n", l3_misses,
-         l3_misses_from_instructions);
+  printf("  Li Misses: %d\n", level_misses[l1i]);
+  printf("  Ld Misses: %d\n", level_misses[l1d]);
+  for (int level = 0; level < hierarchy.getLevels(); level++) {
+    if (level == l1i || level == l1d)
+      continue;
+    printf("  %s Misses: %d - From instructions: %d\n",
+           hierarchy.getLevel(level).getName().c_str(), level_misses[level],
+           level_misses_from_instructions[level]);
+  }
 }
 
 void memory_t::printd4log() {
-  // L1i
-  printf("L1i dineroIV log:\n");
-  printf("Bytes read: %e - Bytes Written: %e\n", caches["L1i"]->bytes_read,
-         caches["L1i"]->bytes_written);
-  printf("Read fetches %e - Read misses: %e\n", caches["L1i"]->fetch[D4XINSTRN],
-         caches["L1i"]->miss[D4XINSTRN]);
-  printf("Write fetches %e - Write misses: %e\n\n",
-         caches["L1i"]->fetch[D4XWRITE], caches["L1i"]->miss[D4XWRITE]);
-
-  // L1d
-  printf("L1d dineroIV log:\n");
-  printf("Bytes read: %e - Bytes Written: %e\n", caches["L1d"]->bytes_read,
-         caches["L1d"]->bytes_written);
-  printf("Read fetches %e - Read misses: %e\n",
-         caches["L1d"]->fetch[D4XREAD] + caches["L1d"]->fetch[D4XINSTRN],
-         caches["L1d"]->miss[D4XREAD] + caches["L1d"]->fetch[D4XINSTRN]);
-  printf("Write fetches %e - Write misses: %e\n\n",
-         caches["L1d"]->fetch[D4XWRITE], caches["L1d"]->miss[D4XWRITE]);
-
-  // L2
-  printf("L2 dineroIV log:\n");
-  printf("Bytes read: %e - Bytes Written: %e\n", caches["L2"]->bytes_read,
-         caches["L2"]->bytes_written);
-  printf("Read fetches %e - Read misses: %e\n",
-         caches["L2"]->fetch[D4XREAD] + caches["L2"]->fetch[D4XINSTRN],
-         caches["L2"]->miss[D4XREAD] + caches["L2"]->fetch[D4XINSTRN]);
-  printf("Write fetches %e - Write misses: %e\n\n",
-         caches["L2"]->fetch[D4XWRITE], caches["L2"]->miss[D4XWRITE]);
-
-  // L3
-  printf("L3 dineroIV log:\n");
-  printf("Bytes read: %e - Bytes Written: %e\n", caches["L3"]->bytes_read,
-         caches["L3"]->bytes_written);
-  printf("Read fetches %e - Read misses: %e\n",
-         caches["L3"]->fetch[D4XREAD] + caches["L3"]->fetch[D4XINSTRN],
-         caches["L3"]->miss[D4XREAD] + caches["L3"]->fetch[D4XINSTRN]);
-  printf("Write fetches %e - Write misses: %e\n\n",
-         caches["L3"]->fetch[D4XWRITE], caches["L3"]->miss[D4XWRITE]);
+  for (int level = 0; level < hierarchy.getLevels(); level++) {
+    if (backend == CACHE_BACKEND::NATIVE) {
+      cache_t &cache = hierarchy.getLevel(level);
+      printf("%s log:\n", cache.getName().c_str());
+      printf("Accesses: %lu - Misses: %lu\n", (unsigned long)cache.getAccesses(),
+             (unsigned long)cache.getMisses());
+      printf("Prefetches: %lu - Writebacks: %lu\n\n",
+             (unsigned long)cache.getPrefetches(),
+             (unsigned long)cache.getWritebacks());
+      continue;
+    }
+#ifdef RVSIM_DINERO
+    d4cache *cache = d4_caches[level];
+    printf("%s dineroIV log:\n", cache->name);
+    printf("Bytes read: %e - Bytes Written: %e\n", cache->bytes_read,
+           cache->bytes_written);
+    printf("Read fetches %e - Read misses: %e\n",
+           cache->fetch[D4XREAD] + cache->fetch[D4XINSTRN],
+           cache->miss[D4XREAD] + cache->miss[D4XINSTRN]);
+    printf("Write fetches %e - Write misses: %e\n\n", cache->fetch[D4XWRITE],
+           cache->miss[D4XWRITE]);
+#endif
+  }
+}
+
+void memory_t::printCrossCheck() {
+  printf("Verificação das caches (nativo x dineroIV): %lu acessos, %lu "
+         "divergências\n",
+         (unsigned long)crosscheck_accesses,
+         (unsigned long)crosscheck_divergences);
+}
+
+int memory_t::getCacheLevels() { return hierarchy.getLevels(); }
+
+const std::string &memory_t::getCacheName(int level) {
+  return hierarchy.getLevel(level).getName();
+}
+
+int memory_t::getCacheMisses(int level) { return level_misses[level]; }
+
+uint64_t memory_t::getCacheAccesses(int level) {
+  if (backend == CACHE_BACKEND::DINERO)
+    return 0;
+  return hierarchy.getLevel(level).getAccesses();
+}
+
+void memory_t::registerStats(stats_registry_t &registry) {
+  if (!use_caches)
+    return;
+  for (int level = 0; level < hierarchy.getLevels(); level++) {
+    std::string name = "cache." + hierarchy.getLevel(level).getName();
+    registry.addValue(name + ".misses", "misses no nível", [this, level]() {
+      return level_misses[level];
+    });
+    registry.addValue(name + ".instruction_misses",
+                      "misses causados por buscas de instruções",
+                      [this, level]() {
+                        return level_misses_from_instructions[level];
+                      });
+    // Os contadores das caches nativas não são atualizados só com o dineroIV
+    if (backend == CACHE_BACKEND::DINERO)
+      continue;
+    registry.addValue(name + ".accesses", "acessos ao nível", [this, level]() {
+      return hierarchy.getLevel(level).getAccesses();
+    });
+    registry.addValue(name + ".prefetches", "blocos trazidos por prefetch",
+                      [this, level]() {
+                        return hierarchy.getLevel(level).getPrefetches();
+                      });
+    registry.addValue(name + ".writebacks", "blocos sujos escritos abaixo",
+                      [this, level]() {
+                        return hierarchy.getLevel(level).getWritebacks();
+                      });
+  }
+}
+
+bool memory_t::hasDinero() {
+#ifdef RVSIM_DINERO
+  return true;
+#else
+  return false;
+#endif
 }
@@ -0,0 +1,653 @@
+#include "ooo_core.h"
+
+#include <cstdlib>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+#include "host_profile.h"
+#include "processor.h"
+#include "profiler.h"
+
+/***************************************************************************
+Configuração
+***************************************************************************/
+bool ooo_config_t::set(const std::string &option, std::string &error) {
+  size_t equal = option.find('=');
+  if (equal == std::string::npos) {
+    error = "opção sem valor: " + option;
+    return false;
+  }
+  std::string key = option.substr(0, equal);
+  std::string value = option.substr(equal + 1);
+  char *end;
+  unsigned long number = strtoul(value.c_str(), &end, 10);
+  if (value.empty() || *end != '\0') {
+    error = "valor inválido para " + key + ": " + value;
+    return false;
+  }
+  if (key == "rob")
+    rob_entries = number;
+  else if (key == "iq.alu")
+    iq_entries[(int)FU::ALU] = number;
+  else if (key == "iq.agu")
+    iq_entries[(int)FU::AGU] = number;
+  else if (key == "iq.bru")
+    iq_entries[(int)FU::BRU] = number;
+  else if (key == "prf")
+    physical_registers = number;
+  else if (key == "lsq")
+    lsq_entries = number;
+  else if (key == "fetch_queue")
+    fetch_queue = number;
+  else if (key == "spec_loads" && number <= 1)
+    spec_loads = number;
+  else if (key == "spec_loads") {
+    error = "spec_loads aceita só 0 ou 1";
+    return false;
+  } else {
+    error = "chave desconhecida: " + key;
+    return false;
+  }
+  return true;
+}
+
+bool ooo_config_t::validate(std::string &error) const {
+  if (rob_entries == 0 || lsq_entries == 0 || fetch_queue == 0 ||
+      iq_entries[0] == 0 || iq_entries[1] == 0 || iq_entries[2] == 0) {
+    error = "o ROB, as filas de issue, a LSQ e a fila de busca precisam de "
+            "pelo menos 1 entrada";
+    return false;
+  }
+  if (physical_registers <= 32) {
+    error = "prf precisa ser maior que os 32 registradores arquiteturais";
+    return false;
+  }
+  return true;
+}
+
+/***************************************************************************
+Núcleo fora de ordem
+***************************************************************************/
+ooo_core_t::ooo_core_t(processor_t &processor, const ooo_config_t &pconfig,
+                       uint32_t pwidth)
+    : p(processor) {
+  config = pconfig;
+  width = pwidth;
+  now = 0;
+  committed_in_cycle = 0;
+  last_commit = 0;
+  rob.resize(config.rob_entries);
+  rob_head = 0;
+  rob_count = 0;
+  // No início cada registrador arquitetural está no físico de mesmo número
+  ready_at.assign(config.physical_registers, 0);
+  for (int r = 0; r < 32; r++)
+    rename_map[r] = r;
+  for (uint32_t reg = config.physical_registers - 1; reg >= 32; reg--)
+    free_list.push_back(reg);
+  next_seq = 1;
+
+  // Um conjunto de MSHRs por nível da hierarquia (os acessos de dados
+  // começam no nível de data_level)
+  memory_t *memory = p.memory;
+  data_level = memory->getDataLevel();
+  for (int level = 0; level < memory->getCacheLevels(); level++) {
+    const cache_level_config_t &level_config = memory->getCacheConfig(level);
+    mshrs[level].assign(level_config.mshrs, ooo_mshr_t{0, 0});
+    line_bits[level] = __builtin_ctz(level_config.line_size);
+  }
+  wait_table.assign(OOO_WAIT_TABLE, false);
+  squash_seq = OOO_NEVER;
+
+  fetch_cycle = 0;
+  fetch_blocked = false;
+  fetch_done = false;
+}
+
+void ooo_core_t::registerStats(stats_registry_t &registry) {
+  registry.addCounter("ooo.dispatch_stall.rob",
+                      "ciclos com a alocação parada por ROB cheio",
+                      &ooo_stats.dispatch_rob);
+  registry.addCounter("ooo.dispatch_stall.iq.alu",
+                      "ciclos com a alocação parada pela fila da ALU cheia",
+                      &ooo_stats.dispatch_iq[(int)FU::ALU]);
+  registry.addCounter("ooo.dispatch_stall.iq.agu",
+                      "ciclos com a alocação parada pela fila da AGU cheia",
+                      &ooo_stats.dispatch_iq[(int)FU::AGU]);
+  registry.addCounter("ooo.dispatch_stall.iq.bru",
+                      "ciclos com a alocação parada pela fila da BRU cheia",
+                      &ooo_stats.dispatch_iq[(int)FU::BRU]);
+  registry.addCounter("ooo.dispatch_stall.lsq",
+                      "ciclos com a alocação parada por LSQ cheia",
+                      &ooo_stats.dispatch_lsq);
+  registry.addCounter("ooo.dispatch_stall.prf",
+                      "ciclos com a alocação parada sem registrador físico "
+                      "livre",
+                      &ooo_stats.dispatch_prf);
+  registry.addCounter("ooo.fetch_stall.icache",
+                      "ciclos sem busca esperando um miss na cache de "
+                      "instruções",
+                      &ooo_stats.fetch_icache);
+  registry.addCounter("ooo.fetch_stall.mispredict",
+                      "ciclos sem busca esperando um salto com predição errada",
+                      &ooo_stats.fetch_mispredict);
+  registry.addCounter("ooo.fetch_stall.queue",
+                      "ciclos sem busca com a fila de busca cheia",
+                      &ooo_stats.fetch_queue_full);
+  registry.addCounter("ooo.issued.alu", "instruções enviadas às ALUs",
+                      &ooo_stats.issued[(int)FU::ALU]);
+  registry.addCounter("ooo.issued.agu", "instruções enviadas à AGU",
+                      &ooo_stats.issued[(int)FU::AGU]);
+  registry.addCounter("ooo.issued.bru", "instruções enviadas à BRU",
+                      &ooo_stats.issued[(int)FU::BRU]);
+  registry.addCounter("ooo.load_store_waits",
+                      "ciclos de loads prontos esperando um store anterior",
+                      &ooo_stats.load_store_waits);
+  registry.addCounter("ooo.loads_forwarded",
+                      "loads que receberam o dado de um store da LSQ",
+                      &ooo_stats.loads_forwarded);
+  registry.addCounter("ooo.loads_speculative",
+                      "loads enviados antes de stores com endereço "
+                      "desconhecido",
+                      &ooo_stats.loads_speculative);
+  registry.addCounter("ooo.order_violations",
+                      "loads refeitos por lerem antes de um store anterior "
+                      "nos mesmos bytes",
+                      &ooo_stats.order_violations);
+  registry.addCounter("ooo.mshr_merges",
+                      "loads que aproveitaram um miss pendente da mesma linha",
+                      &ooo_stats.mshr_merges);
+  memory_t *memory = p.memory;
+  for (int level = 0; level < memory->getCacheLevels(); level++) {
+    const std::string &name = memory->getCacheConfig(level).name;
+    registry.addCounter("ooo.mshr_waits." + name,
+                        "ciclos de acessos esperando um MSHR livre na " + name,
+                        &ooo_stats.mshr_waits[level]);
+  }
+  registry.addCounter("ooo.store_commit_waits",
+                      "ciclos com o commit parado por um store sem MSHR livre",
+                      &ooo_stats.store_commit_waits);
+  registry.addValue("ooo.rob.occupancy", "ocupação média do ROB", [this]() {
+    return now ? ooo_stats.rob_occupancy / (now * 1.0) : 0;
+  });
+}
+
+// Tamanho do acesso à memória de um load ou store
+static uint32_t accessSize(MNE op) {
+  switch (op) {
+  case MNE::LB:
+  case MNE::LBU:
+  case MNE::SB:
+    return 1;
+  case MNE::LH:
+  case MNE::LHU:
+  case MNE::SH:
+    return 2;
+  default:
+    return 4;
+  }
+}
+
+void ooo_core_t::fetchOne(ooo_entry_t &entry, bool *stop) {
+  memory_t *memory = p.memory;
+  if (p.profiler != nullptr)
+    entry.icache_misses =
+        memory->getCacheMisses(memory->getInstructionLevel());
+  uint32_t raw_instruction, pc_instruction;
+  bool prediction;
+  uint32_t fetch_cycles =
+      p.Fetch(&raw_instruction, &pc_instruction, &prediction);
+  entry.ins = p.Decode(raw_instruction, pc_instruction);
+  const decoded_t &ins = entry.ins;
+  if (p.profiler != nullptr) {
+    entry.icache_misses =
+        memory->getCacheMisses(memory->getInstructionLevel()) -
+        entry.icache_misses;
+    entry.dcache_misses = memory->getCacheMisses(memory->getDataLevel());
+  }
+
+  // O endereço é calculado antes da execução, que pode sobrescrever rs1
+  bool mem_access = ins.fu == FU::AGU;
+  entry.mem_address = mem_access ? p.registers.readReg(ins.rs1) + ins.imm : 0;
+  entry.mem_size = mem_access ? accessSize(ins.op) : 0;
+  entry.is_store = ins.op == MNE::SB || ins.op == MNE::SH || ins.op == MNE::SW;
+  entry.is_load = mem_access && !entry.is_store;
+  entry.mem_cycles = p.Execute(ins);
+  entry.miss_mask = mem_access ? memory->getLastMissMask() : 0;
+  if (!mem_access)
+    entry.mem_cycles = 0;
+  entry.seq = next_seq++;
+  entry.forward_seq = 0;
+  entry.speculative = false;
+  entry.mispredicted = false;
+  if (p.is_branch) {
+    entry.mispredicted = p.branched != prediction;
+    p.gshare->feedback(p.branched, pc_instruction, p.PC);
+  }
+  if (mem_access)
+    p.syncDecodeCache();
+  entry.next_pc = p.PC;
+  if (p.profiler != nullptr)
+    entry.dcache_misses =
+        memory->getCacheMisses(memory->getDataLevel()) - entry.dcache_misses;
+  if (p.trace != nullptr)
+    p.traceRecord(ins, entry.mem_address, 0, 0, 0, &entry.record);
+  if (p.lockstep != nullptr)
+    p.checkLockstep(ins, entry.mem_address);
+
+  entry.fetched = now;
+  entry.decoded =
+      now + fetch_cycles + BASE_DECODE_DURATION + BASE_ALLOC_DURATION;
+  entry.dispatched = entry.issued = entry.completed = OOO_NEVER;
+  entry.dest = entry.old_dest = 0;
+
+  // O grupo de busca termina no miss na cache de instruções, no salto
+  // tomado e no fim do programa. Com a predição errada a busca só volta
+  // quando o salto executar.
+  if (fetch_cycles > BASE_FETCH_DURATION) {
+    uint32_t miss_cycles = fetch_cycles - BASE_FETCH_DURATION;
+    fetch_cycle = now + miss_cycles;
+    p.stalls.icache_misses++;
+    p.stalls.icache_miss_cycles += miss_cycles;
+    *stop = true;
+  }
+  entry.blocks_fetch = entry.mispredicted;
+  if (entry.mispredicted) {
+    fetch_blocked = true;
+    p.stalls.mispredictions++;
+    *stop = true;
+  }
+  if (p.branched)
+    *stop = true;
+  // A instrução que termina o programa ainda passa pelo pipeline
+  if (!p.running) {
+    fetch_done = true;
+    p.running = true;
+    *stop = true;
+  }
+}
+
+void ooo_core_t::fetch() {
+  HOST_PROFILE_SCOPE(FETCH);
+  if (fetch_done)
+    return;
+  if (fetch_blocked) {
+    ooo_stats.fetch_mispredict++;
+    return;
+  }
+  if (now < fetch_cycle) {
+    ooo_stats.fetch_icache++;
+    return;
+  }
+  for (uint32_t i = 0; i < width; i++) {
+    if (fetch_queue.size() >= config.fetch_queue) {
+      if (i == 0)
+        ooo_stats.fetch_queue_full++;
+      return;
+    }
+    fetch_queue.emplace_back();
+    bool stop = false;
+    fetchOne(fetch_queue.back(), &stop);
+    if (stop)
+      return;
+  }
+}
+
+void ooo_core_t::dispatch() {
+  for (uint32_t i = 0; i < width && !fetch_queue.empty(); i++) {
+    ooo_entry_t &entry = fetch_queue.front();
+    if (entry.decoded > now)
+      return;
+    const decoded_t &ins = entry.ins;
+    int fu = (int)ins.fu;
+    bool writes = ins.rd != REG_NONE && ins.rd != 0 && ins.fu != FU::NONE;
+    bool mem_access = entry.is_load || entry.is_store;
+    if (rob_count == config.rob_entries) {
+      ooo_stats.dispatch_rob++;
+      return;
+    }
+    if (ins.fu != FU::NONE && iq[fu].size() >= config.iq_entries[fu]) {
+      ooo_stats.dispatch_iq[fu]++;
+      return;
+    }
+    if (mem_access && lsq.size() >= config.lsq_entries) {
+      ooo_stats.dispatch_lsq++;
+      return;
+    }
+    if (writes && free_list.empty()) {
+      ooo_stats.dispatch_prf++;
+      return;
+    }
+
+    // Renomeação: as fontes leem o mapa antes do destino ser alocado
+    entry.src[0] = (ins.rs1 != REG_NONE) ? rename_map[ins.rs1] : 0;
+    entry.src[1] = (ins.rs2 != REG_NONE) ? rename_map[ins.rs2] : 0;
+    if (writes) {
+      entry.old_dest = rename_map[ins.rd];
+      entry.dest = free_list.back();
+      free_list.pop_back();
+      rename_map[ins.rd] = entry.dest;
+      ready_at[entry.dest] = OOO_NEVER;
+    }
+    entry.dispatched = now;
+    uint32_t index = robIndex(rob_count);
+    rob[index] = entry;
+    rob_count++;
+    fetch_queue.pop_front();
+
+    // Instruções sem unidade funcional (FENCE, SCALL...) só esperam o commit
+    if (ins.fu == FU::NONE)
+      rob[index].issued = rob[index].completed = now;
+    else
+      iq[fu].push_back(index);
+    if (mem_access)
+      lsq.push_back(index);
+  }
+}
+
+static bool overlaps(const ooo_entry_t &a, const ooo_entry_t &b) {
+  return a.mem_address < b.mem_address + b.mem_size &&
+         b.mem_address < a.mem_address + a.mem_size;
+}
+
+// Miss pendente da linha de address no nível, ou nullptr
+ooo_mshr_t *ooo_core_t::findMSHR(int level, uint32_t address) {
+  uint32_t line = address >> line_bits[level];
+  for (ooo_mshr_t &mshr : mshrs[level])
+    if (mshr.ready > now && mshr.line == line)
+      return &mshr;
+  return nullptr;
+}
+
+// Reserva um MSHR em cada nível de miss_mask até o ciclo ready. Se algum
+// nível não tem MSHR livre nada é reservado e o acesso espera.
+bool ooo_core_t::allocateMSHRs(uint32_t miss_mask, uint32_t address,
+                               uint64_t ready) {
+  ooo_mshr_t *free_mshrs[CACHE_MAX_LEVELS];
+  for (uint32_t mask = miss_mask; mask != 0; mask &= mask - 1) {
+    int level = __builtin_ctz(mask);
+    free_mshrs[level] = nullptr;
+    for (ooo_mshr_t &mshr : mshrs[level])
+      if (mshr.ready <= now) {
+        free_mshrs[level] = &mshr;
+        break;
+      }
+    if (free_mshrs[level] == nullptr) {
+      ooo_stats.mshr_waits[level]++;
+      return false;
+    }
+  }
+  for (uint32_t mask = miss_mask; mask != 0; mask &= mask - 1) {
+    int level = __builtin_ctz(mask);
+    free_mshrs[level]->line = address >> line_bits[level];
+    free_mshrs[level]->ready = ready;
+  }
+  return true;
+}
+
+// Desambiguação pela LSQ: o dado do load vem do store anterior mais novo que
+// escreve nos mesmos bytes (se cobre o load inteiro) ou da cache. Stores
+// anteriores ainda sem endereço são ignorados na especulação, a menos que o
+// load já tenha violado a ordem antes. Retorna em latency os ciclos do acesso
+// à memória.
+bool ooo_core_t::loadMayIssue(uint32_t index, uint32_t *latency) {
+  ooo_entry_t &load = rob[index];
+  const ooo_entry_t *forward = nullptr;
+  bool unresolved = false, partial = false;
+  for (uint32_t older : lsq) {
+    if (older == index)
+      break;
+    const ooo_entry_t &store = rob[older];
+    if (!store.is_store)
+      continue;
+    if (store.issued == OOO_NEVER) {
+      unresolved = true;
+      continue;
+    }
+    if (!overlaps(store, load))
+      continue;
+    // Um store mais novo sobre os mesmos bytes esconde os anteriores
+    bool covers = store.mem_address <= load.mem_address &&
+                  load.mem_address + load.mem_size <=
+                      store.mem_address + store.mem_size;
+    forward = covers ? &store : nullptr;
+    partial = !covers;
+    unresolved = false;
+  }
+  bool marked = wait_table[(load.ins.address >> 2) % OOO_WAIT_TABLE];
+  if (partial || (unresolved && (!config.spec_loads || marked))) {
+    ooo_stats.load_store_waits++;
+    return false;
+  }
+
+  if (forward != nullptr) {
+    // Repassado pelo store, com o tempo de um acerto na L1
+    *latency = 1;
+    load.forward_seq = forward->seq;
+    ooo_stats.loads_forwarded++;
+  } else {
+    // Um miss pendente da mesma linha entrega o dado quando chegar; sem ele,
+    // cada nível que falhou precisa de um MSHR livre
+    ooo_mshr_t *pending = findMSHR(data_level, load.mem_address);
+    *latency = load.mem_cycles;
+    if (pending != nullptr) {
+      if (pending->ready > now + CICLES_AGU)
+        *latency = std::max<uint64_t>(*latency, pending->ready - now -
+                                                    CICLES_AGU);
+      ooo_stats.mshr_merges++;
+    } else if (load.miss_mask != 0 &&
+               !allocateMSHRs(load.miss_mask, load.mem_address,
+                              now + CICLES_AGU + load.mem_cycles)) {
+      return false;
+    }
+    load.forward_seq = 0;
+    p.stalls.mem_port_busy_cycles += *latency;
+  }
+  load.speculative = unresolved;
+  if (unresolved)
+    ooo_stats.loads_speculative++;
+  return true;
+}
+
+// O store acabou de calcular o endereço: o load mais novo mais antigo que já
+// leu os mesmos bytes sem passar por ele (da cache ou de um store anterior)
+// leu o dado errado e será refeito
+void ooo_core_t::storeIssued(uint32_t index) {
+  const ooo_entry_t &store = rob[index];
+  bool younger = false;
+  for (uint32_t other : lsq) {
+    if (other == index) {
+      younger = true;
+      continue;
+    }
+    const ooo_entry_t &load = rob[other];
+    if (!younger || !load.is_load || load.issued == OOO_NEVER ||
+        load.forward_seq > store.seq || !overlaps(store, load))
+      continue;
+    squash_seq = std::min(squash_seq, load.seq);
+    return;
+  }
+}
+
+// Violação de ordem: o load e tudo que veio depois dele saem do ROB, a
+// renomeação é desfeita e as instruções voltam para a fila de busca, como se
+// fossem buscadas de novo a partir do load. O PC do load é marcado para que
+// ele espere os stores anteriores da próxima vez.
+void ooo_core_t::squash() {
+  uint32_t position = 0;
+  while (rob[robIndex(position)].seq != squash_seq)
+    position++;
+  const ooo_entry_t &load = rob[robIndex(position)];
+  wait_table[(load.ins.address >> 2) % OOO_WAIT_TABLE] = true;
+  ooo_stats.order_violations++;
+
+  uint64_t decoded = now + 1 + BASE_FETCH_DURATION + BASE_DECODE_DURATION +
+                     BASE_ALLOC_DURATION;
+  for (uint32_t k = rob_count; k-- > position;) {
+    ooo_entry_t &entry = rob[robIndex(k)];
+    if (entry.dest != 0) {
+      rename_map[entry.ins.rd] = entry.old_dest;
+      free_list.push_back(entry.dest);
+      entry.dest = entry.old_dest = 0;
+    }
+    // A linha já foi pedida pelo primeiro acesso (o MSHR, se ainda
+    // pendente, é aproveitado)
+    if (entry.is_load && entry.issued != OOO_NEVER && entry.forward_seq == 0) {
+      entry.mem_cycles = 1;
+      entry.miss_mask = 0;
+    }
+    entry.forward_seq = 0;
+    entry.speculative = false;
+    entry.decoded = decoded;
+    entry.dispatched = entry.issued = entry.completed = OOO_NEVER;
+    fetch_queue.push_front(entry);
+  }
+  rob_count = position;
+  for (std::vector<uint32_t> &queue : iq)
+    queue.erase(std::remove_if(queue.begin(), queue.end(),
+                               [this, position](uint32_t index) {
+                                 return robPosition(index) >= position;
+                               }),
+                queue.end());
+  while (!lsq.empty() && robPosition(lsq.back()) >= position)
+    lsq.pop_back();
+  squash_seq = OOO_NEVER;
+}
+
+void ooo_core_t::issue() {
+  HOST_PROFILE_SCOPE(EXECUTE);
+  static const uint32_t units[3] = {NUMBER_OF_ALU, NUMBER_OF_AGU,
+                                    NUMBER_OF_BRU};
+  static const uint32_t cycles[3] = {CICLES_ALU, CICLES_AGU, CICLES_BRU};
+  for (int fu = 0; fu < 3; fu++) {
+    std::vector<uint32_t> &queue = iq[fu];
+    uint32_t issued = 0;
+    // As entradas mais antigas têm prioridade
+    for (size_t i = 0; i < queue.size() && issued < units[fu];) {
+      uint32_t index = queue[i];
+      ooo_entry_t &entry = rob[index];
+      if (entry.dispatched + BASE_ISSUE_DURATION > now ||
+          ready_at[entry.src[0]] > now || ready_at[entry.src[1]] > now) {
+        i++;
+        continue;
+      }
+      // O store só calcula o endereço (escreve na cache no commit); o load
+      // passa pela LSQ e pelos MSHRs
+      uint32_t mem_latency = 0;
+      if (entry.is_load) {
+        if (!loadMayIssue(index, &mem_latency)) {
+          i++;
+          continue;
+        }
+        p.stalls.mem_latency_histogram.sample(mem_latency);
+      }
+      uint32_t latency = cycles[fu] + mem_latency;
+      entry.issued = now;
+      entry.completed = now + BASE_EXECUTE_DURATION - 1 + latency;
+      // O resultado é repassado (bypass) aos dependentes assim que sai da
+      // unidade funcional
+      if (entry.dest != 0)
+        ready_at[entry.dest] = now + latency;
+      if (entry.blocks_fetch) {
+        // A busca recomeça no caminho certo depois que o salto resolve
+        entry.blocks_fetch = false;
+        fetch_blocked = false;
+        fetch_cycle = entry.completed;
+      }
+      if (entry.is_store)
+        storeIssued(index);
+      p.stalls.fu_busy_cycles[fu] += cycles[fu];
+      ooo_stats.issued[fu]++;
+      queue.erase(queue.begin() + i);
+      issued++;
+    }
+  }
+  if (squash_seq != OOO_NEVER)
+    squash();
+}
+
+uint32_t ooo_core_t::commit(uint64_t budget) {
+  uint32_t count = 0;
+  while (count < budget && committed_in_cycle < width && rob_count > 0) {
+    ooo_entry_t &entry = rob[rob_head];
+    if (entry.completed == OOO_NEVER ||
+        entry.completed + BASE_COMMIT_DURATION > now)
+      break;
+    // O store escreve na cache no commit; um miss precisa de um MSHR livre
+    // em cada nível que falhou (ou de um miss pendente da mesma linha)
+    if (entry.is_store && entry.miss_mask != 0 &&
+        findMSHR(data_level, entry.mem_address) == nullptr) {
+      if (!allocateMSHRs(entry.miss_mask, entry.mem_address,
+                         now + entry.mem_cycles)) {
+        ooo_stats.store_commit_waits++;
+        break;
+      }
+      p.stalls.mem_port_busy_cycles += entry.mem_cycles;
+    }
+    // Um STEP por instrução efetivada, que é o que o perfil do host conta
+    HOST_PROFILE_SCOPE(STEP);
+    if (entry.dest != 0)
+      free_list.push_back(entry.old_dest);
+    if (entry.is_load || entry.is_store)
+      lsq.pop_front();
+
+    p.stats.instructions++;
+    p.stats.cycles = now + 1 - p.cycles_base;
+    if (p.config.print_instruction_log) {
+      HOST_PROFILE_SCOPE(LOG);
+      std::cout << std::left << std::setw(53) << p.doLogLine(entry.ins);
+      if (p.config.print_instruction_end_time) {
+        std::cout << "| STARTED AT: " << std::setw(5) << entry.fetched;
+        std::cout << "| FINISHED AT: " << std::setw(5) << entry.completed;
+        std::cout << "| COMMITED AT: " << std::setw(5) << now;
+      }
+      std::cout << '\n';
+    }
+    if (p.trace != nullptr) {
+      HOST_PROFILE_SCOPE(LOG);
+      entry.record.started = entry.fetched;
+      entry.record.finished = entry.completed;
+      entry.record.committed = now;
+      p.trace->write(entry.record);
+    }
+    if (p.profiler != nullptr) {
+      HOST_PROFILE_SCOPE(STATS);
+      p.profiler->record(entry.ins, entry.next_pc, now + 1 - last_commit,
+                         entry.icache_misses, entry.dcache_misses,
+                         entry.mispredicted);
+    }
+    last_commit = now + 1;
+
+    rob_head = (rob_head + 1) % config.rob_entries;
+    rob_count--;
+    count++;
+    committed_in_cycle++;
+  }
+  return count;
+}
+
+uint64_t ooo_core_t::run(uint64_t max_instructions, uint64_t cycle_limit) {
+  uint64_t committed = 0;
+  while (true) {
+    if (fetch_done && fetch_queue.empty() && rob_count == 0) {
+      p.running = false;
+      break;
+    }
+    if (p.stats.cycles >= cycle_limit)
+      break;
+    // Os estágios são avaliados do fim para o começo, para que cada
+    // instrução avance no máximo um estágio por ciclo
+    committed += commit(max_instructions - committed);
+    if (committed >= max_instructions)
+      break;
+    issue();
+    dispatch();
+    fetch();
+    ooo_stats.rob_occupancy += rob_count;
+    now++;
+    committed_in_cycle = 0;
+  }
+  return committed;
+}
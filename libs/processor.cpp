@@ -8,40 +8,61 @@
 #include <iostream>
 #include <string>
 
+#include "block_engine.h"
+#include "checkpoint.h"
+#include "host_profile.h"
+#include "lockstep.h"
+#include "profiler.h"
+#include "trace.h"
 #include "utils.h"
 
-// VARIAVEIS DE AMBIENTE QUE CONTROLAM IMPRESSAO
-bool PRINT_INSTRUCTION_LOG = false;
-bool PRINT_INSTRUCTION_END_TIME = false;
-bool PRINT_CACHE_MISSES_LOG = false;
-bool PRINT_GSHARE_LOG = false;
+// Variável de ambiente ligada (valor "true")
+static bool envEnabled(const char *name) {
+  char *env = getenv(name);
+  return env != nullptr && strcmp(env, "true") == 0;
+}
 
-processor_t::processor_t(memory_t *mem, uint32_t entry_point, int n_ins,
-                         int b_gshare) {
+void processor_config_t::readEnvironment() {
   // Ve se deseja imprimir o log de instruções
-  if (char *env = getenv("PRINT_INSTRUCTION_LOG"))
-    if (strcmp(env, "true") == 0)
-      PRINT_INSTRUCTION_LOG = true;
-  if (char *env = getenv("PRINT_INSTRUCTION_END_TIME"))
-    if (strcmp(env, "true") == 0)
-      PRINT_INSTRUCTION_END_TIME = true;
+  print_instruction_log |= envEnabled("PRINT_INSTRUCTION_LOG");
+  print_instruction_end_time |= envEnabled("PRINT_INSTRUCTION_END_TIME");
   // Ve se deseja imprimir o log de misses da cache
-  if (char *env = getenv("PRINT_CACHE_MISSES_LOG"))
-    if (strcmp(env, "true") == 0)
-      PRINT_CACHE_MISSES_LOG = true;
+  print_cache_misses |= envEnabled("PRINT_CACHE_MISSES_LOG");
   // Ve se deseja imprimir o log do gshare
-  if (char *env = getenv("PRINT_GSHARE_LOG"))
-    if (strcmp(env, "true") == 0)
-      PRINT_GSHARE_LOG = true;
+  print_gshare |= envEnabled("PRINT_GSHARE_LOG");
+  // Ve se deseja imprimir os registradores ao final da execução
+  print_final_state |= envEnabled("PRINT_FINAL_STATE");
+}
 
+processor_t::processor_t(memory_t *mem, uint32_t entry_point,
+                         const processor_config_t &pconfig) {
+  config = pconfig;
   memory = mem;
   PC = entry_point;
-  gshare = new gshare_t(b_gshare, 1024);
+  functional = config.functional;
   // Precisa ajustar o baseoff
   registers.writeReg(2, memory->getTotalSize() - 4); // ajusta stack pointer
   cycle = 0;
+  engine = config.engine;
+  trace = nullptr;
+  profiler = nullptr;
+  lockstep = nullptr;
+  running = true;
+  restored_instret = 0;
+  cycles_base = 0;
+  timing = timing_state_t();
 
-  number_i = (n_ins > 0) ? n_ins : 1;
+  number_i = (config.window > 0) ? config.window : 1;
+
+  registry.addCounter("instructions", "instruções executadas",
+                      &stats.instructions);
+
+  // No modo funcional nenhuma estrutura do modelo de temporização é criada
+  memory_avail = 0;
+  if (functional)
+    return;
+  gshare.reset(new gshare_t(config.gshare_bits, config.btb_entries));
+  registerStats();
 
   ALU.clear();
   ALU.resize(NUMBER_OF_ALU, 0);
@@ -49,218 +70,640 @@ processor_t::processor_t(memory_t *mem, uint32_t entry_point, int n_ins,
   AGU.resize(NUMBER_OF_AGU, 0);
   BRU.clear();
   BRU.resize(NUMBER_OF_BRU, 0);
-  memory_avail = 0;
+
+  if (config.core == CORE::OOO) {
+    ooo.reset(new ooo_core_t(*this, config.ooo, number_i));
+    ooo->registerStats(registry);
+  }
 }
 
-void processor_t::executeProgram() {
-  running = true;
-  uint32_t tcycles = 0, tinst = 0;
-  uint32_t previous_finish = 0;
-  uint32_t branch_penalty = 0;
-  uint32_t linst = 0;
-  uint32_t commit_count = 0;
-  uint32_t instruction_start = 0;
-  uint32_t instruction_block = 1;
-  uint32_t excendent_cycles = 0;
-  uint32_t block_busy = 0;
-  while (running) {
-    // Definindo o tempo de start
-    // linst conta a quantidade de instruções até preencher a janela.
-    linst++; // conta mais uma instrução pra janela
-    if (linst > number_i) {
-      // se ultrapassar o tamanho da janela, vamos começar no ciclo seguinte
-      instruction_start++;
-      instruction_block++; // Nova janela de instruções
-      linst = 1; // ja conta a instrução atual
-    }
-    
-    // Se for um bloco que foi atrasado pelo miss na cache de instruções
-    if (instruction_block == block_busy) {
-      instruction_start += excendent_cycles;
-    }
 
-    // Contador do tempo da instrução
-    uint32_t started_at = instruction_start;
-    uint32_t time_instruction = instruction_start;
+void processor_t::registerStats() {
+  registry.addCounter("cycles", "ciclos simulados", &stats.cycles);
+  registry.addValue("cpi", "ciclos por instrução", [this]() {
+    return stats.instructions ? stats.cycles / (stats.instructions * 1.0) : 0;
+  });
+  registry.addValue("gshare.hits", "acertos do gshare",
+                    [this]() { return gshare->getHits(); });
+  registry.addValue("gshare.errors", "erros do gshare",
+                    [this]() { return gshare->getErrors(); });
 
-    // ====================================================================== //
-    // ESTAGIO DE FETCH (min 4 ciclos)
-    // ====================================================================== //
-    uint32_t raw_instruction, pc_instruction, fetch_cycles;
-    bool prediction;
-    fetch_cycles = Fetch(&raw_instruction, &pc_instruction, &prediction);
-    // Tivemos um miss na cache de instruções, vamos atrasar o início das
-    // instruções no excendente no próximo bloco de instruções
-    if (fetch_cycles > BASE_FETCH_DURATION) {
-      block_busy = instruction_block + 2; 
-      excendent_cycles = (fetch_cycles - BASE_FETCH_DURATION);
-      time_instruction += fetch_cycles;
-    } else { 
-      time_instruction += fetch_cycles + excendent_cycles;
+  registry.addCounter("stall.icache.misses",
+                      "buscas com miss na cache de instruções",
+                      &stalls.icache_misses);
+  registry.addCounter("stall.icache.miss_cycles",
+                      "ciclos de miss somados à própria busca",
+                      &stalls.icache_miss_cycles);
+  registry.addCounter("stall.icache.excess_cycles",
+                      "ciclos excedentes do último miss somados às buscas "
+                      "seguintes",
+                      &stalls.icache_excess_cycles);
+  registry.addCounter("stall.icache.block_cycles",
+                      "atraso no início do bloco de instruções após um miss",
+                      &stalls.icache_block_cycles);
+  registry.addCounter("stall.raw.stalls",
+                      "instruções esperando rs1/rs2 depois do issue",
+                      &stalls.raw_stalls);
+  registry.addCounter("stall.raw.cycles", "ciclos de espera por rs1/rs2",
+                      &stalls.raw_cycles);
+  registry.addHistogram("stall.raw.histogram",
+                        "ciclos de espera por rs1/rs2 por instrução",
+                        &stalls.raw_histogram);
+  const char *units[] = {"alu", "agu", "bru"};
+  for (int unit = 0; unit < 3; unit++) {
+    std::string name = std::string("stall.fu.") + units[unit];
+    registry.addCounter(name + ".stalls",
+                        "instruções esperando a unidade funcional",
+                        &stalls.fu_stalls[unit]);
+    registry.addCounter(name + ".cycles",
+                        "ciclos de espera pela unidade funcional",
+                        &stalls.fu_cycles[unit]);
+    registry.addCounter(std::string("fu.") + units[unit] + ".busy_cycles",
+                        "ciclos em que as unidades estiveram reservadas",
+                        &stalls.fu_busy_cycles[unit]);
+  }
+  registry.addCounter("mem_port.busy_cycles",
+                      "ciclos em que a porta de memória esteve reservada",
+                      &stalls.mem_port_busy_cycles);
+  registry.addCounter("stall.mem_port.stalls",
+                      "acessos esperando a porta de memória",
+                      &stalls.mem_port_stalls);
+  registry.addCounter("stall.mem_port.cycles",
+                      "ciclos de espera pela porta de memória",
+                      &stalls.mem_port_cycles);
+  registry.addHistogram("mem.latency_histogram",
+                        "ciclos extras de cada acesso à memória",
+                        &stalls.mem_latency_histogram);
+  registry.addCounter("stall.branch.mispredictions",
+                      "predições erradas (desvios e saltos, inclusive pela BTB)",
+                      &stalls.mispredictions);
+  registry.addCounter("stall.branch.flush_cycles",
+                      "ciclos perdidos no reinício da busca após uma "
+                      "predição errada",
+                      &stalls.flush_cycles);
+  registry.addHistogram("stall.branch.flush_histogram",
+                        "ciclos perdidos por predição errada",
+                        &stalls.flush_histogram);
+  registry.addCounter("stall.commit_width.cycles",
+                      "ciclos somados por exceder number_i commits no ciclo",
+                      &stalls.commit_width_cycles);
+  memory->registerStats(registry);
+}
+
+void processor_t::setTrace(trace_writer_t *writer) { trace = writer; }
+
+void processor_t::setProfiler(profiler_t *pprofiler) { profiler = pprofiler; }
+
+void processor_t::setLockstep(lockstep_t *plockstep) {
+  lockstep = plockstep;
+  lockstep->start(PC, registers, getInstret());
+}
+
+void processor_t::traceRecord(const decoded_t &ins, uint32_t mem_address,
+                              uint32_t started, uint32_t finished,
+                              uint32_t commited, trace_record_t *record) {
+  record->pc = ins.address;
+  record->raw = ins.raw;
+  record->flags = 0;
+  record->rd_value = 0;
+  // Instruções de sistema também possuem o campo rd, mas não o escrevem
+  if (ins.rd != REG_NONE && ins.fu != FU::NONE) {
+    record->flags |= TRACE_R_RD_WRITTEN;
+    record->rd_value = registers.readReg(ins.rd);
+  }
+  record->mem_address = 0;
+  if (ins.fu == FU::AGU) {
+    record->flags |= TRACE_R_MEM_ACCESS;
+    record->mem_address = mem_address;
+  }
+  record->started = started;
+  record->finished = finished;
+  record->committed = commited;
+}
+
+void processor_t::traceInstruction(const decoded_t &ins, uint32_t mem_address,
+                                   uint32_t started, uint32_t finished,
+                                   uint32_t commited) {
+  HOST_PROFILE_SCOPE(LOG);
+  trace_record_t record;
+  traceRecord(ins, mem_address, started, finished, commited, &record);
+  trace->write(record);
+}
+
+void processor_t::checkLockstep(const decoded_t &ins, uint32_t mem_address) {
+  bool same;
+  if (lockstep->usesLog()) {
+    trace_record_t record;
+    traceRecord(ins, mem_address, 0, 0, 0, &record);
+    same = lockstep->checkRecord(record, running);
+  } else {
+    same = lockstep->check(ins.address, ins.raw, PC, registers, running,
+                           *memory);
+  }
+  if (!same)
+    running = false;
+}
+
+void processor_t::executeBlocks() {
+  // O motor de blocos executa apenas a semântica das instruções, sem o modelo
+  // de temporização
+  block_engine_t block_engine(*this);
+  stats.instructions = block_engine.run();
+}
+
+void processor_t::stepFunctional() {
+  HOST_PROFILE_SCOPE(STEP);
+  // Busca sem predição de saltos: o PC só muda quando o salto é executado
+  uint32_t pc_instruction = PC;
+  decoded_t *dec = decoder.lookup(pc_instruction);
+  if (dec == nullptr) {
+    uint32_t raw_instruction;
+    memory->readMem32(pc_instruction, &raw_instruction, ACCESS_TYPE::LOAD);
+    dec = decoder.insert(pc_instruction, raw_instruction);
+    memory->watchCodePage(pc_instruction);
+  }
+  decoded_t instruction = *dec;
+  PC = pc_instruction + 4;
+
+  // O endereço é calculado antes da execução, que pode sobrescrever rs1
+  uint32_t mem_address = 0;
+  if ((trace != nullptr || lockstep != nullptr) && instruction.fu == FU::AGU)
+    mem_address = registers.readReg(instruction.rs1) + instruction.imm;
+  Execute(instruction);
+  if (trace != nullptr)
+    traceInstruction(instruction, mem_address, 0, 0, 0);
+  if (profiler != nullptr) {
+    HOST_PROFILE_SCOPE(STATS);
+    profiler->record(instruction, PC, 0, 0, 0, false);
+  }
+  if (instruction.fu == FU::AGU)
+    syncDecodeCache();
+  stats.instructions++;
+  if (lockstep != nullptr)
+    checkLockstep(instruction, mem_address);
+}
+
+void processor_t::printReport() {
+  if (functional) {
+    std::cout << "\nINFORMAÇÕES SOBRE #INSTRUÇÕES (execução funcional):\n";
+    std::cout << "  Total number of instructions: " << stats.instructions
+              << std::endl;
+    if (config.print_final_state)
+      printFinalState();
+    return;
+  }
+  std::cout << "\nINFORMAÇÕES SOBRE CICLOS E #INSTRUÇÕES:\n";
+  std::cout << "  Total number of cycles: " << stats.cycles << std::endl;
+  std::cout << "  Total number of instructions: " << stats.instructions
+            << std::endl;
+  std::cout << "  Cycles per istruction: "
+            << stats.cycles / (stats.instructions * 1.0)
+            << std::endl;
+  if (config.print_gshare) {
+    std::cout << "\nINFORMAÇÕES SOBRE GSHARE:\n";
+    std::cout << "  Acertos: " << stats.gshare_hits << std::endl;
+    std::cout << "  Erros: " << stats.gshare_errors << std::endl;
+  }
+  if (config.print_cache_misses) {
+    std::cout << "\nINFORMAÇÕES SOBRE MISSES NAS CACHES:\n";
+    memory->printCacheMisses();
+  }
+  if (config.print_final_state)
+    printFinalState();
+}
+
+void processor_t::printFinalState() {
+  std::cout << "\nESTADO FINAL:\n";
+  std::cout << "  PC: 0x" << std::uppercase << std::hex << std::setw(8)
+            << std::setfill('0') << PC << std::endl;
+  for (int i = 0; i < 32; i++)
+    std::cout << "  x" << std::dec << std::setw(2) << std::setfill('0') << i
+              << " (" << register_name[i] << "): 0x" << std::hex
+              << std::setw(8) << std::setfill('0') << registers.readReg(i)
+              << std::endl;
+  std::cout << std::dec << std::setfill(' ');
+}
+
+void processor_t::saveState(checkpoint_writer_t &writer, bool warm) const {
+  writer.putU32(PC);
+  for (int i = 0; i < 32; i++)
+    writer.putU32(registers.readReg(i));
+  if (!warm)
+    return;
+  checkpoint_writer_t predictor;
+  if (gshare)
+    gshare->saveState(predictor);
+  writer.putBlock(predictor);
+
+  checkpoint_writer_t pipeline;
+  pipeline.putVarint(number_i);
+  const uint32_t fields[] = {timing.previous_finish,   timing.linst,
+                             timing.commit_count,      timing.instruction_start,
+                             timing.instruction_block, timing.excendent_cycles,
+                             timing.block_busy,        memory_avail};
+  for (uint32_t field : fields)
+    pipeline.putVarint(field);
+  for (const std::vector<uint32_t> *units : {&ALU, &AGU, &BRU})
+    for (uint32_t available : *units)
+      pipeline.putVarint(available);
+  for (int i = 0; i < 32; i++)
+    pipeline.putVarint(registers.checkUW(i));
+  pipeline.putU8(branched);
+  pipeline.putU8(is_branch);
+  pipeline.putU8(wrote);
+  writer.putBlock(pipeline);
+}
+
+bool processor_t::readState(checkpoint_reader_t &reader, bool warm,
+                            processor_state_t &state) {
+  state.pc = reader.getU32();
+  for (int i = 0; i < 32; i++)
+    state.registers[i] = reader.getU32();
+  state.warm = warm;
+  if (warm) {
+    state.predictor = reader.getBlock();
+    state.pipeline = reader.getBlock();
+  }
+  return reader.good();
+}
+
+bool processor_t::loadState(const processor_state_t &state, uint64_t instret) {
+  PC = state.pc;
+  for (int i = 0; i < 32; i++)
+    registers.writeReg(i, state.registers[i]);
+  restored_instret = instret;
+  if (!state.warm)
+    return true;
+  if (functional)
+    return false;
+  checkpoint_reader_t predictor = state.predictor;
+  bool applied = gshare->loadState(predictor);
+
+  // A temporização só continua de onde parou com a mesma janela. Os campos
+  // são lidos em cópias, aplicadas só se o bloco inteiro for válido.
+  checkpoint_reader_t pipeline = state.pipeline;
+  if (pipeline.getVarint() != (uint64_t)number_i || !pipeline.good())
+    return false;
+  timing_state_t staged_timing;
+  uint32_t staged_memory_avail;
+  uint32_t *fields[] = {&staged_timing.previous_finish,
+                        &staged_timing.linst,
+                        &staged_timing.commit_count,
+                        &staged_timing.instruction_start,
+                        &staged_timing.instruction_block,
+                        &staged_timing.excendent_cycles,
+                        &staged_timing.block_busy,
+                        &staged_memory_avail};
+  for (uint32_t *field : fields)
+    *field = pipeline.getVarint();
+  std::vector<uint32_t> units[3] = {ALU, AGU, BRU};
+  for (std::vector<uint32_t> &unit : units)
+    for (uint32_t &available : unit)
+      available = pipeline.getVarint();
+  uint32_t available[32];
+  for (int i = 0; i < 32; i++)
+    available[i] = pipeline.getVarint();
+  bool staged_branched = pipeline.getU8();
+  bool staged_is_branch = pipeline.getU8();
+  bool staged_wrote = pipeline.getU8();
+  if (!pipeline.good())
+    return false;
+  timing = staged_timing;
+  memory_avail = staged_memory_avail;
+  ALU = units[0];
+  AGU = units[1];
+  BRU = units[2];
+  for (int i = 0; i < 32; i++)
+    registers.setUW(i, available[i]);
+  branched = staged_branched;
+  is_branch = staged_is_branch;
+  wrote = staged_wrote;
+  // O núcleo fora de ordem começa vazio no ciclo 0 (do estado aquecido ele
+  // aproveita o gshare e as caches)
+  cycles_base = ooo ? 0 : timing.previous_finish;
+  return applied;
+}
+
+void processor_t::executeProgram() {
+  if (engine == ENGINE::THREADED) {
+    executeBlocks();
+    return;
+  }
+  run(UINT64_MAX);
+}
+
+uint64_t processor_t::run(uint64_t max_instructions) {
+  uint64_t executed = 0;
+  if (functional) {
+    while (running && executed < max_instructions) {
+      stepFunctional();
+      executed++;
     }
-    // ====================================================================== //
-    // ESTAGIO DE DECODE
-    // ====================================================================== //
-    time_instruction += BASE_DECODE_DURATION;
-    instruction_t instruction(raw_instruction, pc_instruction);
-
-    // ====================================================================== //
-    // ESTAGIO DE ALLOCATION
-    // ====================================================================== //
-    time_instruction += BASE_ALLOC_DURATION;
-
-    // ====================================================================== //
-    // ESTAGIO DE ISSUE (3 ciclos)
-    // ====================================================================== //
-    uint32_t rs1 = instruction.getRs1();
-    uint32_t rs2 = instruction.getRs2();
-    uint32_t rd = instruction.getRd();
-    FU fu = instruction.getFU();
-    // Dependência de dados
-    uint32_t rs1_avail = (rs1 != -1) ? registers.checkUW(rs1) : 0;
-    uint32_t rs2_avail = (rs2 != -1) ? registers.checkUW(rs2) : 0;
-
-    // Indendependente das dependencias, temos pelo menos 3 ciclos
-    time_instruction += BASE_ISSUE_DURATION;
-
-    // Se tiver alguma dependência de dados, vamos postegar o inicio.
-    if (rs1_avail > time_instruction || rs2_avail > time_instruction)
-      time_instruction = std::max(rs1_avail, rs2_avail);
-
-    uint32_t res_avail;
-    bool mem_acess = false;
-    switch (fu) {
-    case FU::ALU:
-      res_avail = getNextALU(time_instruction);
-      break;
-    case FU::AGU:
-      mem_acess = true;
-      res_avail = getNextAGU(time_instruction);
-      break;
-    case FU::BRU:
-      res_avail = getNextBRU(time_instruction);
-      break;
-    case FU::NONE:
-      break;
+    return executed;
+  }
+  if (ooo) {
+    executed = ooo->run(max_instructions, UINT64_MAX);
+  } else {
+    while (running && executed < max_instructions) {
+      stepTimed();
+      executed++;
     }
+  }
+  stats.gshare_hits = gshare->getHits();
+  stats.gshare_errors = gshare->getErrors();
+  return executed;
+}
 
-    // se res_avail <= time instruction significa que temos uma unidade
-    // funcional disponível assim que a parte de issue acabar, se res_avail >
-    // time_instruction significa que só teremos recursos disponíveis a partir
-    // de res_avail, então a instrução fica em stall até lá.
-    if (res_avail > time_instruction)
-      time_instruction = res_avail;
-
-    // ====================================================================== //
-    // ESTAGIO DE EXECUÇÃO (min 2 ciclos)
-    // ====================================================================== //
-    time_instruction += BASE_EXECUTE_DURATION;
-    // Executa a instrução e cria a linha de log
-    char disassembly[50];
-    uint32_t extra_cicles = Execute(instruction, disassembly);
-    std::string instruction_log = doLogLine(instruction, disassembly);
-    bool w_pred = false;
-    // Feedback gshare
-    if (is_branch) {
-      // Erro na branch prediction
-      if (branched != prediction) {
-        w_pred = true;
-      }
+uint64_t processor_t::warm(uint64_t max_instructions) {
+  uint64_t executed = 0;
+  while (running && executed < max_instructions) {
+    uint32_t raw_instruction, pc_instruction;
+    bool prediction;
+    uint32_t fetch_cycles =
+        Fetch(&raw_instruction, &pc_instruction, &prediction);
+    // O modelo analítico soma às buscas seguintes o excedente do último miss
+    // na cache de instruções
+    if (fetch_cycles > BASE_FETCH_DURATION)
+      timing.excendent_cycles = fetch_cycles - BASE_FETCH_DURATION;
+    decoded_t instruction = Decode(raw_instruction, pc_instruction);
+    Execute(instruction);
+    if (is_branch)
       gshare->feedback(branched, pc_instruction, PC);
-    }
+    if (instruction.fu == FU::AGU)
+      syncDecodeCache();
+    stats.instructions++;
+    executed++;
+  }
+  stats.gshare_hits = gshare->getHits();
+  stats.gshare_errors = gshare->getErrors();
+  return executed;
+}
 
-    if (mem_acess) {
-      // remove o write back temporariamente
-      time_instruction -= 1;
-      // Teremos extra_cicles se for acesso a MEM
-      uint32_t mem_avail = getNextMEM(time_instruction, extra_cicles);
-      // se mem_avail > time_instruction, significa que o recurso de memoria
-      // está ocupado, temos que esperar, assim o tempo de
-      if (mem_avail > time_instruction)
-        time_instruction = mem_avail;
-
-      // Adiciona os ciclos extras de acesso a memória
-      time_instruction += extra_cicles;
-
-      // Readiciona o writeback
-      time_instruction += 1;
+uint64_t processor_t::runCycles(uint64_t max_cycles) {
+  // Sem temporização cada instrução conta como um ciclo
+  if (functional)
+    return run(max_cycles);
+  uint64_t executed = 0;
+  uint64_t target = stats.cycles + max_cycles;
+  if (ooo) {
+    executed = ooo->run(UINT64_MAX, target);
+  } else {
+    while (running && stats.cycles < target) {
+      stepTimed();
+      executed++;
     }
+  }
+  stats.gshare_hits = gshare->getHits();
+  stats.gshare_errors = gshare->getErrors();
+  return executed;
+}
 
-    // Write back
-    if (wrote)
-      // -1 assumindo que se le no mesmo ciclo que se escreve
-      registers.setUW(rd, time_instruction - 1);
-
-    // ====================================================================== //
-    // ESTAGIO DE COMMIT (1 ciclo)
-    // ====================================================================== //
-    time_instruction += BASE_COMMIT_DURATION;
-    uint32_t commited_at;
-    // Checa commit da instrução
-    if (time_instruction > previous_finish) {
-      commited_at = time_instruction;
-      previous_finish = time_instruction;
-      commit_count = 1;
-    } else {
-      commit_count++;
-      if (commit_count > number_i) {
-        commit_count = 1;
-        previous_finish += BASE_COMMIT_DURATION;
-      }
-      commited_at = previous_finish;
+void processor_t::stepTimed() {
+  HOST_PROFILE_SCOPE(STEP);
+  // O estado do modelo de temporização é mantido entre as instruções
+  uint32_t &previous_finish = timing.previous_finish;
+  uint32_t &linst = timing.linst;
+  uint32_t &commit_count = timing.commit_count;
+  uint32_t &instruction_start = timing.instruction_start;
+  uint32_t &instruction_block = timing.instruction_block;
+  uint32_t &excendent_cycles = timing.excendent_cycles;
+  uint32_t &block_busy = timing.block_busy;
+
+  // Definindo o tempo de start
+  // linst conta a quantidade de instruções até preencher a janela.
+  linst++; // conta mais uma instrução pra janela
+  if (linst > number_i) {
+    // se ultrapassar o tamanho da janela, vamos começar no ciclo seguinte
+    instruction_start++;
+    instruction_block++; // Nova janela de instruções
+    linst = 1; // ja conta a instrução atual
+  }
+  
+  // Se for um bloco que foi atrasado pelo miss na cache de instruções
+  if (instruction_block == block_busy) {
+    instruction_start += excendent_cycles;
+    stalls.icache_block_cycles += excendent_cycles;
+  }
+
+  // Contador do tempo da instrução
+  uint32_t started_at = instruction_start;
+  uint32_t time_instruction = instruction_start;
+
+  // ====================================================================== //
+  // ESTAGIO DE FETCH (min 4 ciclos)
+  // ====================================================================== //
+  uint32_t raw_instruction, pc_instruction, fetch_cycles;
+  bool prediction;
+  // Perfil: misses nas L1 e commit anterior, para atribuir à instrução
+  uint32_t profile_commit = previous_finish;
+  int profile_imisses = 0, profile_dmisses = 0;
+  if (profiler != nullptr)
+    profile_imisses = memory->getCacheMisses(memory->getInstructionLevel());
+  fetch_cycles = Fetch(&raw_instruction, &pc_instruction, &prediction);
+  if (profiler != nullptr) {
+    profile_imisses =
+        memory->getCacheMisses(memory->getInstructionLevel()) - profile_imisses;
+    profile_dmisses = memory->getCacheMisses(memory->getDataLevel());
+  }
+  // Tivemos um miss na cache de instruções, vamos atrasar o início das
+  // instruções no excendente no próximo bloco de instruções
+  if (fetch_cycles > BASE_FETCH_DURATION) {
+    block_busy = instruction_block + 2; 
+    excendent_cycles = (fetch_cycles - BASE_FETCH_DURATION);
+    time_instruction += fetch_cycles;
+    stalls.icache_misses++;
+    stalls.icache_miss_cycles += excendent_cycles;
+  } else { 
+    time_instruction += fetch_cycles + excendent_cycles;
+    stalls.icache_excess_cycles += excendent_cycles;
+  }
+  // ====================================================================== //
+  // ESTAGIO DE DECODE
+  // ====================================================================== //
+  time_instruction += BASE_DECODE_DURATION;
+  decoded_t instruction = Decode(raw_instruction, pc_instruction);
+
+  // ====================================================================== //
+  // ESTAGIO DE ALLOCATION
+  // ====================================================================== //
+  time_instruction += BASE_ALLOC_DURATION;
+
+  // ====================================================================== //
+  // ESTAGIO DE ISSUE (3 ciclos)
+  // ====================================================================== //
+  uint32_t rs1 = instruction.rs1;
+  uint32_t rs2 = instruction.rs2;
+  uint32_t rd = instruction.rd;
+  FU fu = instruction.fu;
+  // Dependência de dados
+  uint32_t rs1_avail = (rs1 != REG_NONE) ? registers.checkUW(rs1) : 0;
+  uint32_t rs2_avail = (rs2 != REG_NONE) ? registers.checkUW(rs2) : 0;
+
+  // Indendependente das dependencias, temos pelo menos 3 ciclos
+  time_instruction += BASE_ISSUE_DURATION;
+
+  // Se tiver alguma dependência de dados, vamos postegar o inicio.
+  if (rs1_avail > time_instruction || rs2_avail > time_instruction) {
+    uint32_t raw_cycles = std::max(rs1_avail, rs2_avail) - time_instruction;
+    stalls.raw_stalls++;
+    stalls.raw_cycles += raw_cycles;
+    stalls.raw_histogram.sample(raw_cycles);
+    time_instruction = std::max(rs1_avail, rs2_avail);
+  }
+
+  uint32_t res_avail = 0;
+  bool mem_acess = false;
+  switch (fu) {
+  case FU::ALU:
+    res_avail = getNextALU(time_instruction);
+    stalls.fu_busy_cycles[(int)FU::ALU] += CICLES_ALU;
+    break;
+  case FU::AGU:
+    mem_acess = true;
+    res_avail = getNextAGU(time_instruction);
+    stalls.fu_busy_cycles[(int)FU::AGU] += CICLES_AGU;
+    break;
+  case FU::BRU:
+    res_avail = getNextBRU(time_instruction);
+    stalls.fu_busy_cycles[(int)FU::BRU] += CICLES_BRU;
+    break;
+  case FU::NONE:
+    break;
+  }
+
+  // se res_avail <= time instruction significa que temos uma unidade
+  // funcional disponível assim que a parte de issue acabar, se res_avail >
+  // time_instruction significa que só teremos recursos disponíveis a partir
+  // de res_avail, então a instrução fica em stall até lá.
+  if (res_avail > time_instruction) {
+    stalls.fu_stalls[(int)fu]++;
+    stalls.fu_cycles[(int)fu] += res_avail - time_instruction;
+    time_instruction = res_avail;
+  }
+
+  // ====================================================================== //
+  // ESTAGIO DE EXECUÇÃO (min 2 ciclos)
+  // ====================================================================== //
+  time_instruction += BASE_EXECUTE_DURATION;
+  // O endereço é calculado antes da execução, que pode sobrescrever rs1
+  uint32_t mem_address = 0;
+  if ((trace != nullptr || lockstep != nullptr) && mem_acess)
+    mem_address = registers.readReg(rs1) + instruction.imm;
+  // Executa a instrução (a linha de log só é montada se for impressa)
+  uint32_t extra_cicles = Execute(instruction);
+  bool w_pred = false;
+  // Feedback gshare
+  if (is_branch) {
+    // Erro na branch prediction
+    if (branched != prediction) {
+      w_pred = true;
     }
+    gshare->feedback(branched, pc_instruction, PC);
+  }
+
+  if (mem_acess) {
+    // Stores em páginas de código invalidam as instruções já decodificadas
+    syncDecodeCache();
 
-    // Predição errada significa que a próxima instrução válida vai começar
-    // agora - A gente reseta tudo quando da um commit ou quando a instrução
-    // termina?
-    if (w_pred) {
-      instruction_start = time_instruction;
-      // Vamos descartar tudo que estiver até agora no pipelina e começar um 
-      // fetch novo no próximo ciclo
-      linst = 0;
+    // remove o write back temporariamente
+    time_instruction -= 1;
+    // Teremos extra_cicles se for acesso a MEM
+    uint32_t mem_avail = getNextMEM(time_instruction, extra_cicles);
+    stalls.mem_port_busy_cycles += extra_cicles;
+    // se mem_avail > time_instruction, significa que o recurso de memoria
+    // está ocupado, temos que esperar, assim o tempo de
+    if (mem_avail > time_instruction) {
+      stalls.mem_port_stalls++;
+      stalls.mem_port_cycles += mem_avail - time_instruction;
+      time_instruction = mem_avail;
     }
 
-    // Contador de instruções
-    tinst++;
-
-    // Imprime log da instrução
-    if (PRINT_INSTRUCTION_LOG) {
-      std::cout << std::left << std::setw(53) << instruction_log;
-      if (PRINT_INSTRUCTION_END_TIME)
-        std::cout << "| STARTED AT: " << std::setw(5) << started_at;
-        std::cout << "| FINISHED AT: " << std::setw(5) << time_instruction;
-        std::cout << "| COMMITED AT: " << std::setw(5) << commited_at;
-      std::cout << std::endl;
+    // Adiciona os ciclos extras de acesso a memória
+    time_instruction += extra_cicles;
+    stalls.mem_latency_histogram.sample(extra_cicles);
+
+    // Readiciona o writeback
+    time_instruction += 1;
+  }
+
+  // Write back
+  if (wrote)
+    // -1 assumindo que se le no mesmo ciclo que se escreve
+    registers.setUW(rd, time_instruction - 1);
+
+  // ====================================================================== //
+  // ESTAGIO DE COMMIT (1 ciclo)
+  // ====================================================================== //
+  time_instruction += BASE_COMMIT_DURATION;
+  uint32_t commited_at;
+  // Checa commit da instrução
+  if (time_instruction > previous_finish) {
+    commited_at = time_instruction;
+    previous_finish = time_instruction;
+    commit_count = 1;
+  } else {
+    commit_count++;
+    if (commit_count > number_i) {
+      commit_count = 1;
+      previous_finish += BASE_COMMIT_DURATION;
+      stalls.commit_width_cycles += BASE_COMMIT_DURATION;
     }
-    // ====================================================================== //
+    commited_at = previous_finish;
   }
-  std::cout << "\nINFORMAÇÕES SOBRE CICLOS E #INSTRUÇÕES:\n";
-  std::cout << "  Total number of cycles: " << previous_finish << std::endl;
-  std::cout << "  Total number of instructions: " << tinst << std::endl;
-  std::cout << "  Cycles per istruction: " << previous_finish / (tinst * 1.0)
-            << std::endl;
-  if (PRINT_GSHARE_LOG) {
-    std::cout << "\nINFORMAÇÕES SOBRE GSHARE:\n";
-    std::cout << "  Acertos: " << gshare->getHits() << std::endl;
-    std::cout << "  Erros: " << gshare->getErrors() << std::endl;
+
+  // Predição errada significa que a próxima instrução válida vai começar
+  // agora - A gente reseta tudo quando da um commit ou quando a instrução
+  // termina?
+  if (w_pred) {
+    // Sem o erro, a próxima instrução começaria em instruction_start ou no
+    // ciclo seguinte, se a janela estiver cheia
+    uint32_t flush_cycles = time_instruction - instruction_start;
+    stalls.mispredictions++;
+    stalls.flush_cycles += flush_cycles;
+    stalls.flush_histogram.sample(flush_cycles);
+    instruction_start = time_instruction;
+    // Vamos descartar tudo que estiver até agora no pipelina e começar um 
+    // fetch novo no próximo ciclo
+    linst = 0;
   }
-  if (PRINT_CACHE_MISSES_LOG) {
-    std::cout << "\nINFORMAÇÕES SOBRE MISSES NAS CACHES:\n";
-    memory->printCacheMisses();
+
+  // Contador de instruções
+  stats.instructions++;
+  stats.cycles = previous_finish - cycles_base;
+
+  // Imprime log da instrução
+  if (config.print_instruction_log) {
+    HOST_PROFILE_SCOPE(LOG);
+    std::cout << std::left << std::setw(53) << doLogLine(instruction);
+    if (config.print_instruction_end_time)
+      std::cout << "| STARTED AT: " << std::setw(5) << started_at;
+      std::cout << "| FINISHED AT: " << std::setw(5) << time_instruction;
+      std::cout << "| COMMITED AT: " << std::setw(5) << commited_at;
+    std::cout << '\n';
+  }
+  if (trace != nullptr)
+    traceInstruction(instruction, mem_address, started_at, time_instruction,
+                     commited_at);
+  if (profiler != nullptr) {
+    HOST_PROFILE_SCOPE(STATS);
+    profile_dmisses =
+        memory->getCacheMisses(memory->getDataLevel()) - profile_dmisses;
+    profiler->record(instruction, PC, previous_finish - profile_commit,
+                     profile_imisses, profile_dmisses, w_pred);
   }
+  if (lockstep != nullptr)
+    checkLockstep(instruction, mem_address);
+  // ====================================================================== //
 }
 
 uint32_t processor_t::Fetch(uint32_t *raw_instruction, uint32_t *pc_address,
                             bool *pred) {
+  HOST_PROFILE_SCOPE(FETCH);
   // Fetch do PC atual
-  uint8_t mem_value;
   uint32_t lcycles = BASE_FETCH_DURATION;
   uint32_t value = 0;
   // printf("PC: 0x%x\n", PC);
-  for (int i = 0; i < 4; i++) {
-    lcycles += memory->readMem(PC + i, &mem_value, ACCESS_TYPE::INSTRUCTION);
-    value += mem_value << (8 * i);
-  }
+  lcycles += memory->readMem32(PC, &value, ACCESS_TYPE::INSTRUCTION);
   *pc_address = PC;
   *raw_instruction = value;
   *pred = false; // vamos assumir que não é um salto
@@ -298,7 +741,25 @@ uint32_t processor_t::Fetch(uint32_t *raw_instruction, uint32_t *pc_address,
   return lcycles;
 }
 
-uint32_t processor_t::Execute(instruction_t ins, char *disassembly) {
+decoded_t processor_t::Decode(uint32_t raw_instruction, uint32_t pc_address) {
+  HOST_PROFILE_SCOPE(DECODE);
+  // Só decodifica instruções que ainda não estão no cache
+  decoded_t *dec = decoder.lookup(pc_address);
+  if (dec == nullptr) {
+    dec = decoder.insert(pc_address, raw_instruction);
+    memory->watchCodePage(pc_address);
+  }
+  return *dec;
+}
+
+void processor_t::syncDecodeCache() {
+  uint32_t page_address;
+  while (memory->popCodeWrite(&page_address))
+    decoder.invalidatePage(page_address);
+}
+
+uint32_t processor_t::Execute(const decoded_t &ins) {
+  HOST_PROFILE_SCOPE(EXECUTE);
   // Todas as unidades funcionais precisam de pelo menos 1 ciclo pra execução,
   // acessos a memória podem demorar mais.
   uint32_t lcycle = 0;
@@ -307,587 +768,414 @@ uint32_t processor_t::Execute(instruction_t ins, char *disassembly) {
   branched = false;
   is_branch = false;
   wrote = false;
-  switch (ins.getOperation()) {
+  switch (ins.op) {
   case MNE::LUI: { // Coloca o imediato no rd (preenche os 12 lower bits com 0)
-    int32_t imm_se = sign_extend(ins.getImm(), ins.getImmSize());
-    registers.writeReg(ins.getRd(), imm_se);
+    int32_t imm_se = ins.imm;
+    registers.writeReg(ins.rd, imm_se);
     wrote = true;
-    sprintf(disassembly, "%-8s %s, %d", "LUI",
-            register_name[ins.getRd()].c_str(), imm_se);
     break;
   }
   case MNE::AUIPC: { // Adiciona o imediato ao address da instrução e coloca no
                      // rd (preenche os 12 lower bits com 0)
-    int32_t imm_se = sign_extend(ins.getImm(), ins.getImmSize());
-    registers.writeReg(ins.getRd(), imm_se + ins.getInsAddress());
+    int32_t imm_se = ins.imm;
+    registers.writeReg(ins.rd, imm_se + ins.address);
     wrote = true;
-    sprintf(disassembly, "%-8s %s, %d", "AUIPC",
-            register_name[ins.getRd()].c_str(), imm_se);
     break;
   }
   case MNE::LB: { // Carrega 1 byte do address (rs1 + imm) em rd (sign extend)
-    int32_t imm_se = sign_extend(ins.getImm(), ins.getImmSize());
+    int32_t imm_se = ins.imm;
     uint8_t mem_value;
     uint32_t value = 0;
     // Vamos considerar que gastamos pelo menos 1 ciclo para acessar a cache
     lcycle += 1;
     for (int i = 0; i < 1; i++) {
-      lcycle += memory->readMem(registers.readReg(ins.getRs1()) + imm_se + i,
+      lcycle += memory->readMem(registers.readReg(ins.rs1) + imm_se + i,
                                 &mem_value, ACCESS_TYPE::DATA);
       value += mem_value << (8 * i);
     }
     value = sign_extend(value, 8);
-    registers.writeReg(ins.getRd(), value);
+    registers.writeReg(ins.rd, value);
     wrote = true;
-    sprintf(disassembly, "%-8s %s, %s, %d", "LB",
-            register_name[ins.getRd()].c_str(),
-            register_name[ins.getRs1()].c_str(), imm_se);
     break;
   }
   case MNE::LH: { // Carrega 2 bytes do address (rs1 + imm) em rd (sign extend)
-    int32_t imm_se = sign_extend(ins.getImm(), ins.getImmSize());
-    uint8_t mem_value;
+    int32_t imm_se = ins.imm;
+    uint16_t mem_value;
     uint32_t value = 0;
     // Vamos considerar que gastamos pelo menos 1 ciclo para acessar a cache
     lcycle += 1;
-    for (int i = 0; i < 2; i++) {
-      lcycle += memory->readMem(registers.readReg(ins.getRs1()) + imm_se + i,
+    lcycle += memory->readMem16(registers.readReg(ins.rs1) + imm_se,
                                 &mem_value, ACCESS_TYPE::DATA);
-      value += mem_value << (8 * i);
-    }
+    value = mem_value;
     value = sign_extend(value, 16);
-    registers.writeReg(ins.getRd(), value);
+    registers.writeReg(ins.rd, value);
     wrote = true;
-    sprintf(disassembly, "%-8s %s, %s, %d", "LH",
-            register_name[ins.getRd()].c_str(),
-            register_name[ins.getRs1()].c_str(), imm_se);
     break;
   }
   case MNE::LW: { // Carrega 4 byte do address (rs1 + imm) em rd
-    int32_t imm_se = sign_extend(ins.getImm(), ins.getImmSize());
-    uint8_t mem_value;
+    int32_t imm_se = ins.imm;
     uint32_t value = 0;
     // Vamos considerar que gastamos pelo menos 1 ciclo para acessar a cache
     lcycle += 1;
-    for (int i = 0; i < 4; i++) {
-      lcycle += memory->readMem(registers.readReg(ins.getRs1()) + imm_se + i,
-                                &mem_value, ACCESS_TYPE::DATA);
-      value += mem_value << (8 * i);
-    }
-    registers.writeReg(ins.getRd(), value);
+    lcycle += memory->readMem32(registers.readReg(ins.rs1) + imm_se,
+                                &value, ACCESS_TYPE::DATA);
+    registers.writeReg(ins.rd, value);
     wrote = true;
-    sprintf(disassembly, "%-8s %s, %s, %d", "LW",
-            register_name[ins.getRd()].c_str(),
-            register_name[ins.getRs1()].c_str(), imm_se);
     break;
   }
   case MNE::LBU: { // Carrega 1 byte do address (rs1 + imm) em rd (zero extend)
-    int32_t imm_se = sign_extend(ins.getImm(), ins.getImmSize());
+    int32_t imm_se = ins.imm;
     uint8_t mem_value;
     uint32_t value = 0;
     // Vamos considerar que gastamos pelo menos 1 ciclo para acessar a cache
     lcycle += 1;
     for (int i = 0; i < 1; i++) {
-      lcycle += memory->readMem(registers.readReg(ins.getRs1()) + imm_se + i,
+      lcycle += memory->readMem(registers.readReg(ins.rs1) + imm_se + i,
                                 &mem_value, ACCESS_TYPE::DATA);
       value += mem_value << (8 * i);
     }
-    registers.writeReg(ins.getRd(), value);
+    registers.writeReg(ins.rd, value);
     wrote = true;
-    sprintf(disassembly, "%-8s %s, %s, %d", "LBU",
-            register_name[ins.getRd()].c_str(),
-            register_name[ins.getRs1()].c_str(), imm_se);
     break;
   }
   case MNE::LHU: { // Carrega 2 bytes do address (rs1 + imm) em rd (zero extend)
-    int32_t imm_se = sign_extend(ins.getImm(), ins.getImmSize());
-    uint8_t mem_value;
+    int32_t imm_se = ins.imm;
+    uint16_t mem_value;
     uint32_t value = 0;
     // Vamos considerar que gastamos pelo menos 1 ciclo para acessar a cache
     lcycle += 1;
-    for (int i = 0; i < 2; i++) {
-      lcycle += memory->readMem(registers.readReg(ins.getRs1()) + imm_se + i,
+    lcycle += memory->readMem16(registers.readReg(ins.rs1) + imm_se,
                                 &mem_value, ACCESS_TYPE::DATA);
-      value += mem_value << (8 * i);
-    }
-    registers.writeReg(ins.getRd(), value);
+    value = mem_value;
+    registers.writeReg(ins.rd, value);
     wrote = true;
-    sprintf(disassembly, "%-8s %s, %s, %d", "LHU",
-            register_name[ins.getRd()].c_str(),
-            register_name[ins.getRs1()].c_str(), imm_se);
     break;
   }
   case MNE::SB: { // store byte na memoria
-    int32_t imm_se = sign_extend(ins.getImm(), ins.getImmSize());
-    uint32_t value = registers.readReg(ins.getRs2()) & 255; // 1 byte
+    int32_t imm_se = ins.imm;
+    uint32_t value = registers.readReg(ins.rs2) & 255; // 1 byte
     // Vamos considerar que gastamos pelo menos 1 ciclo para acessar a cache
     lcycle += 1;
-    lcycle += memory->writeMem(registers.readReg(ins.getRs1()) + imm_se, value,
+    lcycle += memory->writeMem(registers.readReg(ins.rs1) + imm_se, value,
                                ACCESS_TYPE::DATA);
-    sprintf(disassembly, "%-8s %s, %s, %d", "SB",
-            register_name[ins.getRs1()].c_str(),
-            register_name[ins.getRs2()].c_str(), imm_se);
     break;
   }
   case MNE::SH: { // store half word na memoria
-    int32_t imm_se = sign_extend(ins.getImm(), ins.getImmSize());
-    uint32_t value = registers.readReg(ins.getRs2()) & 4095; // 2 byte
+    int32_t imm_se = ins.imm;
+    uint32_t value = registers.readReg(ins.rs2) & 4095; // 2 byte
     // Vamos considerar que gastamos pelo menos 1 ciclo para acessar a cache
     lcycle += 1;
-    lcycle += memory->writeMem(registers.readReg(ins.getRs1()) + imm_se, value,
-                               ACCESS_TYPE::DATA);
-    lcycle += memory->writeMem(registers.readReg(ins.getRs1()) + imm_se + 1,
-                               value >> 8, ACCESS_TYPE::DATA);
-    sprintf(disassembly, "%-8s %s, %s, %d", "SH",
-            register_name[ins.getRs1()].c_str(),
-            register_name[ins.getRs2()].c_str(), imm_se);
+    lcycle += memory->writeMem16(registers.readReg(ins.rs1) + imm_se,
+                                 value, ACCESS_TYPE::DATA);
     break;
   }
   case MNE::SW: { // store word na memoria
-    int32_t imm_se = sign_extend(ins.getImm(), ins.getImmSize());
-    uint32_t value = registers.readReg(ins.getRs2()); // 4 bytes
+    int32_t imm_se = ins.imm;
+    uint32_t value = registers.readReg(ins.rs2); // 4 bytes
     // Vamos considerar que gastamos pelo menos 1 ciclo para acessar a cache
     lcycle += 1;
-    lcycle += memory->writeMem(registers.readReg(ins.getRs1()) + imm_se, value,
-                               ACCESS_TYPE::DATA);
-    lcycle += memory->writeMem(registers.readReg(ins.getRs1()) + imm_se + 1,
-                               value >> 8, ACCESS_TYPE::DATA);
-    lcycle += memory->writeMem(registers.readReg(ins.getRs1()) + imm_se + 2,
-                               value >> 16, ACCESS_TYPE::DATA);
-    lcycle += memory->writeMem(registers.readReg(ins.getRs1()) + imm_se + 3,
-                               value >> 24, ACCESS_TYPE::DATA);
-    sprintf(disassembly, "%-8s %s, %s, %d", "SW",
-            register_name[ins.getRs1()].c_str(),
-            register_name[ins.getRs2()].c_str(), imm_se);
+    lcycle += memory->writeMem32(registers.readReg(ins.rs1) + imm_se,
+                                 value, ACCESS_TYPE::DATA);
     break;
   }
   case MNE::SLL: { // shift rs1 left (lower 5 bits de rs2)
-    uint32_t shammt = registers.readReg(ins.getRs2()) & 31;
-    uint32_t value = registers.readReg(ins.getRs1()) << shammt;
-    registers.writeReg(ins.getRd(), value);
+    uint32_t shammt = registers.readReg(ins.rs2) & 31;
+    uint32_t value = registers.readReg(ins.rs1) << shammt;
+    registers.writeReg(ins.rd, value);
     wrote = true;
-    sprintf(disassembly, "%-8s %s, %s, %s", "SLL",
-            register_name[ins.getRd()].c_str(),
-            register_name[ins.getRs1()].c_str(),
-            register_name[ins.getRs2()].c_str());
     break;
   }
   case MNE::SLLI: { // shift rs1 left shammt e guarda e rd
-    uint32_t value = registers.readReg(ins.getRs1()) << ins.getShammt();
-    registers.writeReg(ins.getRd(), value);
+    uint32_t value = registers.readReg(ins.rs1) << ins.shammt;
+    registers.writeReg(ins.rd, value);
     wrote = true;
-    sprintf(disassembly, "%-8s %s, %s, %d", "SLLI",
-            register_name[ins.getRd()].c_str(),
-            register_name[ins.getRs1()].c_str(), ins.getShammt());
     break;
   }
   case MNE::SRL: { // shift rs1 right (lower 5 bits de rs2)
-    uint32_t shammt = registers.readReg(ins.getRs2()) & 31;
-    uint32_t value = registers.readReg(ins.getRs1()) >> shammt;
-    registers.writeReg(ins.getRd(), value);
+    uint32_t shammt = registers.readReg(ins.rs2) & 31;
+    uint32_t value = registers.readReg(ins.rs1) >> shammt;
+    registers.writeReg(ins.rd, value);
     wrote = true;
-    sprintf(disassembly, "%-8s %s, %s, %s", "SRL",
-            register_name[ins.getRd()].c_str(),
-            register_name[ins.getRs1()].c_str(),
-            register_name[ins.getRs2()].c_str());
     break;
   }
   case MNE::SRLI: { // shift rs1 right shammt e guarda e rd
-    uint32_t value = registers.readReg(ins.getRs1()) >> ins.getShammt();
-    registers.writeReg(ins.getRd(), value);
-    sprintf(disassembly, "%-8s %s, %s, %d", "SRLI",
-            register_name[ins.getRd()].c_str(),
-            register_name[ins.getRs1()].c_str(), ins.getShammt());
+    uint32_t value = registers.readReg(ins.rs1) >> ins.shammt;
+    registers.writeReg(ins.rd, value);
     break;
   }
   case MNE::SRA: { // shift rs1 right aritimetico (lower 5 bits de rs2)
-    uint32_t shammt = registers.readReg(ins.getRs2()) & 31;
-    uint32_t value = registers.readReg(ins.getRs1()) >> shammt;
+    uint32_t shammt = registers.readReg(ins.rs2) & 31;
+    uint32_t value = registers.readReg(ins.rs1) >> shammt;
     value = sign_extend(value, 32 - shammt);
-    registers.writeReg(ins.getRd(), value);
+    registers.writeReg(ins.rd, value);
     wrote = true;
-    sprintf(disassembly, "%-8s %s, %s, %s", "SRA",
-            register_name[ins.getRd()].c_str(),
-            register_name[ins.getRs1()].c_str(),
-            register_name[ins.getRs2()].c_str());
     break;
   }
   case MNE::SRAI: { // shift rs1 right aritimetico e guarda e rd
-    int32_t value = registers.readReg(ins.getRs1()) >> ins.getShammt();
-    value = sign_extend(value, 32 - ins.getShammt());
-    registers.writeReg(ins.getRd(), value);
+    int32_t value = registers.readReg(ins.rs1) >> ins.shammt;
+    value = sign_extend(value, 32 - ins.shammt);
+    registers.writeReg(ins.rd, value);
     wrote = true;
-    sprintf(disassembly, "%-8s %s, %s, %d", "SRAI",
-            register_name[ins.getRd()].c_str(),
-            register_name[ins.getRs1()].c_str(), ins.getShammt());
     break;
   }
   case MNE::ADD: { // soma rs1 e rs2 e guarda em rd
-    int32_t value = (int32_t)registers.readReg(ins.getRs1()) +
-                    (int32_t)registers.readReg(ins.getRs2());
-    registers.writeReg(ins.getRd(), value);
+    int32_t value = (int32_t)registers.readReg(ins.rs1) +
+                    (int32_t)registers.readReg(ins.rs2);
+    registers.writeReg(ins.rd, value);
     wrote = true;
-    sprintf(disassembly, "%-8s %s, %s, %s", "ADD",
-            register_name[ins.getRd()].c_str(),
-            register_name[ins.getRs1()].c_str(),
-            register_name[ins.getRs2()].c_str());
     break;
   }
   case MNE::ADDI: { // soma rs1 e immediato (sign extended)
-    int32_t imm_se = sign_extend(ins.getImm(), ins.getImmSize());
-    int32_t value = (int32_t)registers.readReg(ins.getRs1()) + imm_se;
-    registers.writeReg(ins.getRd(), value);
+    int32_t imm_se = ins.imm;
+    int32_t value = (int32_t)registers.readReg(ins.rs1) + imm_se;
+    registers.writeReg(ins.rd, value);
     wrote = true;
-    sprintf(disassembly, "%-8s %s, %s, %d", "ADDI",
-            register_name[ins.getRd()].c_str(),
-            register_name[ins.getRs1()].c_str(), imm_se);
     break;
   }
   case MNE::SUB: { // subtrai rs2 de rs1 e guarda em rd
-    int32_t value = (int32_t)registers.readReg(ins.getRs1()) -
-                    (int32_t)registers.readReg(ins.getRs2());
-    registers.writeReg(ins.getRd(), value);
+    int32_t value = (int32_t)registers.readReg(ins.rs1) -
+                    (int32_t)registers.readReg(ins.rs2);
+    registers.writeReg(ins.rd, value);
     wrote = true;
-    sprintf(disassembly, "%-8s %s, %s, %s", "SUB",
-            register_name[ins.getRd()].c_str(),
-            register_name[ins.getRs1()].c_str(),
-            register_name[ins.getRs2()].c_str());
     break;
   }
   case MNE::XOR: { // bitwise XOR entre rs1 e rs2 e guarda em rd
     uint32_t value =
-        registers.readReg(ins.getRs1()) ^ registers.readReg(ins.getRs2());
-    registers.writeReg(ins.getRd(), value);
+        registers.readReg(ins.rs1) ^ registers.readReg(ins.rs2);
+    registers.writeReg(ins.rd, value);
     wrote = true;
-    sprintf(disassembly, "%-8s %s, %s, %s", "XOR",
-            register_name[ins.getRd()].c_str(),
-            register_name[ins.getRs1()].c_str(),
-            register_name[ins.getRs2()].c_str());
     break;
   }
   case MNE::XORI: {
-    int32_t imm_se = sign_extend(ins.getImm(), ins.getImmSize());
-    uint32_t value = registers.readReg(ins.getRs1()) ^ imm_se;
-    registers.writeReg(ins.getRd(), value);
+    int32_t imm_se = ins.imm;
+    uint32_t value = registers.readReg(ins.rs1) ^ imm_se;
+    registers.writeReg(ins.rd, value);
     wrote = true;
-    sprintf(disassembly, "%-8s %s, %s, %d", "XORI",
-            register_name[ins.getRd()].c_str(),
-            register_name[ins.getRs1()].c_str(), imm_se);
     break;
   }
   case MNE::OR: { // bitwise or entre rs1 e rs2 e guarda em rd
     uint32_t value =
-        registers.readReg(ins.getRs1()) | registers.readReg(ins.getRs2());
-    registers.writeReg(ins.getRd(), value);
+        registers.readReg(ins.rs1) | registers.readReg(ins.rs2);
+    registers.writeReg(ins.rd, value);
     wrote = true;
-    sprintf(disassembly, "%-8s %s, %s, %s", "OR",
-            register_name[ins.getRd()].c_str(),
-            register_name[ins.getRs1()].c_str(),
-            register_name[ins.getRs2()].c_str());
     break;
   }
   case MNE::ORI: {
-    int32_t imm_se = sign_extend(ins.getImm(), ins.getImmSize());
-    uint32_t value = registers.readReg(ins.getRs1()) | imm_se;
-    registers.writeReg(ins.getRd(), value);
+    int32_t imm_se = ins.imm;
+    uint32_t value = registers.readReg(ins.rs1) | imm_se;
+    registers.writeReg(ins.rd, value);
     wrote = true;
-    sprintf(disassembly, "%-8s %s, %s, %d", "ORI",
-            register_name[ins.getRd()].c_str(),
-            register_name[ins.getRs1()].c_str(), imm_se);
     break;
   }
   case MNE::AND: { // bitwise and entre rs1 e rs2 e guarda em rd
     uint32_t value =
-        registers.readReg(ins.getRs1()) & registers.readReg(ins.getRs2());
-    registers.writeReg(ins.getRd(), value);
+        registers.readReg(ins.rs1) & registers.readReg(ins.rs2);
+    registers.writeReg(ins.rd, value);
     wrote = true;
-    sprintf(disassembly, "%-8s %s, %s, %s", "AND",
-            register_name[ins.getRd()].c_str(),
-            register_name[ins.getRs1()].c_str(),
-            register_name[ins.getRs2()].c_str());
     break;
   }
   case MNE::ANDI: { // bitwise and entre rs1 e imm e guarda em rd
-    int32_t imm_se = sign_extend(ins.getImm(), ins.getImmSize());
-    uint32_t value = registers.readReg(ins.getRs1()) & imm_se;
-    registers.writeReg(ins.getRd(), value);
+    int32_t imm_se = ins.imm;
+    uint32_t value = registers.readReg(ins.rs1) & imm_se;
+    registers.writeReg(ins.rd, value);
     wrote = true;
-    sprintf(disassembly, "%-8s %s, %s, %d", "ANDI",
-            register_name[ins.getRd()].c_str(),
-            register_name[ins.getRs1()].c_str(), imm_se);
     break;
   }
   case MNE::SLT: { // rs1 < rs2 ? (com sinal)
-    bool lessthan = (int32_t)registers.readReg(ins.getRs1()) <
-                    (int32_t)registers.readReg(ins.getRs2());
-    registers.writeReg(ins.getRd(), lessthan == true ? 1 : 0);
+    bool lessthan = (int32_t)registers.readReg(ins.rs1) <
+                    (int32_t)registers.readReg(ins.rs2);
+    registers.writeReg(ins.rd, lessthan == true ? 1 : 0);
     wrote = true;
-    sprintf(disassembly, "%-8s %s, %s, %s", "SLT",
-            register_name[ins.getRd()].c_str(),
-            register_name[ins.getRs1()].c_str(),
-            register_name[ins.getRs2()].c_str());
     break;
   }
   case MNE::SLTI: { // rs1 < imm ? (com sinal)
-    int32_t imm_se = sign_extend(ins.getImm(), ins.getImmSize());
-    bool lessthan = (int32_t)registers.readReg(ins.getRs1()) < imm_se;
-    registers.writeReg(ins.getRd(), lessthan == true ? 1 : 0);
+    int32_t imm_se = ins.imm;
+    bool lessthan = (int32_t)registers.readReg(ins.rs1) < imm_se;
+    registers.writeReg(ins.rd, lessthan == true ? 1 : 0);
     wrote = true;
-    sprintf(disassembly, "%-8s %s, %s, %d", "SLTI",
-            register_name[ins.getRd()].c_str(),
-            register_name[ins.getRs1()].c_str(), imm_se);
     break;
   }
   case MNE::SLTU: { // rs1 < rs2 ? (sem sinal)
     bool lessthan =
-        registers.readReg(ins.getRs1()) < registers.readReg(ins.getRs2());
-    registers.writeReg(ins.getRd(), lessthan == true ? 1 : 0);
+        registers.readReg(ins.rs1) < registers.readReg(ins.rs2);
+    registers.writeReg(ins.rd, lessthan == true ? 1 : 0);
     wrote = true;
-    sprintf(disassembly, "%-8s %s, %s, %s", "SLTU",
-            register_name[ins.getRd()].c_str(),
-            register_name[ins.getRs1()].c_str(),
-            register_name[ins.getRs2()].c_str());
     break;
   }
   case MNE::SLTIU: { // rs1 < imm ? (sem sinal)
-    int32_t imm_se = sign_extend(ins.getImm(), ins.getImmSize());
-    bool lessthan = registers.readReg(ins.getRs1()) < imm_se;
-    registers.writeReg(ins.getRd(), lessthan == true ? 1 : 0);
+    int32_t imm_se = ins.imm;
+    bool lessthan = registers.readReg(ins.rs1) < imm_se;
+    registers.writeReg(ins.rd, lessthan == true ? 1 : 0);
     wrote = true;
-    sprintf(disassembly, "%-8s %s, %s, %d", "SLTIU",
-            register_name[ins.getRd()].c_str(),
-            register_name[ins.getRs1()].c_str(), imm_se);
     break;
   }
   case MNE::BEQ: { // salta se igual (atual + imm sig)
     is_branch = true;
-    int32_t imm_se = sign_extend(ins.getImm(), ins.getImmSize());
-    if (registers.readReg(ins.getRs1()) == registers.readReg(ins.getRs2())) {
-      PC = (uint32_t)((int32_t)ins.getInsAddress() + imm_se);
+    int32_t imm_se = ins.imm;
+    if (registers.readReg(ins.rs1) == registers.readReg(ins.rs2)) {
+      PC = (uint32_t)((int32_t)ins.address + imm_se);
       branched = true;
     }
-    sprintf(disassembly, "%-8s %s, %s, %d", "BEQ",
-            register_name[ins.getRs1()].c_str(),
-            register_name[ins.getRs2()].c_str(), imm_se);
     break;
   }
   case MNE::BNE: { // salta se diferente (atual + imm sig)
     is_branch = true;
-    int32_t imm_se = sign_extend(ins.getImm(), ins.getImmSize());
-    if (registers.readReg(ins.getRs1()) != registers.readReg(ins.getRs2())) {
-      PC = (uint32_t)((int32_t)ins.getInsAddress() + imm_se);
+    int32_t imm_se = ins.imm;
+    if (registers.readReg(ins.rs1) != registers.readReg(ins.rs2)) {
+      PC = (uint32_t)((int32_t)ins.address + imm_se);
       branched = true;
     }
-    sprintf(disassembly, "%-8s %s, %s, %d", "BNE",
-            register_name[ins.getRs1()].c_str(),
-            register_name[ins.getRs2()].c_str(), imm_se);
     break;
   }
   case MNE::BLT: { // salta se rs1 < rs2 (atual + imm sig) - sig compare
     is_branch = true;
-    int32_t imm_se = sign_extend(ins.getImm(), ins.getImmSize());
-    if ((int32_t)(registers.readReg(ins.getRs1())) <
-        (int32_t)(registers.readReg(ins.getRs2()))) {
-      PC = (uint32_t)((int32_t)ins.getInsAddress() + imm_se);
+    int32_t imm_se = ins.imm;
+    if ((int32_t)(registers.readReg(ins.rs1)) <
+        (int32_t)(registers.readReg(ins.rs2))) {
+      PC = (uint32_t)((int32_t)ins.address + imm_se);
       branched = true;
     }
-    sprintf(disassembly, "%-8s %s, %s, %d", "BLT",
-            register_name[ins.getRs1()].c_str(),
-            register_name[ins.getRs2()].c_str(), imm_se);
     break;
   }
   case MNE::BGE: { // salta se rs1 >= rs2 (atual + imm sig) - sig compare
     is_branch = true;
-    int32_t imm_se = sign_extend(ins.getImm(), ins.getImmSize());
-    if ((int32_t)(registers.readReg(ins.getRs1())) >=
-        (int32_t)(registers.readReg(ins.getRs2()))) {
-      PC = (uint32_t)((int32_t)ins.getInsAddress() + imm_se);
+    int32_t imm_se = ins.imm;
+    if ((int32_t)(registers.readReg(ins.rs1)) >=
+        (int32_t)(registers.readReg(ins.rs2))) {
+      PC = (uint32_t)((int32_t)ins.address + imm_se);
       branched = true;
     }
-    sprintf(disassembly, "%-8s %s, %s, %d", "BGE",
-            register_name[ins.getRs1()].c_str(),
-            register_name[ins.getRs2()].c_str(), imm_se);
     break;
   }
   case MNE::BLTU: { // salta se rs1 < rs2 (atual + imm sig) - unsig compare
     is_branch = true;
-    int32_t imm_se = sign_extend(ins.getImm(), ins.getImmSize());
-    if (registers.readReg(ins.getRs1()) < registers.readReg(ins.getRs2())) {
-      PC = (uint32_t)((int32_t)ins.getInsAddress() + imm_se);
+    int32_t imm_se = ins.imm;
+    if (registers.readReg(ins.rs1) < registers.readReg(ins.rs2)) {
+      PC = (uint32_t)((int32_t)ins.address + imm_se);
       branched = true;
     }
-    sprintf(disassembly, "%-8s %s, %s, %d", "BLTU",
-            register_name[ins.getRs1()].c_str(),
-            register_name[ins.getRs2()].c_str(), imm_se);
     break;
   }
   case MNE::BGEU: { // salta se rs1 >= rs2 (atual + imm sig) - unsig compare
     is_branch = true;
-    int32_t imm_se = sign_extend(ins.getImm(), ins.getImmSize());
-    if (registers.readReg(ins.getRs1()) >= registers.readReg(ins.getRs2())) {
-      PC = (uint32_t)((int32_t)ins.getInsAddress() + imm_se);
+    int32_t imm_se = ins.imm;
+    if (registers.readReg(ins.rs1) >= registers.readReg(ins.rs2)) {
+      PC = (uint32_t)((int32_t)ins.address + imm_se);
       branched = true;
     }
-    sprintf(disassembly, "%-8s %s, %s, %d", "BGEU",
-            register_name[ins.getRs1()].c_str(),
-            register_name[ins.getRs2()].c_str(), imm_se);
     break;
   }
   case MNE::JAL: { // jump (atual + imm) and link pc+4
     is_branch = true;
-    int32_t imm_se = sign_extend(ins.getImm(), ins.getImmSize());
-    registers.writeReg(ins.getRd(), ins.getInsAddress() + 4);
+    int32_t imm_se = ins.imm;
+    registers.writeReg(ins.rd, ins.address + 4);
     wrote = true;
-    PC = (uint32_t)((int32_t)ins.getInsAddress() + imm_se);
+    PC = (uint32_t)((int32_t)ins.address + imm_se);
     branched = true;
-    sprintf(disassembly, "%-8s %s, %d", "JAL",
-            register_name[ins.getRd()].c_str(), imm_se);
     break;
   }
   case MNE::JALR: { // jump (rs1 + imm) and link pc+4
     is_branch = true;
-    int32_t imm_se = sign_extend(ins.getImm(), ins.getImmSize());
-    registers.writeReg(ins.getRd(), ins.getInsAddress() + 4);
+    int32_t imm_se = ins.imm;
+    registers.writeReg(ins.rd, ins.address + 4);
     wrote = true;
-    PC = (uint32_t)((int32_t)registers.readReg(ins.getRs1()) + imm_se);
+    PC = (uint32_t)((int32_t)registers.readReg(ins.rs1) + imm_se);
     branched = true;
-    sprintf(disassembly, "%-8s %s, %s, %d", "JALR",
-            register_name[ins.getRd()].c_str(),
-            register_name[ins.getRs1()].c_str(), imm_se);
     break;
   }
   case MNE::FENCE:
-    sprintf(disassembly, "%-8s", "FENCE");
     break;
   case MNE::FENCEI: // sync instruction and data streams
-    sprintf(disassembly, "%-8s", "FENCE.I");
+    decoder.invalidateAll();
     break;
   case MNE::SCALL:
-    sprintf(disassembly, "%-8s", "SCALL");
     running = false;
     break;
   case MNE::SBREAK:
-    sprintf(disassembly, "%-8s", "SBREAK");
     running = false;
     break;
   case MNE::RDCYCLE:
-    sprintf(disassembly, "%-8s", "RDCYCLE");
     break;
   case MNE::RDCYCLEH:
-    sprintf(disassembly, "%-8s", "RDCYCLEH");
     break;
   case MNE::RDTIME:
-    sprintf(disassembly, "%-8s", "RDTIME");
     break;
   case MNE::RDTIMEH:
-    sprintf(disassembly, "%-8s", "RDTIMEH");
     break;
   case MNE::RDINSTRRET:
-    sprintf(disassembly, "%-8s", "RDINSTRRET");
     break;
   case MNE::RDINSTRETH:
-    sprintf(disassembly, "%-8s", "RDINSTRETH");
+    break;
+  case MNE::ILLEGAL:
     break;
   case MNE::MUL: { // multiplica rs1 por rs2 e guarda em rd os 32 bits menores
-    int64_t res = (int32_t)registers.readReg(ins.getRs1()) *
-                  (int32_t)registers.readReg(ins.getRs2());
+    int64_t res = (int32_t)registers.readReg(ins.rs1) *
+                  (int32_t)registers.readReg(ins.rs2);
     uint32_t value = (int32_t)res;
-    registers.writeReg(ins.getRd(), value);
+    registers.writeReg(ins.rd, value);
     wrote = true;
-    sprintf(disassembly, "%-8s %s, %s, %s", "MUL",
-            register_name[ins.getRd()].c_str(),
-            register_name[ins.getRs1()].c_str(),
-            register_name[ins.getRs2()].c_str());
     break;
   }
   case MNE::MULH: { // multiplica rs1 por rs2 e guarda em rd os 32 bits maiores
                     // (signed)
-    int64_t res = (int32_t)registers.readReg(ins.getRs1()) *
-                  (int32_t)registers.readReg(ins.getRs2());
+    int64_t res = (int32_t)registers.readReg(ins.rs1) *
+                  (int32_t)registers.readReg(ins.rs2);
     uint32_t value = (int32_t)(res >> 32);
-    registers.writeReg(ins.getRd(), value);
+    registers.writeReg(ins.rd, value);
     wrote = true;
-    sprintf(disassembly, "%-8s %s, %s, %s", "MULH",
-            register_name[ins.getRd()].c_str(),
-            register_name[ins.getRs1()].c_str(),
-            register_name[ins.getRs2()].c_str());
     break;
   }
   case MNE::MULHU: { // multiplica rs1 por rs2 e guarda em rd os 32 bits maiores
                      // (unsigned)
     int64_t res =
-        registers.readReg(ins.getRs1()) * registers.readReg(ins.getRs2());
+        registers.readReg(ins.rs1) * registers.readReg(ins.rs2);
     uint32_t value = (uint32_t)(res >> 32);
-    registers.writeReg(ins.getRd(), value);
+    registers.writeReg(ins.rd, value);
     wrote = true;
-    sprintf(disassembly, "%-8s %s, %s, %s", "MULHU",
-            register_name[ins.getRd()].c_str(),
-            register_name[ins.getRs1()].c_str(),
-            register_name[ins.getRs2()].c_str());
     break;
   }
   case MNE::MULHSU: { // multiplica rs1 por rs2 e guarda em rd os 32 bits
                       // maiores
                       // (signed x unsigned)
-    int64_t res = (int32_t)registers.readReg(ins.getRs1()) *
-                  (uint32_t)registers.readReg(ins.getRs2());
+    int64_t res = (int32_t)registers.readReg(ins.rs1) *
+                  (uint32_t)registers.readReg(ins.rs2);
     uint32_t value = (uint32_t)(res >> 32);
-    registers.writeReg(ins.getRd(), value);
+    registers.writeReg(ins.rd, value);
     wrote = true;
-    sprintf(disassembly, "%-8s %s, %s, %s", "MULHSU",
-            register_name[ins.getRd()].c_str(),
-            register_name[ins.getRs1()].c_str(),
-            register_name[ins.getRs2()].c_str());
     break;
   }
   case MNE::DIV: { // divide rs1 por rs2 e guarda em rd (signed)
-    int32_t value = (int32_t)registers.readReg(ins.getRs1()) /
-                    (int32_t)registers.readReg(ins.getRs2());
-    registers.writeReg(ins.getRd(), value);
+    int32_t value = (int32_t)registers.readReg(ins.rs1) /
+                    (int32_t)registers.readReg(ins.rs2);
+    registers.writeReg(ins.rd, value);
     wrote = true;
-    sprintf(disassembly, "%-8s %s, %s, %s", "DIV",
-            register_name[ins.getRd()].c_str(),
-            register_name[ins.getRs1()].c_str(),
-            register_name[ins.getRs2()].c_str());
     break;
   }
   case MNE::DIVU: { // divide rs1 por rs2 e guarda em rd (unsigned)
-    uint32_t value = (uint32_t)registers.readReg(ins.getRs1()) /
-                     (uint32_t)registers.readReg(ins.getRs2());
-    registers.writeReg(ins.getRd(), value);
+    uint32_t value = (uint32_t)registers.readReg(ins.rs1) /
+                     (uint32_t)registers.readReg(ins.rs2);
+    registers.writeReg(ins.rd, value);
     wrote = true;
-    sprintf(disassembly, "%-8s %s, %s, %s", "DIVU",
-            register_name[ins.getRd()].c_str(),
-            register_name[ins.getRs1()].c_str(),
-            register_name[ins.getRs2()].c_str());
     break;
   }
   case MNE::REM: { // divide rs1 por rs2 e guarda o resto em rd (signed)
-    uint32_t value = (uint32_t)registers.readReg(ins.getRs1()) %
-                     (uint32_t)registers.readReg(ins.getRs2());
-    uint32_t dividend_sign = (ins.getRs1() >> 31);
+    uint32_t value = (uint32_t)registers.readReg(ins.rs1) %
+                     (uint32_t)registers.readReg(ins.rs2);
+    uint32_t dividend_sign = (ins.rs1 >> 31);
     int32_t value_s;
     if (dividend_sign == 1)
       value_s = value * -1;
     else
       value_s = value;
-    registers.writeReg(ins.getRd(), value_s);
+    registers.writeReg(ins.rd, value_s);
     wrote = true;
-    sprintf(disassembly, "%-8s %s, %s, %s", "REM",
-            register_name[ins.getRd()].c_str(),
-            register_name[ins.getRs1()].c_str(),
-            register_name[ins.getRs2()].c_str());
     break;
   }
   case MNE::REMU: { // divide rs1 por rs2 e guarda o resto em rd (unsigned)
-    uint32_t value = (uint32_t)registers.readReg(ins.getRs1()) %
-                     (uint32_t)registers.readReg(ins.getRs2());
-    registers.writeReg(ins.getRd(), value);
+    uint32_t value = (uint32_t)registers.readReg(ins.rs1) %
+                     (uint32_t)registers.readReg(ins.rs2);
+    registers.writeReg(ins.rd, value);
     wrote = true;
-    sprintf(disassembly, "%-8s %s, %s, %s", "REMU",
-            register_name[ins.getRd()].c_str(),
-            register_name[ins.getRs1()].c_str(),
-            register_name[ins.getRs2()].c_str());
     break;
   }
   }
@@ -933,32 +1221,10 @@ uint32_t processor_t::getNextMEM(uint32_t time, uint32_t time_used) {
   return temp;
 }
 
-std::string processor_t::doLogLine(instruction_t ins, char *disassembly) {
-  std::ostringstream out;
-  // Monta PC
-  out << "[PC=" << std::uppercase << std::hex << std::setw(8)
-      << std::setfill('0') << ins.getInsAddress() << "] ";
-  // Instrução PC
-  out << "[" << std::uppercase << std::hex << std::setw(8) << std::setfill('0')
-      << ins.getIns() << "] ";
-  // // Monta rd
-  // uint32_t rd = (ins.getIns() >> 7) & 31;
-  // out << "[x" << std::dec << std::setw(2) << std::setfill('0') << rd << "=";
-  // out << std::uppercase << std::hex << std::setw(8) << std::setfill('0')
-  //     << registers.readReg(rd) << "] ";
-  // // Monta rs1
-  // uint32_t rs1 = (ins.getIns() >> 15) & 31;
-  // out << "[x" << std::dec << std::setw(2) << std::setfill('0') << rs1 << "=";
-  // out << std::uppercase << std::hex << std::setw(8) << std::setfill('0')
-  //     << registers.readReg(rs1) << "] ";
-  // // Monta rs2
-  // uint32_t rs2 = (ins.getIns() >> 20) & 31;
-  // out << "[x" << std::dec << std::setw(2) << std::setfill('0') << rs2 << "=";
-  // out << std::uppercase << std::hex << std::setw(8) << std::setfill('0')
-  //     << registers.readReg(rs2) << "] ";
-  // Disassembly (De acordo com os slides)
-  out << disassembly;
-  return out.str();
+std::string processor_t::doLogLine(const decoded_t &ins) {
+  char line[LOG_LINE_SIZE];
+  formatLogLine(ins, line, sizeof(line));
+  return std::string(line);
 }
 
 /***************************************************************************
@@ -967,6 +1233,9 @@ Gshare
 gshare_t::gshare_t(int psize, int pbtb_size) {
   size = psize; // Em bits
   btb_size = pbtb_size;
+  btb_tag_shift = 2;
+  while ((1 << (btb_tag_shift - 2)) < btb_size)
+    btb_tag_shift++;
   table_entries = 2;
   for (int i = 1; i < size; i++)
     table_entries *= 2;
@@ -1013,8 +1282,9 @@ bool gshare_t::checkBranch() {
 }
 
 uint32_t gshare_t::getBTB(uint32_t address) {
-  uint32_t btb_entry = (address >> 2) & (btb_size - 1); // pega os bits 11 .. 2
-  uint32_t tag = (address >> 12);                       // pega os bits 31 .. 12
+  // Com 1024 entradas: índice nos bits 11..2 e tag nos bits 31..12
+  uint32_t btb_entry = (address >> 2) & (btb_size - 1);
+  uint32_t tag = (address >> btb_tag_shift);
 
   if (btb_tag[btb_entry] == tag) {
     // btb bate com PC passado, returna o endereço que está na tbt
@@ -1040,8 +1310,8 @@ void gshare_t::feedback(bool branched, uint32_t pc, uint32_t address) {
   // atualizar a btb para se tiver um branch futuro termos o endereço certo de
   // salto
   if (branched) {
-    uint32_t btb_entry = (pc >> 2) & (btb_size - 1); // pega os bits 11..2
-    uint32_t tag = (pc >> 12);                       // pega os bits 31 .. 12
+    uint32_t btb_entry = (pc >> 2) & (btb_size - 1);
+    uint32_t tag = (pc >> btb_tag_shift);
 
     // Atualiza o endereço de salto
     btb[btb_entry] = address;
@@ -1082,6 +1352,57 @@ void gshare_t::feedback(bool branched, uint32_t pc, uint32_t address) {
   //           << std::endl;
 }
 
+void gshare_t::saveState(checkpoint_writer_t &writer) const {
+  writer.putVarint(size);
+  writer.putVarint(btb_size);
+  for (int i = 0; i < table_entries; i++)
+    writer.putU8(h_table[i]);
+  for (int i = 0; i < btb_size; i++) {
+    writer.putVarint(btb[i]);
+    writer.putVarint(btb_tag[i]);
+  }
+  writer.putVarint(history);
+  writer.putVarint(l_history);
+  // Branches ainda sem feedback
+  std::queue<std::pair<int, bool>> pending = branch_h;
+  writer.putVarint(pending.size());
+  while (!pending.empty()) {
+    writer.putVarint(pending.front().first);
+    writer.putU8(pending.front().second);
+    pending.pop();
+  }
+}
+
+bool gshare_t::loadState(checkpoint_reader_t &reader) {
+  uint64_t saved_size = reader.getVarint();
+  uint64_t saved_btb_size = reader.getVarint();
+  if (!reader.good() || saved_size != (uint64_t)size ||
+      saved_btb_size != (uint64_t)btb_size)
+    return false;
+  // Lido em uma cópia, aplicada só se o bloco inteiro for válido
+  gshare_t staged = *this;
+  for (int i = 0; i < table_entries; i++)
+    staged.h_table[i] = reader.getU8();
+  for (int i = 0; i < btb_size; i++) {
+    staged.btb[i] = reader.getVarint();
+    staged.btb_tag[i] = reader.getVarint();
+  }
+  staged.history = reader.getVarint();
+  staged.l_history = reader.getVarint();
+  while (!staged.branch_h.empty())
+    staged.branch_h.pop();
+  uint64_t pending = reader.getVarint();
+  for (uint64_t i = 0; i < pending && reader.good(); i++) {
+    int entry = reader.getVarint();
+    bool decision = reader.getU8();
+    staged.branch_h.push(std::pair<int, bool>(entry, decision));
+  }
+  if (!reader.good())
+    return false;
+  *this = staged;
+  return true;
+}
+
 int gshare_t::getHits() { return hits; }
 
 int gshare_t::getErrors() { return errors; }
\ No newline at end of file
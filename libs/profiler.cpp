@@ -0,0 +1,246 @@
+#include "profiler.h"
+
+#include <cstring>
+
+#include <algorithm>
+#include <map>
+
+// Espalha os PCs (múltiplos de 4) pela tabela
+static inline uint32_t hashPC(uint32_t pc) { return (pc >> 2) * 2654435761u; }
+
+static inline uint32_t hashKey(uint64_t key) {
+  return (uint32_t)((key ^ (key >> 29)) * 0x9e3779b97f4a7c15ull >> 32);
+}
+
+profiler_t::profiler_t(uint32_t pentry_point) {
+  entry_point = pentry_point;
+  entries.assign(PROFILE_INITIAL_ENTRIES, profile_entry_t());
+  used = 0;
+  child_keys.assign(PROFILE_INITIAL_ENTRIES, 0);
+  child_nodes.assign(PROFILE_INITIAL_ENTRIES, 0);
+  child_used = 0;
+  stack.reserve(PROFILE_MAX_DEPTH);
+  overflow_depth = 0;
+  // A raiz da árvore de chamadas é a função do ponto de entrada
+  nodes.push_back({0, entry_point, 0, 0});
+  current = 0;
+}
+
+bool profiler_t::loadSymbols(const elf_file_t &elf) {
+  if (!symbols.load(elf))
+    return false;
+  nodes[0].function = functionOf(entry_point);
+  return true;
+}
+
+profile_entry_t &profiler_t::find(uint32_t pc) {
+  uint32_t mask = entries.size() - 1;
+  uint32_t slot = hashPC(pc) & mask;
+  while (true) {
+    profile_entry_t &entry = entries[slot];
+    // Entradas vazias têm contagem 0 (record incrementa logo em seguida)
+    if (entry.count == 0) {
+      if (2 * (used + 1) > entries.size()) {
+        growEntries();
+        return find(pc);
+      }
+      used++;
+      entry.pc = pc;
+      return entry;
+    }
+    if (entry.pc == pc)
+      return entry;
+    slot = (slot + 1) & mask;
+  }
+}
+
+void profiler_t::growEntries() {
+  std::vector<profile_entry_t> old;
+  old.swap(entries);
+  entries.assign(old.size() * 2, profile_entry_t());
+  uint32_t mask = entries.size() - 1;
+  for (const profile_entry_t &entry : old) {
+    if (entry.count == 0)
+      continue;
+    uint32_t slot = hashPC(entry.pc) & mask;
+    while (entries[slot].count != 0)
+      slot = (slot + 1) & mask;
+    entries[slot] = entry;
+  }
+}
+
+uint32_t profiler_t::child(uint32_t parent, uint32_t function) {
+  uint64_t key = ((uint64_t)parent << 32) | function;
+  uint32_t mask = child_keys.size() - 1;
+  uint32_t slot = hashKey(key) & mask;
+  while (child_nodes[slot] != 0) {
+    if (child_keys[slot] == key)
+      return child_nodes[slot] - 1;
+    slot = (slot + 1) & mask;
+  }
+  // Primeira chamada de function a partir de parent
+  uint32_t node = nodes.size();
+  nodes.push_back({parent, function, 0, 0});
+  child_keys[slot] = key;
+  child_nodes[slot] = node + 1;
+  child_used++;
+  if (2 * child_used > child_keys.size())
+    growChildren();
+  return node;
+}
+
+void profiler_t::growChildren() {
+  std::vector<uint64_t> old_keys;
+  std::vector<uint32_t> old_nodes;
+  old_keys.swap(child_keys);
+  old_nodes.swap(child_nodes);
+  child_keys.assign(old_keys.size() * 2, 0);
+  child_nodes.assign(old_nodes.size() * 2, 0);
+  uint32_t mask = child_keys.size() - 1;
+  for (size_t i = 0; i < old_keys.size(); i++) {
+    if (old_nodes[i] == 0)
+      continue;
+    uint32_t slot = hashKey(old_keys[i]) & mask;
+    while (child_nodes[slot] != 0)
+      slot = (slot + 1) & mask;
+    child_keys[slot] = old_keys[i];
+    child_nodes[slot] = old_nodes[i];
+  }
+}
+
+void profiler_t::callOrReturn(const decoded_t &ins, uint32_t next_pc) {
+  // Convenção de chamada do RISC-V: o endereço de retorno vai para ra (ou t0
+  // nas chamadas alternativas)
+  if (ins.rd == 1 || ins.rd == 5) {
+    // Além do limite a chamada só é contada, para que o retorno dela não
+    // desempilhe uma chamada de baixo
+    if (stack.size() < PROFILE_MAX_DEPTH) {
+      stack.push_back(current);
+      current = child(current, functionOf(next_pc));
+    } else {
+      overflow_depth++;
+    }
+  } else if (ins.op == MNE::JALR && ins.rd == 0 &&
+             (ins.rs1 == 1 || ins.rs1 == 5)) {
+    // Retornos sem chamada correspondente (longjmp, código de partida) ficam
+    // na raiz
+    if (overflow_depth > 0) {
+      overflow_depth--;
+    } else if (!stack.empty()) {
+      current = stack.back();
+      stack.pop_back();
+    }
+  }
+}
+
+uint32_t profiler_t::functionOf(uint32_t address) const {
+  const elf_symbol_t *symbol = symbols.find(address);
+  return symbol != nullptr ? symbol->address : address;
+}
+
+std::string profiler_t::functionName(uint32_t function) const {
+  const elf_symbol_t *symbol = symbols.find(function);
+  if (symbol != nullptr && symbol->address == function)
+    return symbol->name;
+  char name[16];
+  snprintf(name, sizeof(name), "0x%08x", function);
+  return name;
+}
+
+// Ciclos quando há temporização, senão a contagem de instruções
+static uint64_t weight(const profile_entry_t &entry, bool timed) {
+  return timed ? entry.cycles : entry.count;
+}
+
+void profiler_t::writeReport(FILE *out, unsigned top) const {
+  std::vector<profile_entry_t> sorted;
+  uint64_t instructions = 0, cycles = 0;
+  for (const profile_entry_t &entry : entries) {
+    if (entry.count == 0)
+      continue;
+    sorted.push_back(entry);
+    instructions += entry.count;
+    cycles += entry.cycles;
+  }
+  bool timed = cycles > 0;
+  uint64_t total = timed ? cycles : instructions;
+  if (total == 0)
+    total = 1;
+
+  // Custo próprio de cada função (sem as funções chamadas)
+  std::map<uint32_t, profile_entry_t> functions;
+  for (const profile_entry_t &entry : sorted) {
+    profile_entry_t &function = functions[functionOf(entry.pc)];
+    function.pc = functionOf(entry.pc);
+    function.count += entry.count;
+    function.cycles += entry.cycles;
+    function.icache_misses += entry.icache_misses;
+    function.dcache_misses += entry.dcache_misses;
+    function.mispredictions += entry.mispredictions;
+  }
+  std::vector<profile_entry_t> by_function;
+  for (const auto &function : functions)
+    by_function.push_back(function.second);
+  auto heavier = [timed](const profile_entry_t &a, const profile_entry_t &b) {
+    if (weight(a, timed) != weight(b, timed))
+      return weight(a, timed) > weight(b, timed);
+    return a.pc < b.pc;
+  };
+  std::sort(by_function.begin(), by_function.end(), heavier);
+  std::sort(sorted.begin(), sorted.end(), heavier);
+
+  fprintf(out, "PERFIL: %lu instruções, %lu ciclos, %zu PCs distintos\n",
+          (unsigned long)instructions, (unsigned long)cycles, sorted.size());
+  fprintf(out, "\nPOR FUNÇÃO (custo próprio, ordenado por %s):\n",
+          timed ? "ciclos" : "instruções");
+  fprintf(out, "  %7s %12s %12s %8s %8s %8s  %s\n", "%", "instruções",
+          "ciclos", "miss-I", "miss-D", "pred-err", "função");
+  for (const profile_entry_t &function : by_function)
+    fprintf(out, "  %6.2f%% %12lu %12lu %8lu %8lu %8lu  %s\n",
+            100.0 * weight(function, timed) / total,
+            (unsigned long)function.count, (unsigned long)function.cycles,
+            (unsigned long)function.icache_misses,
+            (unsigned long)function.dcache_misses,
+            (unsigned long)function.mispredictions,
+            functionName(function.pc).c_str());
+
+  fprintf(out, "\nPOR INSTRUÇÃO (top %u):\n", top);
+  fprintf(out, "  %7s %10s %12s %12s %8s %8s %8s  %-28s %s\n", "%", "pc",
+          "instruções", "ciclos", "miss-I", "miss-D", "pred-err", "função",
+          "instrução");
+  for (size_t i = 0; i < sorted.size() && i < top; i++) {
+    const profile_entry_t &entry = sorted[i];
+    char location[64], text[LOG_LINE_SIZE];
+    uint32_t function = functionOf(entry.pc);
+    snprintf(location, sizeof(location), "%s+0x%x",
+             functionName(function).c_str(), entry.pc - function);
+    disassemble(decodeInstruction(entry.raw, entry.pc), text, sizeof(text));
+    fprintf(out, "  %6.2f%% 0x%08x %12lu %12lu %8lu %8lu %8lu  %-28s %s\n",
+            100.0 * weight(entry, timed) / total, entry.pc,
+            (unsigned long)entry.count, (unsigned long)entry.cycles,
+            (unsigned long)entry.icache_misses,
+            (unsigned long)entry.dcache_misses,
+            (unsigned long)entry.mispredictions, location, text);
+  }
+}
+
+void profiler_t::writeFolded(FILE *out) const {
+  bool timed = false;
+  for (const profile_node_t &node : nodes)
+    timed |= node.cycles > 0;
+  std::vector<uint32_t> path;
+  for (size_t index = 0; index < nodes.size(); index++) {
+    const profile_node_t &node = nodes[index];
+    uint64_t value = timed ? node.cycles : node.count;
+    if (value == 0)
+      continue;
+    path.clear();
+    for (uint32_t walk = index; walk != 0; walk = nodes[walk].parent)
+      path.push_back(nodes[walk].function);
+    path.push_back(nodes[0].function);
+    for (size_t i = path.size(); i > 0; i--)
+      fprintf(out, "%s%s", i < path.size() ? ";" : "",
+              functionName(path[i - 1]).c_str());
+    fprintf(out, " %lu\n", (unsigned long)value);
+  }
+}
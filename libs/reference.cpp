@@ -0,0 +1,263 @@
+#include "reference.h"
+
+#include <cstring>
+
+#define REF_PAGE_BITS 12
+#define REF_PAGE_SIZE (1u << REF_PAGE_BITS)
+
+reference_model_t::reference_model_t(bool pstrict) {
+  strict = pstrict;
+  last_page_number = UINT32_MAX;
+  last_page = nullptr;
+  pc = 0;
+  memset(x, 0, sizeof(x));
+  running = true;
+  illegal = false;
+  store_address = 0;
+  store_size = 0;
+}
+
+uint8_t *reference_model_t::page(uint32_t address) {
+  uint32_t number = address >> REF_PAGE_BITS;
+  if (number == last_page_number)
+    return last_page;
+  std::unique_ptr<uint8_t[]> &slot = pages[number];
+  if (!slot) {
+    slot.reset(new uint8_t[REF_PAGE_SIZE]);
+    memset(slot.get(), 0, REF_PAGE_SIZE);
+  }
+  last_page_number = number;
+  last_page = slot.get();
+  return last_page;
+}
+
+uint8_t reference_model_t::load8(uint32_t address) {
+  return page(address)[address & (REF_PAGE_SIZE - 1)];
+}
+
+void reference_model_t::store8(uint32_t address, uint8_t value) {
+  page(address)[address & (REF_PAGE_SIZE - 1)] = value;
+}
+
+uint32_t reference_model_t::load(uint32_t address, int size) {
+  uint32_t value = 0;
+  for (int i = 0; i < size; i++)
+    value |= (uint32_t)load8(address + i) << (8 * i);
+  return value;
+}
+
+void reference_model_t::store(uint32_t address, uint32_t value, int size) {
+  for (int i = 0; i < size; i++)
+    store8(address + i, value >> (8 * i));
+  store_address = address;
+  store_size = size;
+}
+
+void reference_model_t::load(const elf_file_t &elf) {
+  const elf32_ehdr_t &header = elf.getHeader();
+  for (int i = 0; i < header.phnum; i++) {
+    elf32_phdr_t segment = elf.getProgramHeader(i);
+    if (segment.type != ELF_PT_LOAD)
+      continue;
+    const uint8_t *data = elf.at(segment.offset, segment.filesz);
+    for (uint32_t offset = 0; offset < segment.memsz; offset++)
+      store8(segment.vaddr + offset,
+             (data != nullptr && offset < segment.filesz) ? data[offset] : 0);
+  }
+  if (header.phnum == 0) {
+    for (int i = 0; i < header.shnum; i++) {
+      elf32_shdr_t section = elf.getSectionHeader(i);
+      if (!(section.flags & ELF_SHF_ALLOC))
+        continue;
+      const uint8_t *data = section.type == ELF_SHT_NOBITS
+                                ? nullptr
+                                : elf.at(section.offset, section.size);
+      if (section.type != ELF_SHT_NOBITS && data == nullptr)
+        continue;
+      for (uint32_t offset = 0; offset < section.size; offset++)
+        store8(section.addr + offset, data ? data[offset] : 0);
+    }
+  }
+  pc = header.entry;
+  store_size = 0;
+}
+
+static inline int32_t signExtend(uint32_t value, int bits) {
+  return (int32_t)(value << (32 - bits)) >> (32 - bits);
+}
+
+void reference_model_t::step() {
+  uint32_t ins = load(pc, 4);
+  uint32_t opcode = ins & 0x7f;
+  int rd = (ins >> 7) & 31;
+  int rs1 = (ins >> 15) & 31;
+  int rs2 = (ins >> 20) & 31;
+  uint32_t funct3 = (ins >> 12) & 7;
+  uint32_t funct7 = ins >> 25;
+  uint32_t a = x[rs1], b = x[rs2];
+  int32_t imm_i = (int32_t)ins >> 20;
+  int32_t imm_s = ((int32_t)ins >> 25 << 5) | ((ins >> 7) & 31);
+  int32_t imm_b = signExtend(((ins >> 31) << 12) | (((ins >> 7) & 1) << 11) |
+                                 (((ins >> 25) & 63) << 5) |
+                                 (((ins >> 8) & 15) << 1),
+                             13);
+  int32_t imm_j = signExtend(((ins >> 31) << 20) | (((ins >> 12) & 255) << 12) |
+                                 (((ins >> 20) & 1) << 11) |
+                                 (((ins >> 21) & 1023) << 1),
+                             21);
+  uint32_t imm_u = ins & 0xfffff000;
+  if (!strict)
+    imm_u = (imm_u & 0x7fffffff) | ((imm_u & 0x40000000) << 1);
+  uint32_t next = pc + 4;
+  bool known = true;
+  store_size = 0;
+
+  switch (opcode) {
+  case 0x37: // LUI
+    write(rd, imm_u);
+    break;
+  case 0x17: // AUIPC
+    write(rd, pc + imm_u);
+    break;
+  case 0x6f: // JAL
+    write(rd, pc + 4);
+    next = pc + imm_j;
+    break;
+  case 0x67: { // JALR
+    uint32_t target = a + imm_i;
+    if (strict)
+      target &= ~1u;
+    write(rd, pc + 4);
+    next = target;
+    break;
+  }
+  case 0x63: { // Desvios
+    bool taken = false;
+    switch (funct3) {
+    case 0: taken = a == b; break;
+    case 1: taken = a != b; break;
+    case 4: taken = (int32_t)a < (int32_t)b; break;
+    case 5: taken = (int32_t)a >= (int32_t)b; break;
+    case 6: taken = a < b; break;
+    case 7: taken = a >= b; break;
+    default: known = false; break;
+    }
+    if (taken)
+      next = pc + imm_b;
+    break;
+  }
+  case 0x03: { // Loads
+    uint32_t address = a + imm_i;
+    switch (funct3) {
+    case 0: write(rd, signExtend(load(address, 1), 8)); break;
+    case 1: write(rd, signExtend(load(address, 2), 16)); break;
+    case 2: write(rd, load(address, 4)); break;
+    case 4: write(rd, load(address, 1)); break;
+    case 5: write(rd, load(address, 2)); break;
+    default: known = false; break;
+    }
+    break;
+  }
+  case 0x23: { // Stores
+    uint32_t address = a + imm_s;
+    switch (funct3) {
+    case 0: store(address, b, 1); break;
+    case 1: store(address, strict ? b : b & 0xfff, 2); break;
+    case 2: store(address, b, 4); break;
+    default: known = false; break;
+    }
+    break;
+  }
+  case 0x13: { // Operações com imediato
+    uint32_t shamt = rs2;
+    switch (funct3) {
+    case 0: write(rd, a + imm_i); break;
+    case 1: write(rd, a << shamt); break;
+    case 2: write(rd, (int32_t)a < imm_i); break;
+    case 3: write(rd, a < (uint32_t)imm_i); break;
+    case 4: write(rd, a ^ imm_i); break;
+    case 5:
+      if (funct7 & 0x20)
+        write(rd, (shamt == 0 && !strict) ? 0 : (uint32_t)((int32_t)a >> shamt));
+      else
+        write(rd, a >> shamt);
+      break;
+    case 6: write(rd, a | imm_i); break;
+    case 7: write(rd, a & imm_i); break;
+    }
+    break;
+  }
+  case 0x33: { // Operações entre registradores
+    if (funct7 == 1) {
+      // Extensão M. A divisão por 0 e o estouro de DIV seguem a
+      // especificação (o simulador não os trata)
+      int64_t sa = (int32_t)a, sb = (int32_t)b;
+      bool overflow = a == 0x80000000u && b == UINT32_MAX;
+      uint32_t result = 0;
+      switch (funct3) {
+      case 0: result = a * b; break;
+      case 1:
+        result = strict ? (uint32_t)((sa * sb) >> 32)
+                        : (uint32_t)((int32_t)(a * b) < 0 ? -1 : 0);
+        break;
+      case 2:
+        result = strict ? (uint32_t)((sa * (int64_t)(uint64_t)b) >> 32) : 0;
+        break;
+      case 3:
+        result = strict ? (uint32_t)(((uint64_t)a * b) >> 32) : 0;
+        break;
+      case 4:
+        result = b == 0 ? UINT32_MAX
+                 : overflow ? a
+                            : (uint32_t)((int32_t)a / (int32_t)b);
+        break;
+      case 5: result = b == 0 ? UINT32_MAX : a / b; break;
+      case 6:
+        if (!strict)
+          result = b == 0 ? a : a % b;
+        else
+          result = b == 0 ? a
+                   : overflow ? 0
+                              : (uint32_t)((int32_t)a % (int32_t)b);
+        break;
+      case 7: result = b == 0 ? a : a % b; break;
+      }
+      write(rd, result);
+      break;
+    }
+    uint32_t shamt = b & 31;
+    switch (funct3) {
+    case 0: write(rd, (funct7 & 0x20) ? a - b : a + b); break;
+    case 1: write(rd, a << shamt); break;
+    case 2: write(rd, (int32_t)a < (int32_t)b); break;
+    case 3: write(rd, a < b); break;
+    case 4: write(rd, a ^ b); break;
+    case 5:
+      if (funct7 & 0x20)
+        write(rd, (shamt == 0 && !strict) ? 0 : (uint32_t)((int32_t)a >> shamt));
+      else
+        write(rd, a >> shamt);
+      break;
+    case 6: write(rd, a | b); break;
+    case 7: write(rd, a & b); break;
+    }
+    break;
+  }
+  case 0x0f: // FENCE e FENCE.I
+    break;
+  case 0x73: // SCALL, SBREAK e contadores
+    if (funct3 == 0)
+      running = false;
+    break;
+  default:
+    known = false;
+    break;
+  }
+
+  if (!known && strict) {
+    illegal = true;
+    running = false;
+    return;
+  }
+  pc = next;
+}
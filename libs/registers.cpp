@@ -20,7 +20,7 @@ void registers_t::writeReg(unsigned int reg, uint32_t value) {
   }
 }
 
-uint32_t registers_t::readReg(unsigned int reg) { return regs[reg]; }
+uint32_t registers_t::readReg(unsigned int reg) const { return regs[reg]; }
 
 void registers_t::setUW(unsigned int reg, uint32_t time) {
   // O registrado 0 tem que estar sempre disponível
@@ -28,6 +28,6 @@ void registers_t::setUW(unsigned int reg, uint32_t time) {
     under_write[reg] = time;
 }
 
-uint32_t registers_t::checkUW(unsigned int reg) { 
+uint32_t registers_t::checkUW(unsigned int reg) const { 
   return under_write[reg]; 
 }
\ No newline at end of file
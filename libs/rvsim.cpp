@@ -0,0 +1,240 @@
+#include "rvsim.h"
+
+#include <stdio.h>
+
+#include <memory>
+#include <string>
+
+#include "cache.h"
+#include "checkpoint.h"
+#include "elf_loader.h"
+#include "memory.h"
+#include "processor.h"
+
+struct rvsim {
+  rvsim_options_t options;
+  cache_config_t cache_config;
+  std::unique_ptr<memory_t> memory;
+  std::unique_ptr<processor_t> processor;
+  std::string elf_path;
+  std::string error;
+};
+
+// Registra a mensagem de erro da última chamada
+static int fail(rvsim_t *sim, const std::string &message) {
+  sim->error = message;
+  return -1;
+}
+
+int rvsim_api_version(void) { return RVSIM_API_VERSION; }
+
+void rvsim_default_options(rvsim_options_t *options) {
+  options->window = 4;
+  options->gshare_bits = 10;
+  options->btb_entries = 1024;
+  options->functional = 0;
+  options->core = RVSIM_CORE_ANALYTIC;
+  options->cache_config = nullptr;
+}
+
+// Copia a mensagem de erro da criação para o buffer do chamador
+static rvsim_t *createFailed(const std::string &message, char *error,
+                             size_t error_size) {
+  if (error != nullptr && error_size > 0)
+    snprintf(error, error_size, "%s", message.c_str());
+  return nullptr;
+}
+
+rvsim_t *rvsim_create(const rvsim_options_t *options) {
+  return rvsim_create2(options, nullptr, 0);
+}
+
+rvsim_t *rvsim_create2(const rvsim_options_t *options, char *error,
+                       size_t error_size) {
+  std::unique_ptr<rvsim_t> sim(new rvsim_t());
+  if (options != nullptr)
+    sim->options = *options;
+  else
+    rvsim_default_options(&sim->options);
+  sim->cache_config = cache_config_t::defaults();
+  if (sim->options.cache_config != nullptr) {
+    sim->cache_config = cache_config_t();
+    if (!sim->cache_config.load(sim->options.cache_config, sim->error))
+      return createFailed(sim->error, error, error_size);
+  }
+  // O caminho só é válido durante a chamada
+  sim->options.cache_config = nullptr;
+  if (sim->options.window <= 0)
+    return createFailed("a janela precisa ser positiva", error, error_size);
+  if (sim->options.gshare_bits <= 0)
+    return createFailed("os bits do gshare precisam ser positivos", error,
+                        error_size);
+  int btb = sim->options.btb_entries;
+  if (btb <= 0 || (btb & (btb - 1)) != 0)
+    return createFailed("as entradas da BTB precisam ser potência de 2", error,
+                        error_size);
+  // O núcleo fora de ordem é um modelo de temporização
+  int core = sim->options.core;
+  if (core != RVSIM_CORE_ANALYTIC && core != RVSIM_CORE_OOO)
+    return createFailed("núcleo desconhecido", error, error_size);
+  if (core == RVSIM_CORE_OOO && sim->options.functional)
+    return createFailed("o núcleo fora de ordem precisa do modelo "
+                        "temporizado",
+                        error, error_size);
+  return sim.release();
+}
+
+void rvsim_destroy(rvsim_t *sim) { delete sim; }
+
+int rvsim_set_cache_option(rvsim_t *sim, const char *option) {
+  if (sim->memory)
+    return fail(sim, "as caches não podem ser alteradas depois do ELF");
+  std::string error;
+  if (!sim->cache_config.set(option, error))
+    return fail(sim, error);
+  return 0;
+}
+
+int rvsim_load_elf(rvsim_t *sim, const char *path) {
+  std::string error;
+  if (!sim->cache_config.validate(error))
+    return fail(sim, error);
+
+  // O processador referencia a memória, então é destruído antes dela
+  sim->processor.reset();
+  sim->memory.reset(new memory_t(!sim->options.functional,
+                                 CACHE_BACKEND::NATIVE, sim->cache_config));
+  uint32_t entry_point;
+  if (!load_elf(path, *sim->memory, &entry_point, error)) {
+    sim->memory.reset();
+    return fail(sim, error);
+  }
+
+  sim->elf_path = path;
+
+  processor_config_t config;
+  config.window = sim->options.window;
+  config.gshare_bits = sim->options.gshare_bits;
+  config.btb_entries = sim->options.btb_entries;
+  config.functional = sim->options.functional != 0;
+  config.core =
+      sim->options.core == RVSIM_CORE_OOO ? CORE::OOO : CORE::ANALYTIC;
+  sim->processor.reset(
+      new processor_t(sim->memory.get(), entry_point, config));
+  return 0;
+}
+
+uint64_t rvsim_step(rvsim_t *sim, uint64_t instructions) {
+  if (!sim->processor) {
+    fail(sim, "nenhum ELF carregado");
+    return 0;
+  }
+  return sim->processor->run(instructions);
+}
+
+uint64_t rvsim_step_cycles(rvsim_t *sim, uint64_t cycles) {
+  if (!sim->processor) {
+    fail(sim, "nenhum ELF carregado");
+    return 0;
+  }
+  return sim->processor->runCycles(cycles);
+}
+
+uint64_t rvsim_run(rvsim_t *sim) { return rvsim_step(sim, UINT64_MAX); }
+
+int rvsim_save_checkpoint(rvsim_t *sim, const char *path) {
+  if (!sim->processor)
+    return fail(sim, "nenhum ELF carregado");
+  if (sim->options.core == RVSIM_CORE_OOO)
+    return fail(sim, "o núcleo fora de ordem não grava checkpoints");
+  std::string error;
+  if (!saveCheckpoint(path, sim->elf_path.c_str(), *sim->processor,
+                      *sim->memory, !sim->options.functional, nullptr, error))
+    return fail(sim, error);
+  return 0;
+}
+
+int rvsim_restore_checkpoint(rvsim_t *sim, const char *path) {
+  if (!sim->processor)
+    return fail(sim, "nenhum ELF carregado");
+  if (sim->processor->getInstret() != 0)
+    return fail(sim, "o checkpoint só pode ser restaurado logo depois de "
+                     "rvsim_load_elf");
+  std::string error;
+  if (!restoreCheckpoint(path, sim->elf_path.c_str(), *sim->processor,
+                         *sim->memory, nullptr, error))
+    return fail(sim, error);
+  return 0;
+}
+
+int rvsim_running(const rvsim_t *sim) {
+  return sim->processor && sim->processor->isRunning();
+}
+
+uint32_t rvsim_get_pc(const rvsim_t *sim) {
+  return sim->processor ? sim->processor->getPC() : 0;
+}
+
+uint32_t rvsim_read_reg(const rvsim_t *sim, int reg) {
+  if (!sim->processor || reg < 0 || reg > 31)
+    return 0;
+  return sim->processor->readRegister(reg);
+}
+
+int rvsim_read_mem(rvsim_t *sim, uint32_t address, void *buffer,
+                   uint32_t size) {
+  if (!sim->memory)
+    return fail(sim, "nenhum ELF carregado");
+  // Acessos pela API não passam pelas caches
+  sim->memory->readBlock(address, static_cast<uint8_t *>(buffer), size,
+                         ACCESS_TYPE::LOAD);
+  return 0;
+}
+
+int rvsim_write_mem(rvsim_t *sim, uint32_t address, const void *buffer,
+                    uint32_t size) {
+  if (!sim->memory)
+    return fail(sim, "nenhum ELF carregado");
+  sim->memory->writeBlock(address, static_cast<const uint8_t *>(buffer), size,
+                          ACCESS_TYPE::LOAD);
+  // Instruções já decodificadas nas páginas escritas são descartadas
+  if (sim->processor)
+    sim->processor->syncDecodeCache();
+  return 0;
+}
+
+void rvsim_get_stats(const rvsim_t *sim, rvsim_stats_t *stats) {
+  *stats = rvsim_stats_t();
+  if (!sim->processor)
+    return;
+  const sim_stats_t &sim_stats = sim->processor->getStats();
+  stats->instructions = sim_stats.instructions;
+  stats->cycles = sim_stats.cycles;
+  stats->gshare_hits = sim_stats.gshare_hits;
+  stats->gshare_errors = sim_stats.gshare_errors;
+  if (sim->options.functional)
+    return;
+  stats->cache_levels = sim->memory->getCacheLevels();
+  for (int level = 0; level < stats->cache_levels; level++)
+    stats->cache_misses[level] = sim->memory->getCacheMisses(level);
+}
+
+int rvsim_write_stats(rvsim_t *sim, const char *path, int descriptions) {
+  if (!sim->processor)
+    return fail(sim, "nenhum ELF carregado");
+  FILE *out = fopen(path, "a");
+  if (out == nullptr)
+    return fail(sim, std::string("não foi possível abrir ") + path);
+  sim->processor->getRegistry().writeJSON(out, descriptions != 0);
+  fclose(out);
+  return 0;
+}
+
+const char *rvsim_cache_name(const rvsim_t *sim, int level) {
+  if (!sim->memory || sim->options.functional || level < 0 ||
+      level >= sim->memory->getCacheLevels())
+    return nullptr;
+  return sim->memory->getCacheName(level).c_str();
+}
+
+const char *rvsim_last_error(const rvsim_t *sim) { return sim->error.c_str(); }
@@ -0,0 +1,431 @@
+#include "simpoint.h"
+
+#include <cmath>
+#include <cstdio>
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <limits>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "checkpoint.h"
+
+// Inicializações diferentes do k-means para cada número de grupos (fica a de
+// menor erro quadrático)
+#define SIMPOINT_KMEANS_SEEDS      5
+#define SIMPOINT_KMEANS_ITERATIONS 100
+// Escolhe o menor k cujo BIC alcança essa fração da faixa de BICs
+#define SIMPOINT_BIC_THRESHOLD     0.9
+// Últimas instruções do aquecimento executadas com temporização, para que o
+// intervalo não comece com o pipeline vazio
+#define SIMPOINT_PIPELINE_WARMUP   100
+
+// Um intervalo da execução e seu BBV esparso (bloco, instruções executadas)
+struct interval_t {
+  uint64_t start = 0;
+  uint64_t length = 0;
+  std::vector<std::pair<uint32_t, uint32_t>> blocks;
+  std::vector<double> point;
+  int cluster = 0;
+};
+
+// Intervalo simulado com temporização: o representante de um grupo ou um dos
+// sorteados para estimar a variação do CPI dentro do grupo
+struct simpoint_sample_t {
+  size_t interval = 0;
+  int cluster = 0;
+  bool representative = false;
+  std::vector<uint8_t> checkpoint;
+  uint64_t warmup = 0;
+  double cpi = 0;
+  std::string error;
+
+  simpoint_sample_t(size_t pinterval, int pcluster, bool prepresentative)
+      : interval(pinterval), cluster(pcluster),
+        representative(prepresentative) {}
+};
+
+struct kmeans_result_t {
+  std::vector<int> assignment;
+  std::vector<std::vector<double>> centroids;
+  double sse = std::numeric_limits<double>::max();
+};
+
+// xorshift64, determinístico para que a escolha dos intervalos seja
+// reproduzível
+static uint64_t nextRandom(uint64_t &state) {
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return state;
+}
+
+// Coeficiente da projeção aleatória do bloco na dimensão, em [-1, 1)
+static double projection(uint32_t block, unsigned dimension) {
+  uint64_t value = ((uint64_t)block << 8 | dimension) + 0x9E3779B97F4A7C15ull;
+  value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+  value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+  value ^= value >> 31;
+  return (value >> 11) * (2.0 / 9007199254740992.0) - 1.0;
+}
+
+static double distance2(const std::vector<double> &a,
+                        const std::vector<double> &b) {
+  double sum = 0;
+  for (size_t d = 0; d < a.size(); d++)
+    sum += (a[d] - b[d]) * (a[d] - b[d]);
+  return sum;
+}
+
+// Execução funcional dividida em intervalos. Um bloco termina quando o
+// próximo PC não é o sequencial (salto tomado) ou no fim do intervalo.
+static std::vector<interval_t> collectBBVs(const memory_t &image,
+                                           uint32_t entry_point,
+                                           uint64_t interval_size) {
+  memory_t memory(false);
+  memory.shareImage(image);
+  processor_config_t config;
+  config.functional = true;
+  processor_t processor(&memory, entry_point, config);
+
+  std::vector<interval_t> intervals;
+  std::unordered_map<uint32_t, uint32_t> block_ids;
+  std::unordered_map<uint32_t, uint32_t> counts;
+  interval_t current;
+  uint32_t block_pc = processor.getPC();
+  uint32_t block_length = 0;
+  while (processor.isRunning()) {
+    uint32_t pc = processor.getPC();
+    processor.run(1);
+    block_length++;
+    current.length++;
+    bool interval_end =
+        current.length == interval_size || !processor.isRunning();
+    if (processor.getPC() != pc + 4 || interval_end) {
+      auto id = block_ids.emplace(block_pc, block_ids.size()).first->second;
+      counts[id] += block_length;
+      block_length = 0;
+      block_pc = processor.getPC();
+    }
+    if (interval_end) {
+      current.blocks.assign(counts.begin(), counts.end());
+      std::sort(current.blocks.begin(), current.blocks.end());
+      intervals.push_back(current);
+      counts.clear();
+      current = interval_t();
+      current.start = processor.getInstret();
+    }
+  }
+  return intervals;
+}
+
+static kmeans_result_t kmeans(const std::vector<interval_t> &intervals,
+                              unsigned k, uint64_t seed) {
+  size_t n = intervals.size();
+  kmeans_result_t result;
+  // k-means++: cada centro novo é sorteado com probabilidade proporcional à
+  // distância ao centro mais próximo
+  std::vector<double> nearest(n, std::numeric_limits<double>::max());
+  result.centroids.push_back(intervals[nextRandom(seed) % n].point);
+  while (result.centroids.size() < k) {
+    double total = 0;
+    for (size_t i = 0; i < n; i++) {
+      nearest[i] = std::min(
+          nearest[i], distance2(intervals[i].point, result.centroids.back()));
+      total += nearest[i];
+    }
+    double target = (nextRandom(seed) >> 11) * (1.0 / 9007199254740992.0) * total;
+    size_t chosen = 0;
+    for (; chosen + 1 < n && target >= nearest[chosen]; chosen++)
+      target -= nearest[chosen];
+    result.centroids.push_back(intervals[chosen].point);
+  }
+
+  result.assignment.assign(n, -1);
+  size_t dimensions = intervals[0].point.size();
+  for (int iteration = 0; iteration < SIMPOINT_KMEANS_ITERATIONS; iteration++) {
+    bool changed = false;
+    result.sse = 0;
+    for (size_t i = 0; i < n; i++) {
+      int best = 0;
+      double best_distance = std::numeric_limits<double>::max();
+      for (unsigned c = 0; c < k; c++) {
+        double distance = distance2(intervals[i].point, result.centroids[c]);
+        if (distance < best_distance) {
+          best_distance = distance;
+          best = c;
+        }
+      }
+      changed |= result.assignment[i] != best;
+      result.assignment[i] = best;
+      result.sse += best_distance;
+    }
+    if (!changed)
+      break;
+    std::vector<std::vector<double>> sums(k,
+                                          std::vector<double>(dimensions, 0));
+    std::vector<size_t> sizes(k, 0);
+    for (size_t i = 0; i < n; i++) {
+      sizes[result.assignment[i]]++;
+      for (size_t d = 0; d < dimensions; d++)
+        sums[result.assignment[i]][d] += intervals[i].point[d];
+    }
+    // Grupos que ficaram vazios mantêm o centro anterior
+    for (unsigned c = 0; c < k; c++)
+      if (sizes[c] > 0)
+        for (size_t d = 0; d < dimensions; d++)
+          result.centroids[c][d] = sums[c][d] / sizes[c];
+  }
+  return result;
+}
+
+// BIC de um agrupamento supondo gaussianas esféricas de mesma variância
+// (Pelleg e Moore, como no SimPoint)
+static double bic(const kmeans_result_t &result, unsigned k, size_t n,
+                  size_t dimensions) {
+  double variance = (n > k) ? result.sse / (double)(n - k) : 0;
+  variance = std::max(variance, 1e-12);
+  std::vector<size_t> sizes(k, 0);
+  for (int cluster : result.assignment)
+    sizes[cluster]++;
+  double likelihood = 0;
+  for (size_t size : sizes) {
+    if (size == 0)
+      continue;
+    double r = size;
+    likelihood += r * std::log(r) - r * std::log((double)n) -
+                  r / 2 * std::log(2 * M_PI) -
+                  r * dimensions / 2 * std::log(variance) - (r - k) / 2;
+  }
+  double parameters = (k - 1) + dimensions * k + 1;
+  return likelihood - parameters / 2 * std::log((double)n);
+}
+
+int runSimPoint(const char *elf_path, const memory_t &image,
+                uint32_t entry_point, const processor_config_t &config,
+                const cache_config_t &cache_config,
+                const simpoint_options_t &options) {
+  // As simulações detalhadas não imprimem logs nem relatórios
+  processor_config_t timed;
+  timed.window = config.window;
+  timed.gshare_bits = config.gshare_bits;
+  timed.btb_entries = config.btb_entries;
+
+  uint64_t warmup = (options.warmup == SIMPOINT_WARMUP_INTERVAL)
+                        ? options.interval
+                        : options.warmup;
+
+  // 1. BBVs de cada intervalo, projetados em poucas dimensões e normalizados
+  // pelo tamanho do intervalo
+  std::vector<interval_t> intervals =
+      collectBBVs(image, entry_point, options.interval);
+  uint64_t total_instructions = 0;
+  for (interval_t &interval : intervals) {
+    total_instructions += interval.length;
+    interval.point.assign(options.dimensions, 0);
+    for (const auto &block : interval.blocks)
+      for (unsigned d = 0; d < options.dimensions; d++)
+        interval.point[d] += projection(block.first, d) * block.second /
+                             (double)interval.length;
+  }
+  size_t n = intervals.size();
+
+  // 2. k-means para cada k e escolha pelo BIC
+  unsigned max_clusters = std::min<size_t>(options.max_clusters, n);
+  std::vector<kmeans_result_t> results;
+  std::vector<double> scores;
+  for (unsigned k = 1; k <= max_clusters; k++) {
+    kmeans_result_t best;
+    for (uint64_t seed = 1; seed <= SIMPOINT_KMEANS_SEEDS; seed++) {
+      kmeans_result_t result = kmeans(intervals, k, seed * 0x2545F4914F6CDD1Dull);
+      if (result.sse < best.sse)
+        best = result;
+    }
+    scores.push_back(bic(best, k, n, options.dimensions));
+    results.push_back(best);
+  }
+  double min_score = *std::min_element(scores.begin(), scores.end());
+  double max_score = *std::max_element(scores.begin(), scores.end());
+  unsigned clusters = 1;
+  while (clusters < max_clusters &&
+         scores[clusters - 1] <
+             min_score + SIMPOINT_BIC_THRESHOLD * (max_score - min_score))
+    clusters++;
+  const kmeans_result_t &clustering = results[clusters - 1];
+
+  // 3. Representante de cada grupo (o intervalo mais próximo do centro) e,
+  // para o erro padrão, outros intervalos sorteados do grupo
+  std::vector<uint64_t> weights(clusters, 0);
+  std::vector<std::vector<size_t>> members(clusters);
+  for (size_t i = 0; i < n; i++) {
+    intervals[i].cluster = clustering.assignment[i];
+    weights[intervals[i].cluster] += intervals[i].length;
+    members[intervals[i].cluster].push_back(i);
+  }
+  std::vector<simpoint_sample_t> samples;
+  uint64_t seed = 0x9E3779B97F4A7C15ull;
+  for (unsigned c = 0; c < clusters; c++) {
+    if (members[c].empty())
+      continue;
+    size_t representative = members[c][0];
+    for (size_t i : members[c])
+      if (distance2(intervals[i].point, clustering.centroids[c]) <
+          distance2(intervals[representative].point, clustering.centroids[c]))
+        representative = i;
+    samples.emplace_back(representative, (int)c, true);
+    // Sorteio sem reposição entre os demais membros (Fisher-Yates parcial)
+    std::vector<size_t> others;
+    for (size_t i : members[c])
+      if (i != representative)
+        others.push_back(i);
+    size_t extra = std::min<size_t>(options.cluster_samples - 1, others.size());
+    for (size_t k = 0; k < extra; k++) {
+      size_t pick = k + nextRandom(seed) % (others.size() - k);
+      std::swap(others[k], others[pick]);
+      samples.emplace_back(others[k], (int)c, false);
+    }
+  }
+
+  // 4. Checkpoints (só o estado arquitetural) no início do aquecimento de
+  // cada amostra, em uma segunda execução funcional
+  std::sort(samples.begin(), samples.end(),
+            [&](const simpoint_sample_t &a, const simpoint_sample_t &b) {
+              return intervals[a.interval].start < intervals[b.interval].start;
+            });
+  {
+    memory_t memory(false);
+    memory.shareImage(image);
+    processor_config_t functional;
+    functional.functional = true;
+    processor_t processor(&memory, entry_point, functional);
+    for (simpoint_sample_t &sample : samples) {
+      uint64_t start = intervals[sample.interval].start;
+      uint64_t target = (start > warmup) ? start - warmup : 0;
+      if (target > processor.getInstret())
+        processor.run(target - processor.getInstret());
+      sample.warmup = start - processor.getInstret();
+      std::string error;
+      if (!encodeCheckpoint(sample.checkpoint, elf_path, processor, memory,
+                            false, nullptr, error)) {
+        std::cout << "SimPoint: " << error << std::endl;
+        return 1;
+      }
+    }
+  }
+
+  // 5. Simulação de cada amostra: aquecimento funcional das caches e do
+  // gshare, o fim do aquecimento e o intervalo com temporização
+  std::atomic<size_t> next_sample(0);
+  auto worker = [&]() {
+    for (;;) {
+      size_t index = next_sample++;
+      if (index >= samples.size())
+        return;
+      simpoint_sample_t &sample = samples[index];
+      memory_t memory(true, CACHE_BACKEND::NATIVE, cache_config);
+      memory.shareImage(image);
+      processor_t processor(&memory, entry_point, timed);
+      if (!decodeCheckpoint(sample.checkpoint, elf_path, processor, memory,
+                            nullptr, sample.error))
+        continue;
+      uint64_t pipeline =
+          std::min<uint64_t>(sample.warmup, SIMPOINT_PIPELINE_WARMUP);
+      processor.warm(sample.warmup - pipeline);
+      processor.run(pipeline);
+      sim_stats_t before = processor.getStats();
+      processor.run(intervals[sample.interval].length);
+      const sim_stats_t &after = processor.getStats();
+      sample.cpi = (after.cycles - before.cycles) /
+                   (double)(after.instructions - before.instructions);
+    }
+  };
+  unsigned jobs = std::max(1u, std::min<unsigned>(options.jobs, samples.size()));
+  std::vector<std::thread> threads;
+  for (unsigned i = 1; i < jobs; i++)
+    threads.emplace_back(worker);
+  worker();
+  for (std::thread &thread : threads)
+    thread.join();
+
+  // 6. CPI de cada grupo (média das amostras), ponderado pelas instruções do
+  // grupo. O erro padrão é o da amostragem estratificada: a variância das
+  // amostras de cada grupo, com a correção para população finita (um grupo
+  // simulado inteiro não contribui).
+  uint64_t detailed = 0, warmed = 0;
+  std::vector<std::vector<double>> cluster_cpi(clusters);
+  for (const simpoint_sample_t &sample : samples) {
+    if (!sample.error.empty()) {
+      std::cout << "SimPoint: " << sample.error << std::endl;
+      return 1;
+    }
+    uint64_t pipeline =
+        std::min<uint64_t>(sample.warmup, SIMPOINT_PIPELINE_WARMUP);
+    detailed += pipeline + intervals[sample.interval].length;
+    warmed += sample.warmup - pipeline;
+    cluster_cpi[sample.cluster].push_back(sample.cpi);
+  }
+  double estimate = 0, variance = 0;
+  bool has_error = true;
+  for (unsigned c = 0; c < clusters; c++) {
+    const std::vector<double> &cpis = cluster_cpi[c];
+    if (cpis.empty())
+      continue;
+    double weight = weights[c] / (double)total_instructions;
+    double mean = 0;
+    for (double cpi : cpis)
+      mean += cpi / cpis.size();
+    estimate += weight * mean;
+    size_t m = cpis.size(), population = members[c].size();
+    if (m == population)
+      continue;
+    if (m < 2) {
+      has_error = false;
+      continue;
+    }
+    double spread = 0;
+    for (double cpi : cpis)
+      spread += (cpi - mean) * (cpi - mean) / (m - 1);
+    variance += weight * weight * spread / m * (1.0 - m / (double)population);
+  }
+
+  std::cout << "\nSIMPOINT:\n";
+  std::cout << "  Intervalos: " << n << " de " << options.interval
+            << " instruções (" << total_instructions << " instruções)\n";
+  std::cout << "  Grupos: " << clusters << " (BIC, até " << max_clusters
+            << ")\n";
+  std::cout << "  Grupo  Intervalo      Início    Peso     CPI\n";
+  for (const simpoint_sample_t &sample : samples) {
+    if (!sample.representative)
+      continue;
+    char line[96];
+    snprintf(line, sizeof(line), "  %5d  %9zu  %10lu  %6.4f  %6.4f\n",
+             sample.cluster, sample.interval,
+             (unsigned long)intervals[sample.interval].start,
+             weights[sample.cluster] / (double)total_instructions, sample.cpi);
+    std::cout << line;
+  }
+  std::cout << "  CPI estimado: " << estimate;
+  if (has_error)
+    std::cout << " +- " << 1.96 * std::sqrt(variance)
+              << " (1,96 erros padrão, pela variação dentro dos grupos)";
+  std::cout << "\n";
+  std::cout << "  Instruções simuladas com temporização: " << detailed << " ("
+            << 100.0 * detailed / total_instructions << "% do programa)\n";
+  std::cout << "  Instruções de aquecimento (funcional): " << warmed
+            << std::endl;
+
+  if (options.verify) {
+    memory_t memory(true, CACHE_BACKEND::NATIVE, cache_config);
+    memory.shareImage(image);
+    processor_t processor(&memory, entry_point, timed);
+    processor.executeProgram();
+    const sim_stats_t &stats = processor.getStats();
+    double cpi = stats.cycles / (stats.instructions * 1.0);
+    std::cout << "  CPI da execução completa: " << cpi << " (erro: "
+              << 100.0 * (estimate - cpi) / cpi << "%)" << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,87 @@
+#include "stats.h"
+
+#include <cstring>
+
+void stats_histogram_t::reset() {
+  memset(buckets, 0, sizeof(buckets));
+  count = 0;
+  sum = 0;
+  max = 0;
+}
+
+void stats_registry_t::addCounter(const std::string &name,
+                                  const std::string &description,
+                                  const uint64_t *counter) {
+  entries.push_back({name, description, counter, nullptr, nullptr});
+}
+
+void stats_registry_t::addValue(const std::string &name,
+                                const std::string &description,
+                                std::function<double()> value) {
+  entries.push_back({name, description, nullptr, value, nullptr});
+}
+
+void stats_registry_t::addHistogram(const std::string &name,
+                                    const std::string &description,
+                                    const stats_histogram_t *histogram) {
+  entries.push_back({name, description, nullptr, nullptr, histogram});
+}
+
+// Os nomes e descrições são escritos pelo simulador, só as aspas e barras
+// precisam de escape
+static void writeString(FILE *out, const std::string &text) {
+  fputc('"', out);
+  for (char c : text) {
+    if (c == '"' || c == '\\')
+      fputc('\\', out);
+    fputc(c, out);
+  }
+  fputc('"', out);
+}
+
+void stats_registry_t::writeJSON(FILE *out, bool descriptions) const {
+  fputc('{', out);
+  for (size_t i = 0; i < entries.size(); i++) {
+    const entry_t &entry = entries[i];
+    if (i > 0)
+      fputs(", ", out);
+    writeString(out, entry.name);
+    fputs(": ", out);
+    if (entry.counter != nullptr) {
+      fprintf(out, "%lu", (unsigned long)*entry.counter);
+    } else if (entry.value) {
+      // Contadores lidos por addValue saem inteiros, sem perder dígitos
+      double value = entry.value();
+      if (value == (double)(int64_t)value)
+        fprintf(out, "%ld", (long)value);
+      else
+        fprintf(out, "%.6g", value);
+    } else {
+      const stats_histogram_t &histogram = *entry.histogram;
+      fprintf(out, "{\"count\": %lu, \"sum\": %lu, \"max\": %lu, \"buckets\": [",
+              (unsigned long)histogram.getCount(),
+              (unsigned long)histogram.getSum(),
+              (unsigned long)histogram.getMax());
+      // Buckets vazios no fim são omitidos
+      int last = STATS_HISTOGRAM_BUCKETS - 1;
+      while (last > 0 && histogram.getBucket(last) == 0)
+        last--;
+      for (int bucket = 0; bucket <= last; bucket++)
+        fprintf(out, "%s%lu", bucket > 0 ? ", " : "",
+                (unsigned long)histogram.getBucket(bucket));
+      fputs("]}", out);
+    }
+  }
+  if (descriptions) {
+    fputs(", \"descriptions\": {", out);
+    for (size_t i = 0; i < entries.size(); i++) {
+      if (i > 0)
+        fputs(", ", out);
+      writeString(out, entries[i].name);
+      fputs(": ", out);
+      writeString(out, entries[i].description);
+    }
+    fputc('}', out);
+  }
+  fputs("}\n", out);
+}
@@ -0,0 +1,368 @@
+#include "sweep.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include "processor.h"
+#include "utils.h"
+
+static std::vector<std::string> splitValues(const std::string &text) {
+  std::vector<std::string> values;
+  size_t begin = 0;
+  while (begin <= text.size()) {
+    size_t comma = text.find(',', begin);
+    if (comma == std::string::npos)
+      comma = text.size();
+    std::string value = trim(text.substr(begin, comma - begin));
+    if (!value.empty())
+      values.push_back(value);
+    begin = comma + 1;
+  }
+  return values;
+}
+
+static bool parseNumbers(const std::vector<std::string> &values,
+                         std::vector<uint32_t> &numbers) {
+  numbers.clear();
+  for (const std::string &value : values) {
+    char *end;
+    unsigned long number = strtoul(value.c_str(), &end, 10);
+    if (*end != '\0' || end == value.c_str())
+      return false;
+    numbers.push_back(number);
+  }
+  return true;
+}
+
+bool sweep_grid_t::load(const std::string &path, std::string &error) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    error = "não foi possível abrir " + path;
+    return false;
+  }
+  std::string line;
+  int line_number = 0;
+  while (std::getline(file, line)) {
+    line_number++;
+    size_t comment = line.find('#');
+    if (comment != std::string::npos)
+      line = line.substr(0, comment);
+    line = trim(line);
+    if (line.empty())
+      continue;
+    std::string where = path + ":" + std::to_string(line_number) + ": ";
+    size_t equal = line.find('=');
+    if (equal == std::string::npos) {
+      error = where + "linha inválida";
+      return false;
+    }
+    std::string key = trim(line.substr(0, equal));
+    std::vector<std::string> values = splitValues(line.substr(equal + 1));
+    if (values.empty()) {
+      error = where + "dimensão sem valores";
+      return false;
+    }
+    bool ok = true;
+    if (key == "window")
+      ok = parseNumbers(values, windows);
+    else if (key == "gshare")
+      ok = parseNumbers(values, gshare_bits);
+    else if (key == "btb")
+      ok = parseNumbers(values, btb_sizes);
+    else if (key.compare(0, 6, "cache.") == 0)
+      cache_options.push_back(std::make_pair(key.substr(6), values));
+    else {
+      error = where + "dimensão desconhecida: " + key;
+      return false;
+    }
+    if (!ok) {
+      error = where + "valores inválidos para " + key;
+      return false;
+    }
+  }
+  return true;
+}
+
+size_t sweep_grid_t::getPoints() const {
+  size_t points = windows.size() * gshare_bits.size() * btb_sizes.size();
+  for (const auto &option : cache_options)
+    points *= option.second.size();
+  return points;
+}
+
+// Uma configuração da grade e o seu resultado
+struct sweep_point_t {
+  uint32_t window, gshare_bits, btb_size;
+  std::vector<std::string> cache_values;
+  cache_config_t cache_config;
+  bool done = false;
+  sim_stats_t stats;
+  std::vector<int> misses;
+};
+
+// Escreve as linhas na ordem da grade, à medida que ficam prontas
+class sweep_writer_t {
+private:
+  FILE *out;
+  bool json;
+  size_t next, written;
+  std::vector<std::string> levels;
+
+  void writeRow(const sweep_grid_t &grid, const sweep_point_t &point) {
+    double cpi = point.stats.cycles / (point.stats.instructions * 1.0);
+    if (json) {
+      fprintf(out, "%s  {\"window\": %u, \"gshare\": %u, \"btb\": %u",
+              written > 0 ? ",\n" : "", point.window, point.gshare_bits,
+              point.btb_size);
+      for (size_t i = 0; i < grid.cache_options.size(); i++)
+        fprintf(out, ", \"%s\": \"%s\"", grid.cache_options[i].first.c_str(),
+                point.cache_values[i].c_str());
+      fprintf(out,
+              ", \"instructions\": %lu, \"cycles\": %lu, \"cpi\": %.6f, "
+              "\"gshare_hits\": %d, \"gshare_errors\": %d, \"misses\": {",
+              (unsigned long)point.stats.instructions,
+              (unsigned long)point.stats.cycles, cpi, point.stats.gshare_hits,
+              point.stats.gshare_errors);
+      bool first = true;
+      for (size_t level = 0; level < point.cache_config.levels.size(); level++) {
+        fprintf(out, "%s\"%s\": %d", first ? "" : ", ",
+                point.cache_config.levels[level].name.c_str(),
+                point.misses[level]);
+        first = false;
+      }
+      fprintf(out, "}}");
+    } else {
+      fprintf(out, "%u,%u,%u", point.window, point.gshare_bits, point.btb_size);
+      for (const std::string &value : point.cache_values)
+        fprintf(out, ",%s", value.c_str());
+      fprintf(out, ",%lu,%lu,%.6f,%d,%d", (unsigned long)point.stats.instructions,
+              (unsigned long)point.stats.cycles, cpi, point.stats.gshare_hits,
+              point.stats.gshare_errors);
+      // Níveis ausentes nesta configuração ficam vazios
+      for (const std::string &name : levels) {
+        int level = point.cache_config.find(name);
+        if (level >= 0)
+          fprintf(out, ",%d", point.misses[level]);
+        else
+          fprintf(out, ",");
+      }
+      fprintf(out, "\n");
+    }
+    written++;
+  }
+
+public:
+  sweep_writer_t(FILE *pout, bool pjson, const sweep_grid_t &grid,
+                 const std::vector<sweep_point_t> &points) {
+    out = pout;
+    json = pjson;
+    next = 0;
+    written = 0;
+    if (json) {
+      fprintf(out, "[\n");
+      return;
+    }
+    // As colunas de misses cobrem os níveis de todas as configurações
+    for (const sweep_point_t &point : points)
+      for (const cache_level_config_t &level : point.cache_config.levels)
+        if (std::find(levels.begin(), levels.end(), level.name) == levels.end())
+          levels.push_back(level.name);
+    fprintf(out, "window,gshare,btb");
+    for (const auto &option : grid.cache_options)
+      fprintf(out, ",%s", option.first.c_str());
+    fprintf(out, ",instructions,cycles,cpi,gshare_hits,gshare_errors");
+    for (const std::string &name : levels)
+      fprintf(out, ",%s_misses", name.c_str());
+    fprintf(out, "\n");
+  }
+
+  void flush(const sweep_grid_t &grid, std::vector<sweep_point_t> &points) {
+    while (next < points.size() && points[next].done)
+      writeRow(grid, points[next++]);
+    fflush(out);
+  }
+
+  void finish() {
+    if (json)
+      fprintf(out, "\n]\n");
+    fflush(out);
+  }
+};
+
+int runSweep(const sweep_grid_t &grid, const cache_config_t &base_config,
+             const memory_t &image, uint32_t entry_point,
+             const sweep_options_t &options) {
+  // Monta e valida todas as configurações antes de simular
+  std::vector<sweep_point_t> points(grid.getPoints());
+  for (size_t index = 0; index < points.size(); index++) {
+    sweep_point_t &point = points[index];
+    // A última dimensão é a que varia mais rápido
+    size_t rest = index;
+    point.cache_values.resize(grid.cache_options.size());
+    for (size_t i = grid.cache_options.size(); i-- > 0;) {
+      const std::vector<std::string> &values = grid.cache_options[i].second;
+      point.cache_values[i] = values[rest % values.size()];
+      rest /= values.size();
+    }
+    point.btb_size = grid.btb_sizes[rest % grid.btb_sizes.size()];
+    rest /= grid.btb_sizes.size();
+    point.gshare_bits = grid.gshare_bits[rest % grid.gshare_bits.size()];
+    rest /= grid.gshare_bits.size();
+    point.window = grid.windows[rest % grid.windows.size()];
+
+    std::string error;
+    point.cache_config = base_config;
+    for (size_t i = 0; i < grid.cache_options.size(); i++) {
+      if (!point.cache_config.set(grid.cache_options[i].first + "=" +
+                                      point.cache_values[i],
+                                  error))
+        break;
+    }
+    if (error.empty())
+      point.cache_config.validate(error);
+    if (error.empty() &&
+        (point.btb_size == 0 || (point.btb_size & (point.btb_size - 1)))) {
+      error = "btb deve ser potência de 2";
+    }
+    if (!error.empty()) {
+      std::cout << "Configuração " << index << " da varredura: " << error
+                << std::endl;
+      return 1;
+    }
+  }
+
+  FILE *out = stdout;
+  if (!options.output.empty()) {
+    out = fopen(options.output.c_str(), "w");
+    if (out == nullptr) {
+      std::cout << "Não foi possível criar " << options.output << std::endl;
+      return 1;
+    }
+  }
+  bool json = options.output.size() >= 5 &&
+              options.output.compare(options.output.size() - 5, 5, ".json") ==
+                  0;
+  sweep_writer_t writer(out, json, grid, points);
+
+  // Cada thread pega a próxima configuração ainda não simulada. As memórias
+  // compartilham as páginas da imagem e copiam só as que forem escritas.
+  std::atomic<size_t> next_point(0);
+  std::mutex writer_lock;
+  auto worker = [&]() {
+    for (;;) {
+      size_t index = next_point++;
+      if (index >= points.size())
+        return;
+      sweep_point_t &point = points[index];
+      memory_t memory(true, CACHE_BACKEND::NATIVE, point.cache_config);
+      memory.shareImage(image);
+      // Os relatórios e logs de cada simulação não são impressos
+      processor_config_t config;
+      config.window = point.window;
+      config.gshare_bits = point.gshare_bits;
+      config.btb_entries = point.btb_size;
+      config.core = options.core;
+      config.ooo = options.ooo;
+      processor_t processor(&memory, entry_point, config);
+      processor.executeProgram();
+
+      std::lock_guard<std::mutex> guard(writer_lock);
+      point.stats = processor.getStats();
+      for (int level = 0; level < memory.getCacheLevels(); level++)
+        point.misses.push_back(memory.getCacheMisses(level));
+      point.done = true;
+      writer.flush(grid, points);
+    }
+  };
+
+  unsigned jobs = options.jobs > 0 ? options.jobs : 1;
+  if (jobs > points.size())
+    jobs = points.size();
+  std::vector<std::thread> threads;
+  for (unsigned i = 1; i < jobs; i++)
+    threads.emplace_back(worker);
+  worker();
+  for (std::thread &thread : threads)
+    thread.join();
+
+  writer.finish();
+  if (out != stdout)
+    fclose(out);
+  return 0;
+}
+
+// Resultado completo de uma instância na verificação de concorrência
+struct check_result_t {
+  sim_stats_t stats;
+  std::vector<int> misses;
+  uint32_t pc;
+  uint32_t registers[32];
+
+  bool operator==(const check_result_t &other) const {
+    return stats.instructions == other.stats.instructions &&
+           stats.cycles == other.stats.cycles &&
+           stats.gshare_hits == other.stats.gshare_hits &&
+           stats.gshare_errors == other.stats.gshare_errors &&
+           misses == other.misses && pc == other.pc &&
+           std::equal(registers, registers + 32, other.registers);
+  }
+};
+
+static check_result_t runInstance(const cache_config_t &cache_config,
+                                  const memory_t &image, uint32_t entry_point,
+                                  unsigned instance) {
+  // Cada instância tem uma configuração diferente
+  processor_config_t config;
+  config.window = 1 + instance % 8;
+  config.gshare_bits = 6 + instance % 7;
+  config.btb_entries = (instance % 2) ? 256 : 1024;
+  memory_t memory(true, CACHE_BACKEND::NATIVE, cache_config);
+  memory.shareImage(image);
+  processor_t processor(&memory, entry_point, config);
+  processor.executeProgram();
+
+  check_result_t result;
+  result.stats = processor.getStats();
+  for (int level = 0; level < memory.getCacheLevels(); level++)
+    result.misses.push_back(memory.getCacheMisses(level));
+  result.pc = processor.getPC();
+  for (int reg = 0; reg < 32; reg++)
+    result.registers[reg] = processor.readRegister(reg);
+  return result;
+}
+
+int runConcurrencyCheck(const cache_config_t &cache_config,
+                        const memory_t &image, uint32_t entry_point,
+                        unsigned instances) {
+  std::vector<check_result_t> serial(instances), concurrent(instances);
+  for (unsigned i = 0; i < instances; i++)
+    serial[i] = runInstance(cache_config, image, entry_point, i);
+
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i < instances; i++)
+    threads.emplace_back([&, i]() {
+      concurrent[i] = runInstance(cache_config, image, entry_point, i);
+    });
+  for (std::thread &thread : threads)
+    thread.join();
+
+  int divergences = 0;
+  for (unsigned i = 0; i < instances; i++) {
+    if (!(serial[i] == concurrent[i])) {
+      std::cout << "Instância " << i << ": resultado concorrente diverge do "
+                   "serial"
+                << std::endl;
+      divergences++;
+    }
+  }
+  std::cout << "Verificação de concorrência: " << instances << " instâncias, "
+            << divergences << " divergências" << std::endl;
+  return divergences == 0 ? 0 : 1;
+}
@@ -0,0 +1,276 @@
+#include "trace.h"
+
+#include <cstring>
+
+static inline uint64_t zigzag(int64_t value) {
+  return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t value) {
+  return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static void putU32(uint8_t *out, uint32_t value) {
+  for (int i = 0; i < 4; i++)
+    out[i] = value >> (8 * i);
+}
+
+static uint32_t getU32(const uint8_t *in) {
+  return in[0] | (in[1] << 8) | (in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+/***************************************************************************
+Trace writer
+***************************************************************************/
+trace_writer_t::trace_writer_t() {
+  file = nullptr;
+  header_flags = 0;
+  used = 0;
+  records = 0;
+  failed = false;
+  memset(&last, 0, sizeof(last));
+}
+
+trace_writer_t::~trace_writer_t() { close(); }
+
+bool trace_writer_t::open(const char *path, bool compressed, bool timing) {
+  file = fopen(path, "wb");
+  if (file == nullptr)
+    return false;
+  buffer.resize(TRACE_BUFFER_SIZE);
+  used = 0;
+  failed = false;
+  header_flags = (compressed ? TRACE_F_COMPRESSED : 0) |
+                 (timing ? TRACE_F_TIMING : 0);
+
+  uint8_t header[16];
+  memcpy(header, TRACE_MAGIC, 8);
+  putU32(header + 8, TRACE_VERSION);
+  putU32(header + 12, header_flags);
+  put(header, sizeof(header));
+  return true;
+}
+
+void trace_writer_t::flush() {
+  if (used > 0 && fwrite(buffer.data(), 1, used, file) != used)
+    failed = true;
+  used = 0;
+}
+
+void trace_writer_t::put(const uint8_t *data, size_t size) {
+  if (used + size > buffer.size())
+    flush();
+  memcpy(&buffer[used], data, size);
+  used += size;
+}
+
+void trace_writer_t::putVarint(uint64_t value) {
+  uint8_t bytes[10];
+  int n = 0;
+  do {
+    bytes[n] = value & 0x7F;
+    value >>= 7;
+    if (value != 0)
+      bytes[n] |= 0x80;
+    n++;
+  } while (value != 0);
+  put(bytes, n);
+}
+
+void trace_writer_t::write(const trace_record_t &record) {
+  records++;
+  if (!(header_flags & TRACE_F_COMPRESSED)) {
+    uint8_t bytes[TRACE_RECORD_SIZE];
+    putU32(bytes, record.pc);
+    putU32(bytes + 4, record.raw);
+    putU32(bytes + 8, record.rd_value);
+    putU32(bytes + 12, record.mem_address);
+    putU32(bytes + 16, record.started);
+    putU32(bytes + 20, record.finished);
+    putU32(bytes + 24, record.committed);
+    bytes[28] = record.flags;
+    put(bytes, sizeof(bytes));
+    return;
+  }
+
+  // Cada campo é gravado relativo ao registro anterior, só os campos válidos
+  uint8_t bytes[4];
+  put(&record.flags, 1);
+  putVarint(zigzag((int64_t)record.pc - ((int64_t)last.pc + 4)));
+  putU32(bytes, record.raw);
+  put(bytes, 4);
+  if (record.flags & TRACE_R_RD_WRITTEN)
+    putVarint(zigzag((int32_t)record.rd_value));
+  if (record.flags & TRACE_R_MEM_ACCESS)
+    putVarint(zigzag((int64_t)record.mem_address - last.mem_address));
+  if (header_flags & TRACE_F_TIMING) {
+    putVarint(zigzag((int64_t)record.started - last.started));
+    putVarint(zigzag((int64_t)record.finished - record.started));
+    putVarint(zigzag((int64_t)record.committed - record.finished));
+  }
+  last.pc = record.pc;
+  if (record.flags & TRACE_R_MEM_ACCESS)
+    last.mem_address = record.mem_address;
+  last.started = record.started;
+}
+
+bool trace_writer_t::close() {
+  if (file == nullptr)
+    return !failed;
+  flush();
+  if (fclose(file) != 0)
+    failed = true;
+  file = nullptr;
+  return !failed;
+}
+
+uint64_t trace_writer_t::getRecords() { return records; }
+
+/***************************************************************************
+Trace reader
+***************************************************************************/
+trace_reader_t::trace_reader_t() {
+  file = nullptr;
+  header_flags = 0;
+  used = 0;
+  filled = 0;
+  truncated = false;
+  memset(&last, 0, sizeof(last));
+}
+
+trace_reader_t::~trace_reader_t() { close(); }
+
+bool trace_reader_t::open(const char *path) {
+  file = fopen(path, "rb");
+  if (file == nullptr)
+    return false;
+  buffer.resize(TRACE_BUFFER_SIZE);
+  used = filled = 0;
+  truncated = false;
+
+  uint8_t header[16];
+  if (!get(header, sizeof(header)) || memcmp(header, TRACE_MAGIC, 8) != 0 ||
+      getU32(header + 8) != TRACE_VERSION) {
+    close();
+    return false;
+  }
+  header_flags = getU32(header + 12);
+  return true;
+}
+
+bool trace_reader_t::get(uint8_t *data, size_t size) {
+  while (size > 0) {
+    if (used == filled) {
+      filled = fread(buffer.data(), 1, buffer.size(), file);
+      used = 0;
+      if (filled == 0)
+        return false;
+    }
+    size_t chunk = filled - used;
+    if (chunk > size)
+      chunk = size;
+    memcpy(data, &buffer[used], chunk);
+    used += chunk;
+    data += chunk;
+    size -= chunk;
+  }
+  return true;
+}
+
+bool trace_reader_t::getVarint(uint64_t *value) {
+  *value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    uint8_t byte;
+    if (!get(&byte, 1))
+      return false;
+    *value |= (uint64_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80))
+      return true;
+  }
+  return false;
+}
+
+bool trace_reader_t::next(trace_record_t *record) {
+  if (file == nullptr)
+    return false;
+  // O fim limpo do trace cai entre dois registros; um erro de leitura ou um
+  // fim no meio do registro indicam um trace truncado
+  if (used == filled) {
+    filled = fread(buffer.data(), 1, buffer.size(), file);
+    used = 0;
+    if (filled == 0) {
+      truncated = ferror(file) != 0;
+      return false;
+    }
+  }
+  if (!readRecord(record)) {
+    truncated = true;
+    return false;
+  }
+  return true;
+}
+
+bool trace_reader_t::readRecord(trace_record_t *record) {
+  if (!(header_flags & TRACE_F_COMPRESSED)) {
+    uint8_t bytes[TRACE_RECORD_SIZE];
+    if (!get(bytes, sizeof(bytes)))
+      return false;
+    record->pc = getU32(bytes);
+    record->raw = getU32(bytes + 4);
+    record->rd_value = getU32(bytes + 8);
+    record->mem_address = getU32(bytes + 12);
+    record->started = getU32(bytes + 16);
+    record->finished = getU32(bytes + 20);
+    record->committed = getU32(bytes + 24);
+    record->flags = bytes[28];
+    return true;
+  }
+
+  uint8_t bytes[4];
+  uint64_t value;
+  if (!get(&record->flags, 1) || !getVarint(&value))
+    return false;
+  record->pc = last.pc + 4 + unzigzag(value);
+  if (!get(bytes, 4))
+    return false;
+  record->raw = getU32(bytes);
+  record->rd_value = 0;
+  if (record->flags & TRACE_R_RD_WRITTEN) {
+    if (!getVarint(&value))
+      return false;
+    record->rd_value = unzigzag(value);
+  }
+  record->mem_address = 0;
+  if (record->flags & TRACE_R_MEM_ACCESS) {
+    if (!getVarint(&value))
+      return false;
+    record->mem_address = last.mem_address + unzigzag(value);
+    last.mem_address = record->mem_address;
+  }
+  record->started = record->finished = record->committed = 0;
+  if (header_flags & TRACE_F_TIMING) {
+    if (!getVarint(&value))
+      return false;
+    record->started = last.started + unzigzag(value);
+    if (!getVarint(&value))
+      return false;
+    record->finished = record->started + unzigzag(value);
+    if (!getVarint(&value))
+      return false;
+    record->committed = record->finished + unzigzag(value);
+  }
+  last.pc = record->pc;
+  last.started = record->started;
+  return true;
+}
+
+bool trace_reader_t::isTruncated() { return truncated; }
+
+bool trace_reader_t::hasTiming() { return header_flags & TRACE_F_TIMING; }
+
+void trace_reader_t::close() {
+  if (file == nullptr)
+    return;
+  fclose(file);
+  file = nullptr;
+}
@@ -0,0 +1,71 @@
+#!/bin/bash
+# Corpus de regressão: simula cada benchmark em todas as configurações de
+# config/regression.grid (com --sweep), com o modelo analítico e com o núcleo
+# fora de ordem, e compara instruções, ciclos, gshare e misses de cada cache
+# com benchmarks/golden/<benchmark>.csv e <benchmark>.ooo.csv. A execução
+# funcional (instruções e estado final) é comparada com
+# <benchmark>.functional.txt. Os benchmarks são executados em paralelo.
+#
+# Uso: tools/regression.sh [--update] [--jobs=<n>] [--rvsim=<binário>]
+#   --update  grava os resultados atuais como a nova referência
+
+RVSIM=./rvsim
+GRID=config/regression.grid
+GOLDEN=benchmarks/golden
+JOBS=$(nproc)
+UPDATE=0
+
+for arg in "$@"; do
+	case $arg in
+		--update) UPDATE=1 ;;
+		--jobs=*) JOBS=${arg#--jobs=} ;;
+		--rvsim=*) RVSIM=${arg#--rvsim=} ;;
+		*) echo "Uso: $0 [--update] [--jobs=<n>] [--rvsim=<binário>]"; exit 1 ;;
+	esac
+done
+
+OUTPUT=$(mktemp -d)
+trap 'rm -rf "$OUTPUT"' EXIT
+
+# Um benchmark por processo; cada varredura usa uma thread
+ls benchmarks/*.bin | xargs -P "$JOBS" -I {} sh -c '
+	out="$3/$(basename "$4")"
+	{ "$1" --sweep="$2" --jobs=1 --sweep-output="$out.csv" "$4" > "$out.log" 2>&1 &&
+	  "$1" --sweep="$2" --jobs=1 --core=ooo --sweep-output="$out.ooo.csv" "$4" >> "$out.log" 2>&1 &&
+	  PRINT_FINAL_STATE=true "$1" --functional "$4" 4 10 > "$out.functional.txt" 2>&1; } ||
+	echo "$4: o rvsim falhou" >> "$3/errors"' \
+	sh "$RVSIM" "$GRID" "$OUTPUT" {}
+
+if [ -s "$OUTPUT/errors" ]; then
+	cat "$OUTPUT/errors"
+	exit 1
+fi
+
+if [ $UPDATE = 1 ]; then
+	mkdir -p "$GOLDEN"
+	cp "$OUTPUT"/*.csv "$OUTPUT"/*.functional.txt "$GOLDEN"/
+	echo "Referência atualizada em $GOLDEN ($(ls "$OUTPUT"/*.functional.txt | wc -l) benchmarks)"
+	exit 0
+fi
+
+failures=0
+for f in benchmarks/*.bin; do
+	for result in "$(basename "$f")".csv "$(basename "$f")".ooo.csv \
+		"$(basename "$f")".functional.txt; do
+		if [ ! -f "$GOLDEN/$result" ]; then
+			echo "SEM REFERÊNCIA $result"
+			failures=$((failures + 1))
+		elif ! diff -q "$GOLDEN/$result" "$OUTPUT/$result" > /dev/null; then
+			echo "DIVERGE $result"
+			# Cabeçalho e linhas diferentes (- referência, + atual)
+			head -1 "$GOLDEN/$result"
+			diff "$GOLDEN/$result" "$OUTPUT/$result" | grep '^[<>]' | head -20 |
+				sed 's/^</-/; s/^>/+/'
+			failures=$((failures + 1))
+		fi
+	done
+done
+
+configs=$(($(wc -l < "$(ls "$OUTPUT"/*.ooo.csv | head -1)") - 1))
+echo "Regressão: $(ls benchmarks/*.bin | wc -l) benchmarks, $configs configurações cada (modelo analítico e núcleo fora de ordem) e a execução funcional, $failures divergências"
+[ $failures = 0 ]
@@ -0,0 +1,161 @@
+/*
+ * Teste da API C (include/rvsim.h): compilado como C e ligado à librvsim.a,
+ * exercita cada função pública com um programa de benchmark e confere os
+ * resultados entre si (execução em partes contra a execução inteira,
+ * checkpoint contra a execução sem checkpoint).
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "rvsim.h"
+
+static int checks = 0;
+static int failures = 0;
+
+static void check(int ok, const char *what) {
+  checks++;
+  if (!ok) {
+    failures++;
+    printf("FALHOU: %s\n", what);
+  }
+}
+
+/* Cria uma instância com a configuração padrão e carrega o programa */
+static rvsim_t *start(const char *path, int core) {
+  rvsim_options_t options;
+  char error[256];
+  rvsim_t *sim;
+  rvsim_default_options(&options);
+  options.core = core;
+  sim = rvsim_create2(&options, error, sizeof(error));
+  if (sim == NULL) {
+    printf("rvsim_create2: %s\n", error);
+    return NULL;
+  }
+  if (rvsim_load_elf(sim, path) != 0) {
+    printf("rvsim_load_elf: %s\n", rvsim_last_error(sim));
+    rvsim_destroy(sim);
+    return NULL;
+  }
+  return sim;
+}
+
+static int sameRegisters(const rvsim_t *a, const rvsim_t *b) {
+  int reg;
+  for (reg = 0; reg < 32; reg++)
+    if (rvsim_read_reg(a, reg) != rvsim_read_reg(b, reg))
+      return 0;
+  return rvsim_get_pc(a) == rvsim_get_pc(b);
+}
+
+int main(int argc, char **argv) {
+  const char *path = argc > 1 ? argv[1] : "benchmarks/big_loop.c.bin";
+  const char *checkpoint = "rvsim-api-test.ckpt";
+  rvsim_options_t options;
+  rvsim_stats_t full, stats;
+  rvsim_t *reference, *sim, *restored, *ooo;
+  uint64_t executed, cycles_before, saved_instructions, saved_cycles;
+  uint32_t word = 0, pattern = 0x5eed1234, read_back = 0;
+  char error[256];
+
+  check(rvsim_api_version() == RVSIM_API_VERSION, "rvsim_api_version");
+
+  /* Configurações inválidas são recusadas com a mensagem */
+  rvsim_default_options(&options);
+  options.btb_entries = 3;
+  error[0] = '\0';
+  check(rvsim_create2(&options, error, sizeof(error)) == NULL &&
+            error[0] != '\0',
+        "rvsim_create2 recusa BTB que não é potência de 2");
+
+  /* Referência: o programa inteiro de uma vez */
+  reference = start(path, RVSIM_CORE_ANALYTIC);
+  if (reference == NULL)
+    return 1;
+  check(rvsim_read_reg(reference, 0) == 0, "x0 antes de executar");
+  rvsim_run(reference);
+  check(!rvsim_running(reference), "rvsim_run executa até o fim");
+  rvsim_get_stats(reference, &full);
+  check(full.instructions > 1000 && full.cycles > full.instructions,
+        "rvsim_get_stats depois de rvsim_run");
+  check(full.cache_levels > 0 && rvsim_cache_name(reference, 0) != NULL &&
+            rvsim_cache_name(reference, full.cache_levels) == NULL,
+        "níveis de cache");
+
+  /* Em partes: instruções, depois ciclos, checkpoint e o resto */
+  sim = start(path, RVSIM_CORE_ANALYTIC);
+  if (sim == NULL)
+    return 1;
+  check(rvsim_read_mem(sim, rvsim_get_pc(sim), &word, sizeof(word)) == 0 &&
+            word != 0,
+        "rvsim_read_mem no entry point");
+  executed = rvsim_step(sim, 100);
+  rvsim_get_stats(sim, &stats);
+  check(executed == 100 && stats.instructions == 100, "rvsim_step");
+  cycles_before = stats.cycles;
+  executed = rvsim_step_cycles(sim, 500);
+  rvsim_get_stats(sim, &stats);
+  check(executed > 0 && stats.instructions == 100 + executed &&
+            stats.cycles >= cycles_before + 500,
+        "rvsim_step_cycles");
+  saved_instructions = stats.instructions;
+  saved_cycles = stats.cycles;
+  check(rvsim_read_reg(sim, 0) == 0 && rvsim_read_reg(sim, 2) != 0 &&
+            rvsim_read_reg(sim, 32) == 0,
+        "rvsim_read_reg");
+
+  check(rvsim_save_checkpoint(sim, checkpoint) == 0,
+        "rvsim_save_checkpoint");
+  restored = start(path, RVSIM_CORE_ANALYTIC);
+  if (restored == NULL)
+    return 1;
+  check(rvsim_restore_checkpoint(restored, checkpoint) == 0,
+        "rvsim_restore_checkpoint");
+  check(sameRegisters(sim, restored), "estado restaurado");
+  check(rvsim_restore_checkpoint(sim, checkpoint) != 0,
+        "rvsim_restore_checkpoint recusa instância que já executou");
+
+  /* Os ciclos antes e depois do checkpoint somam os da execução inteira */
+  rvsim_run(sim);
+  rvsim_run(restored);
+  check(sameRegisters(sim, reference) && sameRegisters(restored, reference),
+        "estado final");
+  rvsim_get_stats(sim, &stats);
+  check(stats.instructions == full.instructions &&
+            stats.cycles == full.cycles,
+        "execução em partes igual à inteira");
+  rvsim_get_stats(restored, &stats);
+  check(stats.instructions + saved_instructions == full.instructions &&
+            stats.cycles + saved_cycles == full.cycles,
+        "execução restaurada");
+
+  /* Escrita pela API é lida de volta */
+  check(rvsim_write_mem(sim, rvsim_read_reg(sim, 2) - 64, &pattern,
+                        sizeof(pattern)) == 0 &&
+            rvsim_read_mem(sim, rvsim_read_reg(sim, 2) - 64, &read_back,
+                           sizeof(read_back)) == 0 &&
+            read_back == pattern,
+        "rvsim_write_mem");
+
+  /* O núcleo fora de ordem executa o mesmo programa e não grava checkpoints */
+  ooo = start(path, RVSIM_CORE_OOO);
+  if (ooo == NULL)
+    return 1;
+  rvsim_run(ooo);
+  rvsim_get_stats(ooo, &stats);
+  check(stats.instructions == full.instructions &&
+            sameRegisters(ooo, reference),
+        "núcleo fora de ordem");
+  check(rvsim_save_checkpoint(ooo, checkpoint) != 0 &&
+            strlen(rvsim_last_error(ooo)) > 0,
+        "checkpoint recusado no núcleo fora de ordem");
+
+  rvsim_destroy(ooo);
+  rvsim_destroy(restored);
+  rvsim_destroy(sim);
+  rvsim_destroy(reference);
+  remove(checkpoint);
+
+  printf("API C: %d verificações, %d falhas\n", checks, failures);
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,299 @@
+// Mede a velocidade do simulador: executa cada benchmark em cada modo
+// (temporizado, funcional, threaded e fora de ordem) várias vezes e reporta o tempo de
+// parede, os MIPS e o pico de memória, conferindo instruções e ciclos com os
+// valores de referência (golden)
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "elf_loader.h"
+#include "memory.h"
+#include "processor.h"
+
+struct bench_mode_t {
+  const char *name;
+  bool functional;
+  ENGINE engine;
+  CORE core;
+};
+
+static const bench_mode_t modes[] = {
+    {"timed", false, ENGINE::SWITCH, CORE::ANALYTIC},
+    {"functional", true, ENGINE::SWITCH, CORE::ANALYTIC},
+    {"threaded", true, ENGINE::THREADED, CORE::ANALYTIC},
+    {"ooo", false, ENGINE::SWITCH, CORE::OOO},
+};
+
+// Resultado de uma execução, enviado pelo processo filho
+struct trial_t {
+  uint64_t instructions;
+  uint64_t cycles;
+  uint64_t wall_ns;
+  long max_rss_kb;
+  bool ok;
+};
+
+// Valores de referência:
+// "<benchmark> <modo> <janela> <bits_gshare> <instruções> <ciclos>"
+typedef std::map<std::string, std::pair<uint64_t, uint64_t>> golden_t;
+
+static void usage() {
+  printf("Uso: rvsim-bench [--trials=<n>] [--modes=timed,functional,threaded,ooo] "
+         "[--window=<n>] [--gshare=<bits>] [--golden=<arquivo> "
+         "[--update-golden]] [--report=<arquivo>] <elf_program>...\n");
+}
+
+static std::string baseName(const std::string &path) {
+  size_t slash = path.rfind('/');
+  return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+// Executa a simulação inteira (carregar o ELF e executar o programa). O tempo
+// medido é só o da execução.
+static bool simulate(const char *path, const bench_mode_t &mode, int window,
+                     int gshare_bits, trial_t *trial) {
+  memory_t memory(!mode.functional);
+  uint32_t entry_point;
+  std::string error;
+  if (!load_elf(path, memory, &entry_point, error)) {
+    fprintf(stderr, "ELF: %s\n", error.c_str());
+    return false;
+  }
+  processor_config_t config;
+  config.window = window;
+  config.gshare_bits = gshare_bits;
+  config.functional = mode.functional;
+  config.engine = mode.engine;
+  config.core = mode.core;
+  processor_t processor(&memory, entry_point, config);
+  auto start = std::chrono::steady_clock::now();
+  processor.executeProgram();
+  auto end = std::chrono::steady_clock::now();
+  trial->instructions = processor.getStats().instructions;
+  trial->cycles = processor.getStats().cycles;
+  trial->wall_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+          .count();
+  return true;
+}
+
+// Cada execução é feita em um processo novo, para que o pico de memória
+// (ru_maxrss) seja o de uma única simulação
+static trial_t runTrial(const char *path, const bench_mode_t &mode, int window,
+                        int gshare_bits) {
+  trial_t trial = trial_t();
+  int pipe_fds[2];
+  if (pipe(pipe_fds) != 0)
+    return trial;
+  fflush(stdout);
+  pid_t child = fork();
+  if (child == 0) {
+    close(pipe_fds[0]);
+    trial_t result = trial_t();
+    result.ok = simulate(path, mode, window, gshare_bits, &result);
+    ssize_t written = write(pipe_fds[1], &result, sizeof(result));
+    _exit(written == sizeof(result) ? 0 : 1);
+  }
+  close(pipe_fds[1]);
+  if (child < 0) {
+    close(pipe_fds[0]);
+    return trial;
+  }
+  ssize_t received = read(pipe_fds[0], &trial, sizeof(trial));
+  close(pipe_fds[0]);
+  int status;
+  struct rusage usage;
+  if (wait4(child, &status, 0, &usage) != child || received != sizeof(trial) ||
+      !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    trial.ok = false;
+    return trial;
+  }
+  trial.max_rss_kb = usage.ru_maxrss;
+  return trial;
+}
+
+static bool loadGolden(const std::string &path, golden_t &golden) {
+  FILE *file = fopen(path.c_str(), "r");
+  if (file == nullptr)
+    return false;
+  char name[256], mode[32];
+  int window, gshare_bits;
+  unsigned long instructions, cycles;
+  while (fscanf(file, "%255s %31s %d %d %lu %lu", name, mode, &window,
+                &gshare_bits, &instructions, &cycles) == 6)
+    golden[std::string(name) + " " + mode + " " + std::to_string(window) +
+           " " + std::to_string(gshare_bits)] = {instructions, cycles};
+  fclose(file);
+  return true;
+}
+
+static bool saveGolden(const std::string &path, const golden_t &golden) {
+  FILE *file = fopen(path.c_str(), "w");
+  if (file == nullptr)
+    return false;
+  for (const auto &entry : golden)
+    fprintf(file, "%s %lu %lu\n", entry.first.c_str(),
+            (unsigned long)entry.second.first,
+            (unsigned long)entry.second.second);
+  fclose(file);
+  return true;
+}
+
+int main(int argc, char **argv) {
+  unsigned trials = 5;
+  int window = 4, gshare_bits = 10;
+  std::string golden_path, report_path;
+  bool update_golden = false;
+  std::vector<bench_mode_t> selected(std::begin(modes), std::end(modes));
+  std::vector<std::string> programs;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg.compare(0, 9, "--trials=") == 0) {
+      trials = std::stoul(arg.substr(9));
+    } else if (arg.compare(0, 9, "--window=") == 0) {
+      window = std::stoi(arg.substr(9));
+    } else if (arg.compare(0, 9, "--gshare=") == 0) {
+      gshare_bits = std::stoi(arg.substr(9));
+    } else if (arg.compare(0, 9, "--golden=") == 0) {
+      golden_path = arg.substr(9);
+    } else if (arg == "--update-golden") {
+      update_golden = true;
+    } else if (arg.compare(0, 9, "--report=") == 0) {
+      report_path = arg.substr(9);
+    } else if (arg.compare(0, 8, "--modes=") == 0) {
+      selected.clear();
+      std::string list = arg.substr(8) + ",";
+      for (size_t start = 0, comma; (comma = list.find(',', start)) !=
+                                    std::string::npos;
+           start = comma + 1) {
+        std::string name = list.substr(start, comma - start);
+        const bench_mode_t *found = nullptr;
+        for (const bench_mode_t &mode : modes)
+          if (name == mode.name)
+            found = &mode;
+        if (found == nullptr) {
+          usage();
+          return 1;
+        }
+        selected.push_back(*found);
+      }
+    } else if (arg.compare(0, 2, "--") == 0) {
+      usage();
+      return 1;
+    } else {
+      programs.push_back(arg);
+    }
+  }
+  if (programs.empty() || trials == 0 || (update_golden && golden_path.empty())) {
+    usage();
+    return 1;
+  }
+
+  golden_t golden;
+  if (!golden_path.empty() && !loadGolden(golden_path, golden) &&
+      !update_golden) {
+    fprintf(stderr, "Não foi possível ler %s\n", golden_path.c_str());
+    return 1;
+  }
+  FILE *report = nullptr;
+  if (!report_path.empty()) {
+    report = fopen(report_path.c_str(), "w");
+    if (report == nullptr) {
+      fprintf(stderr, "Não foi possível criar %s\n", report_path.c_str());
+      return 1;
+    }
+  }
+
+  // As larguras do cabeçalho contam os bytes extras dos acentos
+  printf("%-18s %-10s %14s %12s %10s %11s %9s %10s  %s\n", "benchmark", "modo",
+         "instruções", "ciclos", "mediana ms", "mínimo ms", "MIPS", "RSS KiB",
+         "golden");
+  int failures = 0;
+  for (const std::string &program : programs) {
+    std::string name = baseName(program);
+    for (const bench_mode_t &mode : selected) {
+      std::vector<trial_t> results;
+      for (unsigned trial = 0; trial < trials; trial++)
+        results.push_back(runTrial(program.c_str(), mode, window, gshare_bits));
+      bool ok = true;
+      for (const trial_t &result : results)
+        ok &= result.ok;
+      if (!ok) {
+        printf("%-18s %-10s falhou\n", name.c_str(), mode.name);
+        failures++;
+        continue;
+      }
+      std::vector<uint64_t> walls;
+      long max_rss = 0;
+      for (const trial_t &result : results) {
+        walls.push_back(result.wall_ns);
+        max_rss = std::max(max_rss, result.max_rss_kb);
+      }
+      std::sort(walls.begin(), walls.end());
+      uint64_t median = walls[walls.size() / 2];
+      const trial_t &first = results[0];
+      double mips = median > 0 ? first.instructions * 1000.0 / median : 0;
+
+      // Todas as execuções precisam dar o mesmo resultado, e ele precisa
+      // bater com a referência
+      const char *verdict = "-";
+      for (const trial_t &result : results)
+        if (result.instructions != first.instructions ||
+            result.cycles != first.cycles)
+          verdict = "NÃO DETERMINÍSTICO";
+      std::string key = name + " " + mode.name + " " + std::to_string(window) +
+                        " " + std::to_string(gshare_bits);
+      if (update_golden) {
+        golden[key] = {first.instructions, first.cycles};
+        verdict = "gravado";
+      } else if (!golden_path.empty() && strcmp(verdict, "-") == 0) {
+        auto expected = golden.find(key);
+        if (expected == golden.end())
+          verdict = "SEM REFERÊNCIA";
+        else if (expected->second.first != first.instructions ||
+                 expected->second.second != first.cycles)
+          verdict = "DIVERGE";
+        else
+          verdict = "ok";
+      }
+      if (strcmp(verdict, "-") != 0 && strcmp(verdict, "ok") != 0 &&
+          strcmp(verdict, "gravado") != 0)
+        failures++;
+
+      printf("%-18s %-10s %12lu %12lu %10.3f %10.3f %9.2f %10ld  %s\n",
+             name.c_str(), mode.name, (unsigned long)first.instructions,
+             (unsigned long)first.cycles, median / 1e6, walls[0] / 1e6, mips,
+             max_rss, verdict);
+      if (report != nullptr)
+        fprintf(report,
+                "{\"benchmark\": \"%s\", \"mode\": \"%s\", \"window\": %d, "
+                "\"gshare_bits\": %d, \"trials\": %u, \"instructions\": %lu, "
+                "\"cycles\": %lu, \"wall_ns_median\": %lu, "
+                "\"wall_ns_min\": %lu, \"mips\": %.3f, \"max_rss_kb\": %ld, "
+                "\"golden\": \"%s\"}\n",
+                name.c_str(), mode.name, window, gshare_bits, trials,
+                (unsigned long)first.instructions,
+                (unsigned long)first.cycles, (unsigned long)median,
+                (unsigned long)walls[0], mips, max_rss, verdict);
+    }
+  }
+  if (report != nullptr)
+    fclose(report);
+  // Os valores de outras configurações já gravados são mantidos
+  if (update_golden && !saveGolden(golden_path, golden)) {
+    fprintf(stderr, "Não foi possível gravar %s\n", golden_path.c_str());
+    return 1;
+  }
+  if (failures > 0)
+    printf("%d falhas\n", failures);
+  return failures == 0 ? 0 : 1;
+}
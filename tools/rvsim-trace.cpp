@@ -0,0 +1,58 @@
+// Converte um trace binário do rvsim para o formato texto do
+// PRINT_INSTRUCTION_LOG
+#include <cstdio>
+#include <cstring>
+
+#include "isa.h"
+#include "trace.h"
+
+static void usage() {
+  printf("Uso: rvsim-trace [--end-time] <trace_file>\n");
+}
+
+int main(int argc, char **argv) {
+  bool end_time = false;
+  const char *path = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--end-time") == 0) {
+      end_time = true;
+    } else if (path == nullptr && argv[i][0] != '-') {
+      path = argv[i];
+    } else {
+      usage();
+      return 1;
+    }
+  }
+  if (path == nullptr) {
+    usage();
+    return 1;
+  }
+
+  trace_reader_t reader;
+  if (!reader.open(path)) {
+    printf("Não foi possível abrir o trace %s\n", path);
+    return 1;
+  }
+
+  trace_record_t record;
+  char line[LOG_LINE_SIZE];
+  while (reader.next(&record)) {
+    decoded_t ins = decodeInstruction(record.raw, record.pc);
+    formatLogLine(ins, line, sizeof(line));
+    // Mesmo formato (e colunas) impresso pelo processor_t::executeProgram
+    if (!reader.hasTiming()) {
+      printf("%s\n", line);
+      continue;
+    }
+    printf("%-53s", line);
+    if (end_time)
+      printf("| STARTED AT: %-5u", record.started);
+    printf("| FINISHED AT: %-5u", record.finished);
+    printf("| COMMITED AT: %-5u\n", record.committed);
+  }
+  if (reader.isTruncated()) {
+    printf("O trace %s termina em um registro incompleto\n", path);
+    return 1;
+  }
+  return 0;
+}